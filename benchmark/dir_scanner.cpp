@@ -0,0 +1,49 @@
+#include <cctype>
+#include <filesystem>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <prox/dir_scanner.hpp>
+
+namespace
+{
+	// Previous std::filesystem-based scan of /proc, kept as the baseline to compare against
+	void BM_directory_iterator(benchmark::State & state)
+	{
+		namespace fs = std::filesystem;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			pid_t sum = 0;
+			for (const auto & entry : fs::directory_iterator("/proc"))
+			{
+				if (not fs::is_directory(entry)) { continue; }
+
+				const auto & path = entry.path().filename().string();
+
+				if (std::isdigit(path[0]) == 0) { continue; }
+
+				sum += std::stoi(path);
+			}
+			benchmark::DoNotOptimize(sum);
+		}
+	}
+
+	void BM_pid_scanner(benchmark::State & state)
+	{
+		prox::pid_scanner scanner;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			pid_t sum = 0;
+			scanner.scan(std::filesystem::path("/proc"), [&](const pid_t pid) { sum += pid; });
+			benchmark::DoNotOptimize(sum);
+		}
+	}
+} // namespace
+
+BENCHMARK(BM_directory_iterator);
+BENCHMARK(BM_pid_scanner);
+
+BENCHMARK_MAIN();
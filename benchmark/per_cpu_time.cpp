@@ -0,0 +1,77 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <prox/cpu_time.hpp>
+#include <prox/per_cpu_time.hpp>
+
+namespace
+{
+	// /proc/stat of a machine with "n_cpus" CPUs
+	auto write_stat(const std::size_t n_cpus)
+	{
+		const auto path = std::filesystem::temp_directory_path() / ("per_cpu_time_" + std::to_string(n_cpus));
+
+		std::ofstream out(path);
+		out << "cpu  1816560 4773 518338 23132813 31707 0 49840 0 0 0\n";
+		for (std::size_t cpu = 0; cpu < n_cpus; ++cpu)
+		{
+			out << "cpu" << cpu << " 157226 402 45232 1925414 2650 0 820 0 0 0\n";
+		}
+		out << "intr 85874642 12 1334 0 0 0 0 0 0 0 318969 0 0 225 0 0 0 3 4737226 0 0 0 0 0 0 0 0 0 0 0 0 0\n"
+		       "ctxt 251528755\n"
+		       "btime 1701244738\n";
+
+		return path;
+	}
+
+	// Aggregate line only, for reference
+	void BM_cpu_time(benchmark::State & state)
+	{
+		const auto path = write_stat(static_cast<std::size_t>(state.range(0)));
+
+		prox::CPU_time cpu_time;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			cpu_time.update(path);
+			benchmark::DoNotOptimize(cpu_time.period());
+		}
+	}
+
+	void BM_per_cpu_time(benchmark::State & state)
+	{
+		const auto path = write_stat(static_cast<std::size_t>(state.range(0)));
+
+		prox::per_CPU_time cpu_time;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			cpu_time.update(path);
+			benchmark::DoNotOptimize(cpu_time.cpus().data());
+		}
+
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+
+	void BM_per_cpu_time_system(benchmark::State & state)
+	{
+		prox::per_CPU_time cpu_time;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			cpu_time.update();
+			benchmark::DoNotOptimize(cpu_time.cpus().data());
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(cpu_time.size()));
+	}
+} // namespace
+
+BENCHMARK(BM_cpu_time)->ArgName("cpus")->Arg(512);
+BENCHMARK(BM_per_cpu_time)->ArgName("cpus")->RangeMultiplier(8)->Range(8, 512);
+BENCHMARK(BM_per_cpu_time_system);
+
+BENCHMARK_MAIN();
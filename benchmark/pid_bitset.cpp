@@ -0,0 +1,77 @@
+#include <cstddef>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <prox/pid_bitset.hpp>
+
+namespace
+{
+	// PIDs spread over the whole range, as on a machine with a large pid_max
+	auto sample_pids(const std::size_t n, const std::size_t pid_max)
+	{
+		std::vector<pid_t> pids;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			pids.emplace_back(static_cast<pid_t>((i * 7919 + 1) % pid_max));
+		}
+		return pids;
+	}
+
+	// Previous bookkeeping: two std::vector<bool> filled and compared PID by PID
+	void BM_vector_bool_sweep(benchmark::State & state)
+	{
+		const auto pid_max = static_cast<std::size_t>(state.range(0));
+		const auto pids    = sample_pids(1000, pid_max);
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			std::vector<bool> old_pids(pid_max, false);
+			std::vector<bool> updated_pids(pid_max, false);
+
+			for (std::size_t i = 0; i < pids.size(); ++i)
+			{
+				old_pids[static_cast<std::size_t>(pids[i])] = true;
+				if (i % 10 not_eq 0) { updated_pids[static_cast<std::size_t>(pids[i])] = true; }
+			}
+
+			std::size_t removed = 0;
+			for (const auto pid : pids)
+			{
+				const auto pos = static_cast<std::size_t>(pid);
+				if (old_pids[pos] and not updated_pids[pos]) { ++removed; }
+			}
+			benchmark::DoNotOptimize(removed);
+		}
+	}
+
+	void BM_pid_bitset_sweep(benchmark::State & state)
+	{
+		const auto pid_max = static_cast<std::size_t>(state.range(0));
+		const auto pids    = sample_pids(1000, pid_max);
+
+		prox::pid_bitset old_pids(pid_max);
+		prox::pid_bitset updated_pids(pid_max);
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			old_pids.clear();
+			updated_pids.clear();
+
+			for (std::size_t i = 0; i < pids.size(); ++i)
+			{
+				old_pids.set(pids[i]);
+				if (i % 10 not_eq 0) { updated_pids.set(pids[i]); }
+			}
+
+			std::size_t removed = 0;
+			prox::pid_bitset::for_each_difference(old_pids, updated_pids, [&](const pid_t) { ++removed; });
+			benchmark::DoNotOptimize(removed);
+		}
+	}
+} // namespace
+
+BENCHMARK(BM_vector_bool_sweep)->Arg(32768)->Arg(4194304);
+BENCHMARK(BM_pid_bitset_sweep)->Arg(32768)->Arg(4194304);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,266 @@
+#include <unistd.h> // for getpid
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <prox/prox.hpp>
+
+#include "mock_process.hpp"
+
+namespace
+{
+	// Read system calls of this process so far (syscr of /proc/self/io)
+	auto read_syscalls() -> double
+	{
+		std::ifstream io("/proc/self/io");
+		for (std::string key; io >> key;)
+		{
+			double value = 0;
+			io >> value;
+			if (key == "syscr:") { return value; }
+		}
+		return 0;
+	}
+
+	// Mock proc folder: a root with a few hundred children, listed in its children file
+	class mock_proc
+	{
+		static constexpr pid_t N_CHILDREN = 512;
+
+	public:
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "prox_benchmark" / "proc";
+
+		mock_proc()
+		{
+			prox::process_stat root;
+			root.pid  = 1;
+			root.pgrp = 1;
+			root.ppid = 0;
+			root.path = path / "1";
+			root.name = "root";
+
+			for (pid_t pid = 2; pid < N_CHILDREN + 2; ++pid)
+			{
+				prox::process_stat child;
+				child.pid  = pid;
+				child.pgrp = static_cast<uint>(pid); // Not a LWP
+				child.ppid = root.pid;
+				child.path = path / std::to_string(pid);
+				child.name = "child";
+				prox::write_mock_process_stat(child);
+
+				root.children.emplace(pid);
+			}
+
+			prox::write_mock_process_stat(root);
+		}
+
+		mock_proc(const mock_proc &)                     = delete;
+		auto operator=(const mock_proc &) -> mock_proc & = delete;
+		mock_proc(mock_proc &&)                          = delete;
+		auto operator=(mock_proc &&) -> mock_proc &      = delete;
+
+		~mock_proc() { std::filesystem::remove_all(path.parent_path()); }
+	};
+
+	// Full update of the process tree of this machine.
+	// Arguments: the cap of the fd cache (0 disables it) and the collection backend.
+	void BM_update(benchmark::State & state)
+	{
+		prox::process_tree tree;
+
+		tree.max_open_fds(static_cast<std::size_t>(state.range(0)));
+
+		const auto backend = static_cast<prox::collection_backend>(state.range(1));
+		if (tree.backend(backend) not_eq backend)
+		{
+			state.SkipWithError("Backend not available");
+			return;
+		}
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			tree.update();
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+		state.counters["open_fds"] = static_cast<double>(tree.open_fds());
+	}
+
+	// Only the subtree of the benchmark (a few tasks), instead of the whole system
+	void BM_update_subtree(benchmark::State & state)
+	{
+		prox::process_tree tree(::getpid(), "/proc", prox::tree_scope::subtree);
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			tree.update();
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+	}
+
+	// Filter the processes that use more than 1% of a CPU (as in the example)
+	void BM_filter_processes(benchmark::State & state)
+	{
+		prox::process_tree tree;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			std::size_t n = 0;
+			for (const auto & proc : tree.processes())
+			{
+				if (proc.cpu_use() > 1.0F) { ++n; }
+			}
+			benchmark::DoNotOptimize(n);
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+	}
+
+	void BM_filter_columns(benchmark::State & state)
+	{
+		prox::process_tree tree;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			std::size_t n = 0;
+			for (const auto & row : tree.columns().rows())
+			{
+				if (row.cpu_use() > 1.0F) { ++n; }
+			}
+			benchmark::DoNotOptimize(n);
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+	}
+
+	// Update with the top "capacity" processes by CPU use ranked (0: not ranked). The processes are ranked while
+	// the columns are refreshed, so the difference between both is what ranking adds to an update (compare with a
+	// scan of the columns plus a sort, BM_sort_cpu).
+	void BM_top_cpu(benchmark::State & state)
+	{
+		prox::process_tree tree;
+
+		const auto capacity = static_cast<std::size_t>(state.range(0));
+		tree.rank(prox::rank_key::cpu_use, capacity);
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			tree.update();
+			if (capacity > 0) { benchmark::DoNotOptimize(tree.top_cpu(capacity).data()); }
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+	}
+
+	void BM_sort_cpu(benchmark::State & state)
+	{
+		prox::process_tree tree;
+
+		std::vector<prox::ranked_pid> ranked;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			ranked.clear();
+			for (const auto & row : tree.columns().rows())
+			{
+				ranked.push_back({ row.pid(), row.cpu_use() });
+			}
+			std::partial_sort(ranked.begin(), ranked.begin() + std::min<std::ptrdiff_t>(10, std::ssize(ranked)),
+			                  ranked.end(), [](const auto & a, const auto & b) { return a.value > b.value; });
+			benchmark::DoNotOptimize(ranked.data());
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+	}
+
+	// Check whether every process of the system is a descendant of init, with the tour built by the first query
+	void BM_is_descendant(benchmark::State & state)
+	{
+		prox::process_tree tree;
+
+		const auto pids = std::vector<pid_t>(tree.columns().pids().begin(), tree.columns().pids().end());
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			std::size_t descendants = 0;
+			for (const auto pid : pids)
+			{
+				descendants += static_cast<std::size_t>(tree.is_descendant(pid, 1));
+			}
+			benchmark::DoNotOptimize(descendants);
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(pids.size()));
+	}
+
+	// Full update of the mock proc folder, with the hierarchy from the children files or from ppid.
+	// "read_syscalls" counts the read system calls per update.
+	void BM_update_hierarchy(benchmark::State & state)
+	{
+		const mock_proc mock;
+
+		prox::process_tree tree(1, mock.path);
+
+		tree.hierarchy(static_cast<prox::hierarchy_source>(state.range(0)));
+		tree.update();
+
+		const auto syscalls_before = read_syscalls();
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			tree.update();
+		}
+
+		const auto syscalls = read_syscalls() - syscalls_before - 1; // The read of /proc/self/io itself
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+		state.counters["read_syscalls"] = syscalls / static_cast<double>(state.iterations());
+	}
+
+	void update_args(benchmark::internal::Benchmark * b)
+	{
+		b->ArgNames({ "max_open_fds", "backend" });
+
+		for (const auto backend : { prox::collection_backend::synchronous, prox::collection_backend::io_uring })
+		{
+			for (const auto max_open_fds : { std::size_t{ 0 }, prox::fd_cache{}.max_open_fds() })
+			{
+				b->Args({ static_cast<int64_t>(max_open_fds), static_cast<int64_t>(backend) });
+			}
+		}
+	}
+
+	void BM_update_parallel(benchmark::State & state)
+	{
+		prox::process_tree tree;
+
+		tree.workers(static_cast<std::size_t>(state.range(0)));
+		tree.backend(prox::collection_backend::parallel);
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			tree.update();
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+	}
+} // namespace
+
+BENCHMARK(BM_update)->Apply(update_args);
+BENCHMARK(BM_update_parallel)->ArgName("workers")->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_update_subtree);
+BENCHMARK(BM_update_hierarchy)->ArgName("source")->Arg(0)->Arg(1);
+BENCHMARK(BM_filter_processes);
+BENCHMARK(BM_filter_columns);
+BENCHMARK(BM_top_cpu)->ArgName("capacity")->Arg(0)->Arg(10);
+BENCHMARK(BM_sort_cpu);
+BENCHMARK(BM_is_descendant);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,153 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <prox/stat.hpp>
+
+namespace
+{
+	// Previous std::ifstream-based parser, kept as the baseline to compare against
+	void ifstream_update_stat_file(const std::filesystem::path & stat_file, prox::stat & stat)
+	{
+		std::ifstream file(stat_file);
+
+		if (not file.is_open()) { throw std::runtime_error("Could not open stat file " + stat_file.string()); }
+
+		file >> stat.pid;
+
+		std::getline(file, stat.comm, ' '); // Skip space before name
+		std::getline(file, stat.comm, ' '); // get the name in the format -> "(name)"
+		// Remove the parentheses
+		if (stat.comm.starts_with("(")) { stat.comm.erase(0, 1); }
+		if (stat.comm.ends_with(")")) { stat.comm.erase(stat.comm.size() - 1); }
+
+		file >> stat.state >> stat.ppid >> stat.pgrp >> stat.session >> stat.tty_nr >> stat.tpgid >> stat.flags >>
+		    stat.minflt >> stat.cminflt >> stat.majflt >> stat.cmajflt >> stat.utime >> stat.stime >> stat.cutime >>
+		    stat.cstime >> stat.priority >> stat.nice >> stat.num_threads >> stat.itrealvalue >> stat.starttime >>
+		    stat.vsize >> stat.rss >> stat.rsslim >> stat.startcode >> stat.endcode >> stat.startstack >>
+		    stat.kstkesp >> stat.kstkeip >> stat.signal >> stat.blocked >> stat.sigignore >> stat.sigcatch >>
+		    stat.wchan >> stat.nswap >> stat.cnswap >> stat.exit_signal >> stat.processor >> stat.rt_priority >>
+		    stat.policy >> stat.delayacct_blkio_ticks >> stat.guest_time >> stat.cguest_time >> stat.start_data >>
+		    stat.end_data >> stat.start_brk >> stat.arg_start >> stat.arg_end >> stat.env_start >> stat.env_end >>
+		    stat.exit_code;
+	}
+
+	// Stat files of every task currently running in this machine
+	auto all_stat_files() -> const std::vector<std::filesystem::path> &
+	{
+		static const auto files = [] {
+			std::vector<std::filesystem::path> paths;
+
+			for (const auto & proc : std::filesystem::directory_iterator("/proc"))
+			{
+				if (std::isdigit(proc.path().filename().c_str()[0]) == 0) { continue; }
+
+				std::error_code ec;
+				for (const auto & task : std::filesystem::directory_iterator(proc.path() / "task", ec))
+				{
+					paths.emplace_back(task.path() / "stat");
+				}
+			}
+
+			return paths;
+		}();
+
+		return files;
+	}
+
+	template<typename Parser>
+	void parse_self(benchmark::State & state, Parser && parser)
+	{
+		const std::filesystem::path stat_file = "/proc/self/stat";
+
+		prox::stat stat;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			parser(stat_file, stat);
+			benchmark::DoNotOptimize(stat);
+		}
+	}
+
+	template<typename Parser>
+	void parse_all(benchmark::State & state, Parser && parser)
+	{
+		const auto & files = all_stat_files();
+
+		prox::stat stat;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			for (const auto & file : files)
+			{
+				try
+				{
+					parser(file, stat);
+				}
+				catch (...)
+				{
+					// The task might have finished in the meantime
+				}
+				benchmark::DoNotOptimize(stat);
+			}
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(files.size()));
+	}
+
+	void BM_ifstream_self(benchmark::State & state)
+	{
+		parse_self(state, ifstream_update_stat_file);
+	}
+
+	void BM_prox_self(benchmark::State & state)
+	{
+		parse_self(state, prox::update_stat_file<prox::ALL_STAT_FIELDS>);
+	}
+
+	void BM_ifstream_all_tasks(benchmark::State & state)
+	{
+		parse_all(state, ifstream_update_stat_file);
+	}
+
+	void BM_prox_all_tasks(benchmark::State & state)
+	{
+		parse_all(state, prox::update_stat_file<prox::ALL_STAT_FIELDS>);
+	}
+
+	void BM_prox_all_tasks_cpu_fields(benchmark::State & state)
+	{
+		parse_all(state, prox::update_stat_file<prox::CPU_STAT_FIELDS>);
+	}
+
+	template<prox::stat_mask Fields>
+	void BM_prox_parse_only(benchmark::State & state)
+	{
+		const std::string line =
+		    "1234 (my (weird) comm) S 1 1234 1234 34816 13349 4194304 48695 385441 77 353 142 88 486 406 20 0 1 0 "
+		    "29218 23072768 3432 18446744073709551615 94317919137792 94317919912838 140733960279152 0 0 0 2 3686400 "
+		    "134295555 1 0 0 17 6 0 0 0 0 0 94317920029408 94317920058604 94317926449152 140733960280484 "
+		    "140733960280488 140733960280488 140733960282091 0\n";
+
+		prox::stat stat;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			prox::parse_stat<Fields>(line, stat);
+			benchmark::DoNotOptimize(stat);
+		}
+	}
+} // namespace
+
+BENCHMARK(BM_ifstream_self);
+BENCHMARK(BM_prox_self);
+BENCHMARK(BM_ifstream_all_tasks);
+BENCHMARK(BM_prox_all_tasks);
+BENCHMARK(BM_prox_all_tasks_cpu_fields);
+BENCHMARK(BM_prox_parse_only<prox::ALL_STAT_FIELDS>);
+BENCHMARK(BM_prox_parse_only<prox::CPU_STAT_FIELDS>);
+
+BENCHMARK_MAIN();
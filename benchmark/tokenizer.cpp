@@ -0,0 +1,163 @@
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <prox/cpu_time.hpp>
+#include <prox/stat.hpp>
+#include <prox/tokenizer.hpp>
+
+namespace
+{
+	constexpr std::size_t MAX_FIELDS = 64;
+
+	// Stat lines of every task running in this machine, captured once
+	auto captured_stat_lines() -> const std::vector<std::string> &
+	{
+		static const auto lines = [] {
+			std::vector<std::string> captured;
+
+			for (const auto & proc : std::filesystem::directory_iterator("/proc"))
+			{
+				if (std::isdigit(proc.path().filename().c_str()[0]) == 0) { continue; }
+
+				std::error_code ec;
+				for (const auto & task : std::filesystem::directory_iterator(proc.path() / "task", ec))
+				{
+					std::ifstream file(task.path() / "stat");
+					std::string   line;
+					if (std::getline(file, line)) { captured.emplace_back(std::move(line)); }
+				}
+			}
+
+			return captured;
+		}();
+
+		return lines;
+	}
+
+	// First line of /proc/stat ("cpu ...")
+	auto captured_cpu_line() -> const std::string &
+	{
+		static const auto line = [] {
+			std::ifstream file(prox::CPU_time::FILE_CPU_STAT);
+			std::string   first_line;
+			std::getline(file, first_line);
+			return first_line;
+		}();
+
+		return line;
+	}
+
+	void tokenize_lines(benchmark::State & state, const prox::simd_level level)
+	{
+		if (level == prox::simd_level::avx2 and not __builtin_cpu_supports("avx2"))
+		{
+			state.SkipWithError("AVX2 not supported");
+			return;
+		}
+
+		const auto   tokenize_fn = prox::tokenizer::tokenizer_for(level);
+		const auto & lines       = captured_stat_lines();
+
+		std::array<prox::field, MAX_FIELDS> fields;
+
+		std::size_t bytes = 0;
+		for (const auto & line : lines)
+		{
+			bytes += line.size();
+		}
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			for (const auto & line : lines)
+			{
+				benchmark::DoNotOptimize(tokenize_fn(line, fields));
+			}
+			benchmark::ClobberMemory();
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(lines.size()));
+		state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes));
+	}
+
+	void BM_tokenize_scalar(benchmark::State & state)
+	{
+		tokenize_lines(state, prox::simd_level::scalar);
+	}
+
+	void BM_tokenize_sse2(benchmark::State & state)
+	{
+		tokenize_lines(state, prox::simd_level::sse2);
+	}
+
+	void BM_tokenize_avx2(benchmark::State & state)
+	{
+		tokenize_lines(state, prox::simd_level::avx2);
+	}
+
+	void BM_tokenize_and_decode(benchmark::State & state)
+	{
+		const auto & lines = captured_stat_lines();
+
+		std::array<prox::field, MAX_FIELDS>   fields;
+		std::array<std::uint64_t, MAX_FIELDS> values;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			for (const auto & line : lines)
+			{
+				const auto n = prox::tokenize(line, fields);
+				benchmark::DoNotOptimize(prox::decode_integers(line, std::span(fields).first(n), values));
+			}
+			benchmark::ClobberMemory();
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(lines.size()));
+	}
+
+	void BM_parse_stat(benchmark::State & state)
+	{
+		const auto & lines = captured_stat_lines();
+
+		prox::stat stat;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			for (const auto & line : lines)
+			{
+				prox::parse_stat(line, stat);
+				benchmark::DoNotOptimize(stat);
+			}
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(lines.size()));
+	}
+
+	void BM_parse_cpu_line(benchmark::State & state)
+	{
+		const auto & line = captured_cpu_line();
+
+		std::array<prox::field, 16>   fields;
+		std::array<std::uint64_t, 16> values;
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			const auto n = prox::tokenize(line, fields);
+			benchmark::DoNotOptimize(prox::decode_integers(line, std::span(fields).subspan(1, n - 1), values));
+			benchmark::ClobberMemory();
+		}
+	}
+} // namespace
+
+BENCHMARK(BM_tokenize_scalar);
+BENCHMARK(BM_tokenize_sse2);
+BENCHMARK(BM_tokenize_avx2);
+BENCHMARK(BM_tokenize_and_decode);
+BENCHMARK(BM_parse_stat);
+BENCHMARK(BM_parse_cpu_line);
+
+BENCHMARK_MAIN();
@@ -18,19 +18,32 @@ struct Options
 	static constexpr auto DEFAULT_DEBUG     = false;
 	static constexpr auto DEFAULT_PROFILE   = false;
 	static constexpr auto DEFAULT_MIGRATION = false;
+	static constexpr auto DEFAULT_IO_URING  = false;
+	static constexpr auto DEFAULT_EVENTS    = false;
+	static constexpr auto DEFAULT_SUBTREE   = false;
+	static constexpr auto DEFAULT_PPID      = false;
 
 	static constexpr auto DEFAULT_TIME    = 30.0;
 	static constexpr auto DEFAULT_DT      = 1.0;
+	static constexpr auto DEFAULT_WORKERS = std::size_t{ 1 };
 	static constexpr auto DEFAULT_CPU_USE = -1.0;
+	static constexpr auto DEFAULT_TOP     = std::size_t{ 0 }; // List every process above --cpu
 
 	bool debug     = DEFAULT_DEBUG;
 	bool profile   = DEFAULT_PROFILE;
 	bool migration = DEFAULT_MIGRATION;
+	bool io_uring  = DEFAULT_IO_URING;
+	bool events    = DEFAULT_EVENTS;
+	bool subtree   = DEFAULT_SUBTREE;
+	bool ppid      = DEFAULT_PPID;
 
 	float time    = DEFAULT_TIME;
 	float dt      = DEFAULT_DT;
 	float cpu_use = DEFAULT_CPU_USE;
 
+	std::size_t workers = DEFAULT_WORKERS;
+	std::size_t top     = DEFAULT_TOP;
+
 	std::string child_process{};
 };
 
@@ -42,6 +55,8 @@ struct Global
 
 	prox::process_tree processes;
 
+	prox::change_log changes; // Of the last update
+
 	pid_t child_pid = 0;
 };
 
@@ -92,12 +107,20 @@ void parse_options(CLI::App & app, const int argc, const char * argv[])
 	app.add_flag("-d,--debug", options.debug, "Debug output");
 	app.add_flag("-p,--profile", options.profile, "Profile children processes");
 	app.add_flag("-m,--migration", options.migration, "Migrate child process to random CPU");
+	auto * io_uring =
+	    app.add_flag("-u,--io-uring", options.io_uring, "Update the process tree in batches through io_uring");
+	app.add_flag("-e,--events", options.events, "Find new processes from the kernel proc connector (needs root)");
+	app.add_flag("-P,--ppid", options.ppid, "Link the processes from their ppid instead of reading the children files");
 
 	app.add_option("-t,--time", options.time, "Time to run (seconds) the demo for");
 	app.add_option("-s,--dt", options.dt, "Time step (seconds) for the demo");
 	app.add_option("-c,--cpu", options.cpu_use, "Minimum CPU usage (0-100%) to show processes");
+	app.add_option("-n,--top", options.top, "Maximum number of processes to show with --cpu (0 shows them all)");
+	app.add_option("-j,--workers", options.workers, "Threads to update the process tree with (parallel backend)")
+	    ->excludes(io_uring); // One backend at a time
 
 	app.add_option("-r,--run", options.child_process, "Child process (command) to run");
+	app.add_flag("-S,--subtree", options.subtree, "Only watch the child process and its descendants (with --run)");
 
 	app.parse(argc, argv);
 
@@ -105,14 +128,45 @@ void parse_options(CLI::App & app, const int argc, const char * argv[])
 
 	if (not options.child_process.empty()) { run_child(options.child_process); }
 
+	if (options.subtree and global.child_pid > 0)
+	{
+		global.processes.root(global.child_pid);
+		global.processes.scope(prox::tree_scope::subtree);
+	}
+
+	if (options.ppid) { global.processes.hierarchy(prox::hierarchy_source::ppid); }
+
+	if (options.cpu_use > 0.0F and options.top > 0) { global.processes.rank(prox::rank_key::cpu_use, options.top); }
+
+	if (options.io_uring and
+	    global.processes.backend(prox::collection_backend::io_uring) not_eq prox::collection_backend::io_uring)
+	{
+		spdlog::warn("io_uring is not available. Using the synchronous backend.");
+	}
+
+	if (options.workers > 1)
+	{
+		global.processes.workers(options.workers);
+		global.processes.backend(prox::collection_backend::parallel);
+	}
+
+	if (options.events and not global.processes.watch_events())
+	{
+		spdlog::warn("The proc connector is not available. Scanning /proc on every update.");
+	}
+
 	if (options.debug)
 	{
 		spdlog::debug("Options:");
 		spdlog::debug("\tDebug: {}", options.debug);
 		spdlog::debug("\tProfile: {}", options.profile);
+		spdlog::debug("\tio_uring: {}", global.processes.backend() == prox::collection_backend::io_uring);
+		spdlog::debug("\tWorkers: {}", global.processes.workers());
+		spdlog::debug("\tEvents: {}", global.processes.watching_events());
 		spdlog::debug("\tTime: {}", options.time);
 		spdlog::debug("\tTime step: {}", options.dt);
 		spdlog::debug("\tCPU usage: {}", options.cpu_use);
+		spdlog::debug("\tTop: {}", options.top);
 		if (options.child_process.empty()) { spdlog::debug("\tChild process: None"); }
 		else { spdlog::debug("\tChild process (PID {}): {}", global.child_pid, options.child_process); }
 	}
@@ -152,13 +206,19 @@ auto keep_running()
 
 void update_tree()
 {
-	const auto millis_global   = measure([&] { global.processes.update(); });
+	const auto millis_global   = measure([&] { global.processes.update(global.changes); });
 	const auto millis_per_proc = millis_global / static_cast<double>(global.processes.size());
 	spdlog::info("Global update for {} processes took {} ({} per process)", global.processes.size(),
 	             format_seconds(millis_global), format_seconds(millis_per_proc));
 
 	spdlog::debug("Process tree with {} entries.", global.processes.size());
 
+	spdlog::debug("Changes: {} spawned, {} exited, {} exec'd, {} migrated",
+	              global.changes.count(prox::process_change::kind::spawn),
+	              global.changes.count(prox::process_change::kind::exit),
+	              global.changes.count(prox::process_change::kind::exec),
+	              global.changes.count(prox::process_change::kind::migrate));
+
 	// Print the process tree
 	if (options.debug)
 	{
@@ -170,19 +230,37 @@ void update_tree()
 
 void most_CPU_consuming_procs()
 {
-	const auto high_cpu_use = [&](const auto & proc) {
-		return proc.cpu_use() > options.cpu_use;
-	};
-
-	auto heavy_proc = global.processes | ranges::views::filter(high_cpu_use);
-
-	spdlog::info("Most CPU consuming processes ({}%):", options.cpu_use);
-	for (const auto & cpu_proc : heavy_proc)
-	{
+	const auto print_proc = [](const auto & cpu_proc) {
 		const auto update_seconds_ago =
 		    std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - cpu_proc.last_update()).count();
 		spdlog::info("\tPID {}. Update {} ago. CPU {} at {:>.2f}%. \"{}\"", cpu_proc.pid(),
 		             format_seconds(update_seconds_ago), cpu_proc.processor(), cpu_proc.cpu_use(), cpu_proc.cmdline());
+	};
+
+	spdlog::info("Most CPU consuming processes ({}%):", options.cpu_use);
+
+	if (options.top == 0)
+	{
+		// Scan the CPU use column, and only look up the processes above the threshold
+		const auto high_cpu_use = [&](const auto & row) {
+			return row.cpu_use() > options.cpu_use;
+		};
+
+		for (const auto & row : global.processes.columns().rows() | ranges::views::filter(high_cpu_use))
+		{
+			print_proc(global.processes.find(row.pid()));
+		}
+		return;
+	}
+
+	// The processes are ranked by CPU use on every update: only look up the --top ones
+	const auto high_cpu_use = [&](const auto & ranked) {
+		return ranked.value > static_cast<double>(options.cpu_use);
+	};
+
+	for (const auto & ranked : global.processes.top_cpu(options.top) | ranges::views::take_while(high_cpu_use))
+	{
+		print_proc(global.processes.find(ranked.pid));
 	}
 }
 
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <sys/types.h> // for pid_t
+
+#include <cstddef> // for size_t
+#include <span>    // for span
+#include <vector>  // for vector
+
+namespace prox
+{
+	// Change of one process between two updates of a process tree
+	struct process_change
+	{
+		enum class kind
+		{
+			spawn,  // "pid" is new in the tree
+			exit,   // "pid" has left the tree (finished, or not a descendant of the root anymore)
+			exec,   // "pid" has a new program image (its comm or cmdline has changed, or the kernel reported an exec)
+			migrate // "pid" has moved from "old_processor" (on "old_node") to "new_processor" (on "new_node")
+		};
+
+		kind  what = kind::spawn;
+		pid_t pid  = -1;
+
+		int old_processor = -1;
+		int new_processor = -1;
+		int old_node      = -1;
+		int new_node      = -1;
+	};
+
+	// Changes of one update of a process tree (see process_tree::update(change_log &)). The log is cleared by every
+	// update, but keeps its memory, so the same log can be reused on every tick without allocating.
+	class change_log
+	{
+		std::vector<process_change> changes_{};
+
+	public:
+		void clear() { changes_.clear(); }
+
+		void record(const process_change & change) { changes_.emplace_back(change); }
+
+		void record(const process_change::kind what, const pid_t pid) { changes_.push_back({ what, pid }); }
+
+		[[nodiscard]] auto size() const { return changes_.size(); }
+
+		[[nodiscard]] auto empty() const { return changes_.empty(); }
+
+		[[nodiscard]] auto changes() const -> std::span<const process_change> { return changes_; }
+
+		[[nodiscard]] auto begin() const { return changes_.begin(); }
+
+		[[nodiscard]] auto end() const { return changes_.end(); }
+
+		// Number of changes of kind "what"
+		[[nodiscard]] auto count(const process_change::kind what) const
+		{
+			std::size_t n = 0;
+			for (const auto & change : changes_)
+			{
+				if (change.what == what) { ++n; }
+			}
+			return n;
+		}
+	};
+} // namespace prox
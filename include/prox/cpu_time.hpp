@@ -1,16 +1,25 @@
 #pragma once
 
-#include <unistd.h> // for sysconf, _SC_NPROCESSORS_ONLN
-
-#include <filesystem> // for path
-#include <fstream>    // for ifstream, basic_istream, operator>>, basic_ostream, getline
-#include <string>     // for string, getline
-#include <utility>    // for cmp_less_equal
+#include <fcntl.h>  // for open, O_RDONLY, O_CLOEXEC
+#include <unistd.h> // for sysconf, _SC_NPROCESSORS_ONLN, pread
+
+#include <array>       // for array
+#include <cerrno>      // for errno
+#include <cstdint>     // for uint64_t
+#include <cstring>     // for strerror
+#include <filesystem>  // for path
+#include <span>        // for span
+#include <string>      // for string
+#include <string_view> // for string_view
+#include <utility>     // for cmp_less_equal
 
 #include <fmt/core.h> // for format
 
 #include <range/v3/view/all.hpp> // for views::split, views::transform, views::trim_if
 
+#include "fd_cache.hpp"  // for unique_fd
+#include "tokenizer.hpp" // for tokenize, decode_integers
+
 namespace prox
 {
 	class CPU_time
@@ -51,25 +60,28 @@ namespace prox
 				throw std::runtime_error(error_str);
 			}
 
-			std::istringstream iss(line);
+			const std::string_view line_view(line);
 
-			// Make sure we have the right number of fields
-			std::size_t                  n_fields        = 0;
+			// Make sure we have the right number of fields (one more to detect unexpected ones)
 			static constexpr std::size_t EXPECTED_FIELDS = 11;
 
-			const auto read_field = [&iss, &n_fields](auto & field) {
-				if (iss.eof())
-				{
-					const auto error_str = fmt::format("Could not read {}th field", n_fields);
-					throw std::runtime_error(error_str);
-				}
+			std::array<field, EXPECTED_FIELDS + 1> fields;
+
+			const auto n_fields = tokenize(line_view, fields);
+
+			if (n_fields < EXPECTED_FIELDS)
+			{
+				const auto error_str = fmt::format("Could not read {}th field", n_fields);
+				throw std::runtime_error(error_str);
+			}
 
-				iss >> field;
-				++n_fields;
-			};
+			if (n_fields > EXPECTED_FIELDS)
+			{
+				const auto error_str = fmt::format("File has more than {} fields", EXPECTED_FIELDS);
+				throw std::runtime_error(error_str);
+			}
 
-			std::string cpu_str; // = "cpu "
-			read_field(cpu_str);
+			const auto cpu_str = line_view.substr(fields[0].begin, fields[0].size()); // = "cpu"
 
 			if (not cpu_str.starts_with("cpu"))
 			{
@@ -77,24 +89,26 @@ namespace prox
 				throw std::runtime_error(error_str);
 			}
 
-			read_field(user_time_);
-			read_field(nice_time_);
-			read_field(system_time_);
-			read_field(idle_time_);
-			read_field(io_wait_);
-			read_field(irq_);
-			read_field(soft_irq_);
-			read_field(steal_);
-			read_field(guest_);
-			read_field(guest_nice_);
-
-			// We should have read all the fields
-			if (not iss.eof())
+			std::array<std::uint64_t, EXPECTED_FIELDS - 1> values;
+
+			if (const auto n_decoded = decode_integers(line_view, std::span(fields).subspan(1, values.size()), values);
+			    n_decoded not_eq values.size())
 			{
-				const auto error_str = fmt::format("File has more than {} fields", EXPECTED_FIELDS);
+				const auto error_str = fmt::format("Could not read {}th field", n_decoded + 1);
 				throw std::runtime_error(error_str);
 			}
 
+			user_time_   = values[0];
+			nice_time_   = values[1];
+			system_time_ = values[2];
+			idle_time_   = values[3];
+			io_wait_     = values[4];
+			irq_         = values[5];
+			soft_irq_    = values[6];
+			steal_       = values[7];
+			guest_       = values[8];
+			guest_nice_  = values[9];
+
 			// Guest time is already accounted in user time
 			user_time_ = user_time_ - guest_;
 			nice_time_ = nice_time_ - guest_nice_;
@@ -148,23 +162,40 @@ namespace prox
 
 		[[nodiscard]] auto period() const { return period_; }
 
-		void update(const std::filesystem::path & stat = FILE_CPU_STAT)
+		// Update from the first (aggregate) line of a /proc/stat file that has been read already
+		void update_from(const std::string_view line) { scan_cpu_time(line); }
+
+		// Read the first line of "stat" (without allocating)
+		void update(const char * stat)
 		{
-			std::ifstream file(stat, std::ios::in);
+			static constexpr std::size_t BUFFER_SIZE = 1024;
+
+			const unique_fd fd(::open(stat, O_RDONLY | O_CLOEXEC));
+
+			if (std::cmp_equal(fd.get(), -1))
+			{
+				const auto error_str = fmt::format("Could not open file {}. Error {} ({})", stat, errno, strerror(errno));
+				throw std::runtime_error(error_str);
+			}
+
+			std::array<char, BUFFER_SIZE> buffer;
 
-			if (not file.is_open())
+			const auto n_read = ::pread(fd.get(), buffer.data(), buffer.size(), 0);
+
+			if (std::cmp_less(n_read, 0))
 			{
-				const auto error_str =
-				    fmt::format("Could not open file {}. Error {} ({})", stat.string(), errno, strerror(errno));
+				const auto error_str = fmt::format("Could not read file {}. Error {} ({})", stat, errno, strerror(errno));
 				throw std::runtime_error(error_str);
 			}
 
-			// Get only the first line as std::isstream
-			std::string first_line;
-			std::getline(file, first_line);
+			const std::string_view contents(buffer.data(), static_cast<std::size_t>(n_read));
 
-			scan_cpu_time(first_line);
+			scan_cpu_time(contents.substr(0, contents.find('\n')));
 		}
+
+		void update(const std::filesystem::path & stat) { update(stat.c_str()); }
+
+		void update() { update(FILE_CPU_STAT); }
 	};
 
 } // namespace prox
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <dirent.h>      // for DT_DIR, DT_UNKNOWN
+#include <fcntl.h>       // for open, O_RDONLY, O_DIRECTORY, O_CLOEXEC, AT_SYMLINK_NOFOLLOW
+#include <sys/stat.h>    // for fstatat, S_ISDIR
+#include <sys/syscall.h> // for SYS_getdents64
+#include <sys/types.h>   // for pid_t, ino64_t, off64_t
+#include <unistd.h>      // for syscall, lseek, close
+
+#include <cerrno>      // for errno
+#include <cstddef>     // for size_t, offsetof
+#include <cstring>     // for strerror
+#include <filesystem>  // for path
+#include <limits>      // for numeric_limits
+#include <memory>      // for unique_ptr, make_unique
+#include <stdexcept>   // for runtime_error
+#include <string_view> // for string_view
+#include <utility>     // for cmp_less, cmp_equal
+
+#include <fmt/core.h> // for format
+
+namespace prox
+{
+	// Parse a directory name made only of digits (e.g. "/proc/1234" or "/proc/1234/task/1235") into a PID.
+	// Returns -1 for any other name.
+	[[nodiscard]] static constexpr auto parse_pid(const char * name) -> pid_t
+	{
+		if (*name == '\0') { return -1; }
+
+		pid_t pid = 0;
+
+		for (; *name not_eq '\0'; ++name)
+		{
+			const auto digit = *name - '0';
+
+			if (digit < 0 or digit > 9) { return -1; }
+			if (pid > (std::numeric_limits<pid_t>::max() - digit) / 10) { return -1; }
+
+			pid = pid * 10 + digit;
+		}
+
+		return pid;
+	}
+
+	// Lists the numeric subdirectories of a directory (the PIDs in /proc, the TIDs in /proc/<pid>/task) with raw
+	// getdents64 calls on a buffer that is allocated once, so scanning does not allocate.
+	class pid_scanner
+	{
+	public:
+		static constexpr std::size_t DEFAULT_BUFFER_SIZE = 32 * 1024;
+
+	private:
+		// Layout of the records returned by getdents64 (not exposed by glibc before 2.30)
+		struct linux_dirent64
+		{
+			ino64_t        d_ino;
+			off64_t        d_off;
+			unsigned short d_reclen;
+			unsigned char  d_type;
+			char           d_name[1];
+		};
+
+		std::size_t buffer_size_ = DEFAULT_BUFFER_SIZE;
+
+		std::unique_ptr<char[]> buffer_ = std::make_unique<char[]>(buffer_size_);
+
+		// Not every file system fills d_type (procfs does)
+		[[nodiscard]] static auto is_directory(const int dir_fd, const linux_dirent64 & entry) -> bool
+		{
+			if (entry.d_type not_eq DT_UNKNOWN) { return entry.d_type == DT_DIR; }
+
+			struct ::stat sstat;
+			if (std::cmp_equal(::fstatat(dir_fd, entry.d_name, &sstat, AT_SYMLINK_NOFOLLOW), -1)) { return false; }
+			return S_ISDIR(sstat.st_mode);
+		}
+
+	public:
+		pid_scanner() = default;
+
+		explicit pid_scanner(const std::size_t buffer_size) :
+		    buffer_size_(buffer_size), buffer_(std::make_unique<char[]>(buffer_size_))
+		{
+		}
+
+		// Call "fn(pid)" for every numeric subdirectory of the directory open in "dir_fd".
+		// The directory is rewound first, so the same descriptor can be scanned on every update.
+		template<typename Fn>
+		void scan(const int dir_fd, Fn && fn)
+		{
+			if (std::cmp_equal(::lseek(dir_fd, 0, SEEK_SET), -1))
+			{
+				throw std::runtime_error(fmt::format("Could not rewind directory. Error: {}", std::strerror(errno)));
+			}
+
+			while (true)
+			{
+				const auto n_read = ::syscall(SYS_getdents64, dir_fd, buffer_.get(), buffer_size_);
+
+				if (std::cmp_less(n_read, 0))
+				{
+					throw std::runtime_error(fmt::format("Could not read directory. Error: {}", std::strerror(errno)));
+				}
+
+				if (n_read == 0) { return; }
+
+				for (long offset = 0; offset < n_read;)
+				{
+					const auto & entry = *reinterpret_cast<const linux_dirent64 *>(buffer_.get() + offset);
+					offset += entry.d_reclen;
+
+					const auto pid = parse_pid(entry.d_name);
+
+					if (std::cmp_less(pid, 0) or not is_directory(dir_fd, entry)) { continue; }
+
+					fn(pid);
+				}
+			}
+		}
+
+		// Call "fn(pid)" for every numeric subdirectory of "dir". Throws if the directory cannot be opened.
+		template<typename Fn>
+		void scan(const std::filesystem::path & dir, Fn && fn)
+		{
+			const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+			if (std::cmp_equal(dir_fd, -1))
+			{
+				const auto error =
+				    fmt::format("Could not open directory {}. Error: {}", dir.string(), std::strerror(errno));
+				throw std::runtime_error(error);
+			}
+
+			try
+			{
+				scan(dir_fd, fn);
+			}
+			catch (...)
+			{
+				::close(dir_fd);
+				throw;
+			}
+
+			::close(dir_fd);
+		}
+	};
+} // namespace prox
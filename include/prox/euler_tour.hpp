@@ -0,0 +1,137 @@
+#pragma once
+
+#include <sys/types.h> // for pid_t
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint32_t
+#include <limits>  // for numeric_limits
+#include <numeric> // for partial_sum
+#include <span>    // for span
+#include <vector>  // for vector
+
+namespace prox
+{
+	// Pre-order (Euler tour) of a forest given by the parent of every row. The subtree of a row is a contiguous range
+	// of the tour, [enter, exit), so checking whether a row is in the subtree of another one is O(1) and its
+	// descendants are a span, without allocating. Building it is O(n), and the memory is kept across builds.
+	class euler_tour
+	{
+	public:
+		static constexpr std::size_t NO_PARENT = std::numeric_limits<std::size_t>::max();
+
+	private:
+		using pos_t = std::uint32_t;
+
+		static constexpr pos_t NOT_VISITED = std::numeric_limits<pos_t>::max();
+
+		std::vector<pid_t> order_{}; // PIDs in pre-order
+
+		std::vector<pos_t> enter_{}; // Row -> position in order_
+		std::vector<pos_t> exit_{};  // Row -> one past the last position of its subtree
+
+		// Temporaries of build()
+		std::vector<pos_t> first_{};  // Rows [first_[p], first_[p + 1]) of linked_ are the children of row p
+		std::vector<pos_t> linked_{};
+		std::vector<pos_t> rows_{};   // Position -> row
+		std::vector<pos_t> to_visit_{};
+
+	public:
+		// Tour the rows: "pids[r]" is the PID of row r and "parent_of[r]" the row of its parent (NO_PARENT for roots).
+		// Rows in a cycle of parents are not reachable from any root and are left out.
+		void build(const std::span<const pid_t> pids, const std::span<const std::size_t> parent_of)
+		{
+			const auto n_rows = pids.size();
+
+			// Counting sort of the rows by parent
+			first_.assign(n_rows + 1, 0);
+			for (const auto parent : parent_of)
+			{
+				if (parent not_eq NO_PARENT) { ++first_[parent + 1]; }
+			}
+
+			std::partial_sum(first_.begin(), first_.end(), first_.begin());
+
+			linked_.resize(first_.back());
+			exit_.assign(first_.begin(), first_.end() - 1); // Next free position of every parent, for now
+			for (std::size_t r = 0; r < n_rows; ++r)
+			{
+				if (parent_of[r] not_eq NO_PARENT) { linked_[exit_[parent_of[r]]++] = static_cast<pos_t>(r); }
+			}
+
+			// Depth-first from every root
+			order_.clear();
+			rows_.clear();
+			enter_.assign(n_rows, NOT_VISITED);
+
+			for (std::size_t root = 0; root < n_rows; ++root)
+			{
+				if (parent_of[root] not_eq NO_PARENT) { continue; }
+
+				to_visit_.emplace_back(static_cast<pos_t>(root));
+
+				while (not to_visit_.empty())
+				{
+					const auto r = to_visit_.back();
+					to_visit_.pop_back();
+
+					enter_[r] = static_cast<pos_t>(order_.size());
+					order_.emplace_back(pids[r]);
+					rows_.emplace_back(r);
+
+					// Reversed, so the children are visited in the order of their rows
+					for (auto i = first_[r + 1]; i > first_[r]; --i)
+					{
+						to_visit_.emplace_back(linked_[i - 1]);
+					}
+				}
+			}
+
+			// Size of every subtree, children before parents, then its end
+			exit_.assign(n_rows, 1);
+			for (auto pos = rows_.size(); pos > 0; --pos)
+			{
+				const auto r = rows_[pos - 1];
+				if (parent_of[r] not_eq NO_PARENT) { exit_[parent_of[r]] += exit_[r]; }
+			}
+
+			for (const auto r : rows_)
+			{
+				exit_[r] += enter_[r];
+			}
+		}
+
+		void clear()
+		{
+			order_.clear();
+			rows_.clear();
+			enter_.clear();
+			exit_.clear();
+		}
+
+		// Number of rows in the tour
+		[[nodiscard]] auto size() const { return order_.size(); }
+
+		[[nodiscard]] auto order() const -> std::span<const pid_t> { return order_; }
+
+		// Rows in pre-order: every row comes after its parent
+		[[nodiscard]] auto rows() const -> std::span<const std::uint32_t> { return rows_; }
+
+		[[nodiscard]] auto visited(const std::size_t row) const
+		{
+			return row < enter_.size() and enter_[row] not_eq NOT_VISITED;
+		}
+
+		// Whether row "a" is in the subtree of row "b" ("b" included), O(1)
+		[[nodiscard]] auto within(const std::size_t a, const std::size_t b) const
+		{
+			return visited(a) and visited(b) and enter_[b] <= enter_[a] and enter_[a] < exit_[b];
+		}
+
+		// PIDs of the descendants of row "r" ("r" excluded), in pre-order. Valid until the next build.
+		[[nodiscard]] auto descendants(const std::size_t r) const -> std::span<const pid_t>
+		{
+			if (not visited(r)) { return {}; }
+			return std::span(order_).subspan(enter_[r] + 1, exit_[r] - enter_[r] - 1);
+		}
+	};
+} // namespace prox
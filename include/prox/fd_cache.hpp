@@ -0,0 +1,387 @@
+#pragma once
+
+#include <fcntl.h>        // for open, openat, AT_FDCWD, O_PATH, O_DIRECTORY, O_RDONLY, O_CLOEXEC
+#include <sys/resource.h> // for getrlimit, RLIMIT_NOFILE
+#include <sys/stat.h>     // for fstat
+#include <sys/types.h>    // for pid_t, ssize_t
+#include <unistd.h>       // for pread, close
+
+#include <algorithm>     // for sort
+#include <array>         // for array
+#include <cerrno>        // for errno, EINTR
+#include <cstddef>       // for size_t
+#include <cstdint>       // for uint64_t
+#include <cstring>       // for strerror
+#include <filesystem>    // for path
+#include <stdexcept>     // for runtime_error
+#include <string>        // for string
+#include <string_view>   // for string_view
+#include <unordered_map> // for unordered_map
+#include <utility>       // for exchange, cmp_less, cmp_equal
+#include <vector>        // for vector
+
+#include <fmt/core.h> // for format
+
+namespace prox
+{
+	// Files of a task that are re-read on every update
+	enum class proc_file : unsigned
+	{
+		dir, // O_PATH descriptor of the task folder, which the rest are opened relative to
+		stat,
+		children,
+		schedstat, // Only if tracked, see process::track_schedstat()
+		count
+	};
+
+	// Owning file descriptor (closed on destruction)
+	class unique_fd
+	{
+		int fd_ = -1;
+
+	public:
+		unique_fd() = default;
+
+		explicit unique_fd(const int fd) : fd_(fd) {}
+
+		unique_fd(const unique_fd &)                     = delete;
+		auto operator=(const unique_fd &) -> unique_fd & = delete;
+
+		unique_fd(unique_fd && other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+
+		auto operator=(unique_fd && other) noexcept -> unique_fd &
+		{
+			if (this not_eq &other) { reset(std::exchange(other.fd_, -1)); }
+			return *this;
+		}
+
+		~unique_fd() { reset(); }
+
+		[[nodiscard]] auto get() const { return fd_; }
+
+		// Give up the ownership of the descriptor
+		[[nodiscard]] auto release() { return std::exchange(fd_, -1); }
+
+		void reset(const int fd = -1)
+		{
+			if (std::cmp_not_equal(fd_, -1)) { ::close(fd_); }
+			fd_ = fd;
+		}
+	};
+
+	// Open a procfs file. Throws if the file cannot be opened.
+	[[nodiscard]] static inline auto open_proc_file(const std::filesystem::path & path) -> int
+	{
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (std::cmp_equal(fd, -1))
+		{
+			const auto error = fmt::format("Could not open file {}. Error: {}", path.string(), std::strerror(errno));
+			throw std::runtime_error(error);
+		}
+
+		return fd;
+	}
+
+	// Open the file "name" of the directory open in "dir_fd" (e.g. an O_PATH descriptor of /proc/<pid>/task/<tid>).
+	// Throws if the file cannot be opened.
+	[[nodiscard]] static inline auto open_proc_file(const int dir_fd, const char * name) -> int
+	{
+		const int fd = ::openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+
+		if (std::cmp_equal(fd, -1))
+		{
+			const auto error = fmt::format("Could not open file {}. Error: {}", name, std::strerror(errno));
+			throw std::runtime_error(error);
+		}
+
+		return fd;
+	}
+
+	// Open the folder "dir" (e.g. /proc/<pid>/task/<tid>) as an O_PATH descriptor, to open its files relative to it.
+	// Throws if the folder cannot be opened.
+	[[nodiscard]] static inline auto open_proc_dir(const std::string_view dir) -> int
+	{
+		thread_local std::string path;
+		path.assign(dir);
+
+		const int fd = ::open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+		if (std::cmp_equal(fd, -1))
+		{
+			const auto error = fmt::format("Could not open folder {}. Error: {}", path, std::strerror(errno));
+			throw std::runtime_error(error);
+		}
+
+		return fd;
+	}
+
+	// Open the file "name" of the folder "dir" (e.g. /proc/<pid>/task/<tid>). Throws if the file cannot be opened.
+	[[nodiscard]] static inline auto open_proc_file(const std::string_view dir, const char * name) -> int
+	{
+		thread_local std::string path;
+		path.assign(dir).append("/").append(name);
+		return open_proc_file(AT_FDCWD, path.c_str());
+	}
+
+	// Read a whole procfs file from the beginning into "buffer" (which grows as needed).
+	// Returns the number of bytes read. Throws if the read fails (e.g. the task has exited). "name" is only used for
+	// error messages.
+	static inline auto pread_proc_file(const int fd, const std::string_view name, std::string & buffer) -> std::size_t
+	{
+		static constexpr std::size_t MIN_BUFFER_SIZE = 512;
+
+		if (buffer.size() < MIN_BUFFER_SIZE) { buffer.resize(MIN_BUFFER_SIZE); }
+
+		std::size_t n_read = 0;
+
+		while (true)
+		{
+			const auto n = ::pread(fd, buffer.data() + n_read, buffer.size() - n_read, static_cast<off_t>(n_read));
+
+			if (std::cmp_less(n, 0))
+			{
+				if (errno == EINTR) { continue; }
+
+				const auto error =
+				    fmt::format("Could not read file {}. Error: {}", name, std::strerror(errno));
+				throw std::runtime_error(error);
+			}
+
+			n_read += static_cast<std::size_t>(n);
+
+			// procfs fills the whole buffer unless the end of the file was reached
+			if (n_read < buffer.size()) { break; }
+
+			buffer.resize(buffer.size() * 2);
+		}
+
+		return n_read;
+	}
+
+	// Owner of the task that the file open in "fd" belongs to: the files of a task belong to the same user as its
+	// folder. Throws if the file cannot be stat'ed. "name" is only used for error messages.
+	[[nodiscard]] static inline auto proc_file_uid(const int fd, const std::string_view name) -> uid_t
+	{
+		struct ::stat sstat;
+
+		if (std::cmp_equal(::fstat(fd, &sstat), -1))
+		{
+			const auto error = fmt::format("Could not stat file {}. Error: {}", name, std::strerror(errno));
+			throw std::runtime_error(error);
+		}
+
+		return sstat.st_uid;
+	}
+
+	// Cache of open procfs file descriptors that stays valid across process_tree updates.
+	// Entries are keyed by (pid, starttime), so a recycled PID never reuses the descriptors of the previous task.
+	// The number of open descriptors is capped. Once the cap is reached, new descriptors are not cached (the caller
+	// opens and closes them on every read) and the cached ones stay: the tree is walked in the same order on every
+	// update, so evicting to make room would close every descriptor before it is read again. Room is only made when
+	// tasks are erased (e.g. they exit) or the cap is lowered, which closes the least recently read tasks first.
+	class fd_cache
+	{
+	public:
+		struct key
+		{
+			pid_t         pid{};
+			std::uint64_t starttime{};
+
+			[[nodiscard]] auto operator==(const key & other) const -> bool = default;
+		};
+
+	private:
+		using fds_t = std::array<int, static_cast<std::size_t>(proc_file::count)>;
+
+		struct entry
+		{
+			key           key_{};
+			fds_t         fds_{};
+			std::uint64_t last_read_ = 0; // Value of reads_ when last found or inserted
+		};
+
+		using entries_t = std::unordered_map<pid_t, entry>;
+
+		std::size_t   max_open_fds_ = default_max_open_fds();
+		std::size_t   open_fds_     = 0;
+		std::uint64_t reads_        = 0; // Clock of the entries, see entry::last_read_
+
+		entries_t entries_{};
+
+		[[nodiscard]] static auto default_max_open_fds() -> std::size_t
+		{
+			static constexpr std::size_t FALLBACK = 512;
+
+			// Leave half of the descriptors to the rest of the application
+			rlimit limit{};
+			if (std::cmp_equal(::getrlimit(RLIMIT_NOFILE, &limit), -1) or limit.rlim_cur == RLIM_INFINITY)
+			{
+				return FALLBACK;
+			}
+
+			return static_cast<std::size_t>(limit.rlim_cur / 2);
+		}
+
+		[[nodiscard]] static auto slot(const proc_file file) { return static_cast<std::size_t>(file); }
+
+		void close_fds(entry & e)
+		{
+			for (auto & fd : e.fds_)
+			{
+				if (std::cmp_equal(fd, -1)) { continue; }
+				::close(std::exchange(fd, -1));
+				--open_fds_;
+			}
+		}
+
+		auto erase(const typename entries_t::iterator it)
+		{
+			close_fds(it->second);
+			return entries_.erase(it);
+		}
+
+		// Close the descriptors of the least recently read tasks until the cap is met again. O(n log n), but only
+		// when the cap is lowered.
+		void shrink()
+		{
+			if (open_fds_ <= max_open_fds_) { return; }
+
+			std::vector<typename entries_t::iterator> by_last_read;
+			by_last_read.reserve(entries_.size());
+			for (auto it = entries_.begin(); it not_eq entries_.end(); ++it)
+			{
+				by_last_read.emplace_back(it);
+			}
+
+			std::sort(by_last_read.begin(), by_last_read.end(),
+			          [](const auto & a, const auto & b) { return a->second.last_read_ < b->second.last_read_; });
+
+			for (auto it = by_last_read.begin(); open_fds_ > max_open_fds_ and it not_eq by_last_read.end(); ++it)
+			{
+				erase(*it);
+			}
+		}
+
+	public:
+		fd_cache() = default;
+
+		explicit fd_cache(const std::size_t max_open_fds) : max_open_fds_(max_open_fds) {}
+
+		fd_cache(const fd_cache &)                     = delete;
+		auto operator=(const fd_cache &) -> fd_cache & = delete;
+
+		fd_cache(fd_cache && other) noexcept :
+		    max_open_fds_(other.max_open_fds_),
+		    open_fds_(std::exchange(other.open_fds_, 0)),
+		    reads_(other.reads_),
+		    entries_(std::move(other.entries_))
+		{
+		}
+
+		auto operator=(fd_cache && other) noexcept -> fd_cache &
+		{
+			if (this == &other) { return *this; }
+			clear();
+			max_open_fds_ = other.max_open_fds_;
+			open_fds_     = std::exchange(other.open_fds_, 0);
+			reads_        = other.reads_;
+			entries_      = std::move(other.entries_);
+			return *this;
+		}
+
+		~fd_cache() { clear(); }
+
+		// Cached descriptor of "file" for the task "k", or -1 if it is not cached
+		[[nodiscard]] auto find(const key & k, const proc_file file) -> int
+		{
+			const auto it = entries_.find(k.pid);
+			if (it == entries_.end()) { return -1; }
+
+			// Same PID, different task: the old one has exited
+			if (it->second.key_ not_eq k)
+			{
+				erase(it);
+				return -1;
+			}
+
+			it->second.last_read_ = ++reads_;
+
+			return it->second.fds_[slot(file)];
+		}
+
+		// Hand "fd" over to the cache. Returns false (and closes "fd") if it could not be cached, e.g. the cache is
+		// full.
+		auto insert(const key & k, const proc_file file, const int fd) -> bool
+		{
+			auto it = entries_.find(k.pid);
+
+			// Same PID, different task: the old one has exited
+			if (it not_eq entries_.end() and it->second.key_ not_eq k)
+			{
+				erase(it);
+				it = entries_.end();
+			}
+
+			// Replacing a cached descriptor does not need room
+			if (it not_eq entries_.end())
+			{
+				if (auto & cached = it->second.fds_[slot(file)]; std::cmp_not_equal(cached, -1))
+				{
+					::close(std::exchange(cached, fd));
+					it->second.last_read_ = ++reads_;
+					return true;
+				}
+			}
+
+			if (open_fds_ >= max_open_fds_)
+			{
+				::close(fd);
+				return false;
+			}
+
+			if (it == entries_.end())
+			{
+				entry e{ k, {} };
+				e.fds_.fill(-1);
+				it = entries_.try_emplace(k.pid, e).first;
+			}
+
+			it->second.fds_[slot(file)] = fd;
+			it->second.last_read_       = ++reads_;
+			++open_fds_;
+
+			return true;
+		}
+
+		// Close the descriptors of the task "k"
+		void erase(const key & k)
+		{
+			const auto it = entries_.find(k.pid);
+			if (it == entries_.end() or it->second.key_ not_eq k) { return; }
+			erase(it);
+		}
+
+		void clear()
+		{
+			for (auto & [pid, e] : entries_)
+			{
+				close_fds(e);
+			}
+			entries_.clear();
+		}
+
+		[[nodiscard]] auto max_open_fds() const { return max_open_fds_; }
+
+		// Lowering the cap closes the descriptors of the least recently read tasks, until it is met
+		void max_open_fds(const std::size_t max_open_fds)
+		{
+			max_open_fds_ = max_open_fds;
+			shrink();
+		}
+
+		[[nodiscard]] auto open_fds() const { return open_fds_; }
+
+		[[nodiscard]] auto size() const { return entries_.size(); }
+	};
+} // namespace prox
@@ -0,0 +1,657 @@
+#pragma once
+
+#include <fcntl.h>          // for openat, AT_FDCWD, AT_EMPTY_PATH, O_RDONLY
+#include <linux/io_uring.h> // for io_uring_params, io_uring_sqe, io_uring_cqe, IORING_*
+#include <sys/mman.h>       // for mmap, munmap
+#include <sys/stat.h>       // for statx, STATX_UID
+#include <sys/syscall.h>    // for __NR_io_uring_setup, __NR_io_uring_enter, __NR_io_uring_register
+#include <sys/uio.h>        // for iovec
+#include <unistd.h>         // for syscall, close
+
+#include <algorithm>   // for min, fill
+#include <atomic>      // for atomic_ref, memory_order
+#include <cerrno>      // for errno, EINTR, EBUSY
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t, uint8_t
+#include <cstring>     // for strerror, memset
+#include <initializer_list> // for initializer_list
+#include <memory>      // for unique_ptr
+#include <span>        // for span
+#include <stdexcept>   // for runtime_error
+#include <string>      // for string
+#include <string_view> // for string_view
+#include <utility>     // for exchange, cmp_less, cmp_equal
+#include <vector>      // for vector
+
+#include <fmt/core.h> // for format
+
+#include <range/v3/all.hpp> // for all_of
+
+#include "stat.hpp" // for STAT_BUFFER_SIZE
+
+namespace prox
+{
+	// Minimal io_uring ring on top of the raw system calls (no liburing dependency).
+	// Throws std::runtime_error if io_uring is not available (old kernel, seccomp, io_uring_disabled...).
+	class uring
+	{
+		int fd_ = -1;
+
+		io_uring_params params_{};
+
+		void *      sq_ring_      = nullptr;
+		void *      cq_ring_      = nullptr;
+		std::size_t sq_ring_size_ = 0;
+		std::size_t cq_ring_size_ = 0;
+
+		io_uring_sqe * sqes_      = nullptr;
+		std::size_t    sqes_size_ = 0;
+
+		unsigned * sq_head_  = nullptr;
+		unsigned * sq_tail_  = nullptr;
+		unsigned * sq_array_ = nullptr;
+		unsigned   sq_mask_  = 0;
+
+		unsigned *     cq_head_ = nullptr;
+		unsigned *     cq_tail_ = nullptr;
+		io_uring_cqe * cqes_    = nullptr;
+		unsigned       cq_mask_ = 0;
+
+		unsigned pending_ = 0; // SQEs queued but not submitted yet
+
+		[[nodiscard]] static auto at(void * base, const unsigned offset) -> unsigned *
+		{
+			return reinterpret_cast<unsigned *>(static_cast<std::uint8_t *>(base) + offset);
+		}
+
+		[[nodiscard]] static auto load_acquire(unsigned * p)
+		{
+			return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+		}
+
+		static void store_release(unsigned * p, const unsigned value)
+		{
+			std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+		}
+
+		[[nodiscard]] auto enter(const unsigned to_submit, const unsigned min_complete, const unsigned flags) const
+		{
+			return ::syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0);
+		}
+
+		[[nodiscard]] auto do_register(const unsigned opcode, const void * arg, const unsigned nr_args) const
+		{
+			return ::syscall(__NR_io_uring_register, fd_, opcode, arg, nr_args);
+		}
+
+		void release()
+		{
+			if (sqes_ not_eq nullptr) { ::munmap(sqes_, sqes_size_); }
+			if (cq_ring_ not_eq nullptr and cq_ring_ not_eq sq_ring_) { ::munmap(cq_ring_, cq_ring_size_); }
+			if (sq_ring_ not_eq nullptr) { ::munmap(sq_ring_, sq_ring_size_); }
+			if (fd_ not_eq -1) { ::close(fd_); }
+
+			sqes_    = nullptr;
+			cq_ring_ = nullptr;
+			sq_ring_ = nullptr;
+			fd_      = -1;
+		}
+
+		[[nodiscard]] static auto error(const std::string_view what)
+		{
+			return std::runtime_error(fmt::format("io_uring: {}. Error: {}", what, std::strerror(errno)));
+		}
+
+	public:
+		explicit uring(const unsigned entries)
+		{
+			fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params_));
+
+			if (std::cmp_less(fd_, 0))
+			{
+				fd_ = -1;
+				throw error("could not set up the ring");
+			}
+
+			sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+			cq_ring_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+
+			const bool single_mmap = (params_.features & IORING_FEAT_SINGLE_MMAP) not_eq 0;
+
+			if (single_mmap) { sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_); }
+
+			sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+			                  IORING_OFF_SQ_RING);
+			if (sq_ring_ == MAP_FAILED)
+			{
+				sq_ring_ = nullptr;
+				release();
+				throw error("could not map the submission ring");
+			}
+
+			if (single_mmap) { cq_ring_ = sq_ring_; }
+			else
+			{
+				cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+				                  IORING_OFF_CQ_RING);
+				if (cq_ring_ == MAP_FAILED)
+				{
+					cq_ring_ = nullptr;
+					release();
+					throw error("could not map the completion ring");
+				}
+			}
+
+			sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+			void * sqes =
+			    ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+			if (sqes == MAP_FAILED)
+			{
+				release();
+				throw error("could not map the submission entries");
+			}
+			sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+			sq_head_  = at(sq_ring_, params_.sq_off.head);
+			sq_tail_  = at(sq_ring_, params_.sq_off.tail);
+			sq_array_ = at(sq_ring_, params_.sq_off.array);
+			sq_mask_  = *at(sq_ring_, params_.sq_off.ring_mask);
+
+			cq_head_ = at(cq_ring_, params_.cq_off.head);
+			cq_tail_ = at(cq_ring_, params_.cq_off.tail);
+			cqes_    = reinterpret_cast<io_uring_cqe *>(static_cast<std::uint8_t *>(cq_ring_) + params_.cq_off.cqes);
+			cq_mask_ = *at(cq_ring_, params_.cq_off.ring_mask);
+		}
+
+		uring(const uring &)                     = delete;
+		auto operator=(const uring &) -> uring & = delete;
+		uring(uring &&)                          = delete;
+		auto operator=(uring &&) -> uring &      = delete;
+
+		~uring() { release(); }
+
+		[[nodiscard]] auto features() const { return params_.features; }
+
+		[[nodiscard]] auto sq_entries() const { return params_.sq_entries; }
+
+		[[nodiscard]] auto cq_entries() const { return params_.cq_entries; }
+
+		// True if the kernel implements all the given operations
+		[[nodiscard]] auto supports(std::initializer_list<unsigned> opcodes) const -> bool
+		{
+			static constexpr unsigned N_OPS = 256;
+
+			const auto size = sizeof(io_uring_probe) + N_OPS * sizeof(io_uring_probe_op);
+			const auto buffer = std::make_unique<std::uint8_t[]>(size);
+			auto *     probe  = reinterpret_cast<io_uring_probe *>(buffer.get());
+
+			if (std::cmp_less(do_register(IORING_REGISTER_PROBE, probe, N_OPS), 0)) { return false; }
+
+			return ranges::all_of(opcodes, [&](const unsigned op) {
+				return op <= probe->last_op and (probe->ops[op].flags & IO_URING_OP_SUPPORTED) not_eq 0;
+			});
+		}
+
+		// Register "buffers" so that reads can use IORING_OP_READ_FIXED. Returns false if it is not allowed
+		// (e.g. RLIMIT_MEMLOCK is too low).
+		[[nodiscard]] auto register_buffers(std::span<const iovec> buffers) const -> bool
+		{
+			return std::cmp_equal(
+			    do_register(IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())), 0);
+		}
+
+		// Register a table of "n" empty slots for direct descriptors (IORING_OP_OPENAT with file_index)
+		[[nodiscard]] auto register_sparse_files(const unsigned n) const -> bool
+		{
+			std::vector<int> fds(n, -1);
+			return std::cmp_equal(do_register(IORING_REGISTER_FILES, fds.data(), n), 0);
+		}
+
+		// Next free submission entry (zeroed), or nullptr if the submission queue is full
+		[[nodiscard]] auto get_sqe() -> io_uring_sqe *
+		{
+			const auto head = load_acquire(sq_head_);
+			const auto tail = *sq_tail_ + pending_;
+
+			if (tail - head >= params_.sq_entries) { return nullptr; }
+
+			const auto index = tail & sq_mask_;
+			auto *     sqe   = &sqes_[index];
+			std::memset(sqe, 0, sizeof(io_uring_sqe));
+
+			sq_array_[index] = index;
+			++pending_;
+
+			return sqe;
+		}
+
+		// Submit the queued entries and wait until "wait_nr" completions are available
+		void submit_and_wait(const unsigned wait_nr)
+		{
+			store_release(sq_tail_, *sq_tail_ + pending_);
+
+			auto to_submit = std::exchange(pending_, 0);
+
+			while (true)
+			{
+				const auto ret = enter(to_submit, wait_nr, IORING_ENTER_GETEVENTS);
+
+				if (std::cmp_less(ret, 0))
+				{
+					if (errno == EINTR) { continue; }
+					throw error("could not submit");
+				}
+
+				// Submitted entries are consumed even if we have to wait again
+				to_submit -= std::min(to_submit, static_cast<unsigned>(ret));
+				if (to_submit == 0) { return; }
+			}
+		}
+
+		// Consume the available completions
+		template<typename Fn>
+		auto for_each_cqe(Fn && fn) -> unsigned
+		{
+			auto       head = *cq_head_;
+			const auto tail = load_acquire(cq_tail_);
+
+			unsigned n = 0;
+			for (; head not_eq tail; ++head, ++n)
+			{
+				fn(cqes_[head & cq_mask_]);
+			}
+
+			store_release(cq_head_, head);
+
+			return n;
+		}
+	};
+
+	// Size of the buffer for the children file of a task. Longer files are read synchronously.
+	constexpr static std::size_t CHILDREN_BUFFER_SIZE = 4096;
+
+	// Size of the buffer for the schedstat file of a task (three integers)
+	constexpr static std::size_t SCHEDSTAT_BUFFER_SIZE = 128;
+
+	// Result of collecting the files of one task through io_uring
+	struct uring_result
+	{
+		int stat_res      = -ECANCELED; // Bytes read from the stat file (or -errno)
+		int children_res  = -ECANCELED; // Bytes read from the children file (or -errno)
+		int schedstat_res = -ECANCELED; // Bytes read from the schedstat file (or -errno)
+		int statx_res     = -ECANCELED; // 0 if "stx" is valid (or -errno)
+
+		std::string_view stat{};      // Contents of the stat file
+		std::string_view children{};  // Contents of the children file
+		std::string_view schedstat{}; // Contents of the schedstat file
+
+		struct statx stx{};
+
+		// Descriptors opened synchronously for this task (if direct descriptors are not available), or -1. Closed
+		// once the results are consumed, unless the consumer takes them (setting them to -1), e.g. for an fd_cache.
+		int stat_fd      = -1;
+		int children_fd  = -1;
+		int schedstat_fd = -1;
+
+		[[nodiscard]] auto ok() const
+		{
+			return stat_res >= 0 and children_res >= 0 and schedstat_res >= 0 and statx_res == 0 and
+			       std::cmp_less(stat.size(), STAT_BUFFER_SIZE) and std::cmp_less(children.size(), CHILDREN_BUFFER_SIZE) and
+			       std::cmp_less(schedstat.size(), SCHEDSTAT_BUFFER_SIZE);
+		}
+	};
+
+	// Files of one task to collect. A descriptor of -1 means that the file has to be opened: relative to "dir_fd", or
+	// from the path "dir" if the folder is not open either.
+	struct uring_request
+	{
+		std::string_view dir{};      // Path of the task folder (/proc/<pid>/task/<tid>)
+		int              dir_fd = -1; // O_PATH descriptor of the task folder
+
+		int  stat_fd       = -1;
+		int  children_fd   = -1;
+		bool read_children = true; // False if the children are derived from ppid (see hierarchy_source)
+
+		int  schedstat_fd   = -1;
+		bool read_schedstat = false; // Only if tracked, see process::track_schedstat()
+	};
+
+	// Reads the stat, children and schedstat files (and the owner) of a batch of tasks with a few io_uring_enter() calls.
+	// Descriptors that are already open are read with IORING_OP_READ(_FIXED). The rest are opened, read and closed
+	// by a linked chain of requests on direct descriptors (if the kernel supports it) or opened synchronously and
+	// handed over in the results otherwise.
+	class uring_collector
+	{
+	public:
+		// Tasks collected per io_uring_enter()
+		static constexpr std::size_t BATCH_SIZE = 128;
+
+	private:
+		// Max SQEs per task: (openat + read + close) for stat, children and schedstat, plus statx
+		static constexpr unsigned SQES_PER_TASK = 10;
+
+		// Files per task (direct descriptors and paths)
+		static constexpr unsigned FILES_PER_TASK = 3;
+
+		static constexpr std::size_t SLOT_SIZE = STAT_BUFFER_SIZE + CHILDREN_BUFFER_SIZE + SCHEDSTAT_BUFFER_SIZE;
+
+		static constexpr const char * STAT_NAME      = "stat";
+		static constexpr const char * CHILDREN_NAME  = "children";
+		static constexpr const char * SCHEDSTAT_NAME = "schedstat";
+
+		enum op : std::uint64_t
+		{
+			read_stat,
+			read_children,
+			read_schedstat,
+			do_statx,
+			open_stat,
+			open_children,
+			open_schedstat,
+			close_file,
+			N_OPS
+		};
+
+		uring ring_{ static_cast<unsigned>(BATCH_SIZE) * SQES_PER_TASK };
+
+		std::unique_ptr<char[]> buffers_ = std::make_unique<char[]>(BATCH_SIZE * SLOT_SIZE);
+
+		bool fixed_buffers_ = false; // Buffers registered => IORING_OP_READ_FIXED
+		bool direct_open_   = false; // Linked openat -> read -> close on direct descriptors
+
+		std::vector<uring_result> results_{}; // Results of the current batch
+
+		std::vector<std::string> paths_ = std::vector<std::string>(FILES_PER_TASK * BATCH_SIZE); // Files to open, per slot
+
+		[[nodiscard]] auto stat_buffer(const std::size_t i) const { return buffers_.get() + i * SLOT_SIZE; }
+
+		[[nodiscard]] auto children_buffer(const std::size_t i) const
+		{
+			return buffers_.get() + i * SLOT_SIZE + STAT_BUFFER_SIZE;
+		}
+
+		[[nodiscard]] auto schedstat_buffer(const std::size_t i) const
+		{
+			return buffers_.get() + i * SLOT_SIZE + STAT_BUFFER_SIZE + CHILDREN_BUFFER_SIZE;
+		}
+
+		// Folder that the files of "request" are opened relative to
+		[[nodiscard]] static auto at_of(const uring_request & request)
+		{
+			return std::cmp_not_equal(request.dir_fd, -1) ? request.dir_fd : AT_FDCWD;
+		}
+
+		// Path of the file "name" of "request", relative to at_of(request). Kept until the batch is collected.
+		[[nodiscard]] auto path_of(const unsigned slot, const uring_request & request, const char * name)
+		    -> const char *
+		{
+			if (std::cmp_not_equal(request.dir_fd, -1)) { return name; }
+
+			auto & path = paths_[slot];
+			path.assign(request.dir).append("/").append(name);
+			return path.c_str();
+		}
+
+		[[nodiscard]] static auto user_data(const std::size_t i, const op o) -> std::uint64_t
+		{
+			return static_cast<std::uint64_t>(i) * N_OPS + o;
+		}
+
+		[[nodiscard]] auto next_sqe() -> io_uring_sqe &
+		{
+			auto * sqe = ring_.get_sqe();
+			// The ring is sized for a full batch, so this cannot happen
+			if (sqe == nullptr) { throw std::runtime_error("io_uring: submission queue is full"); }
+			return *sqe;
+		}
+
+		void prep_read(io_uring_sqe & sqe, const int fd, char * buffer, const std::size_t size) const
+		{
+			sqe.opcode = fixed_buffers_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+			sqe.fd     = fd;
+			sqe.addr   = reinterpret_cast<std::uint64_t>(buffer);
+			sqe.len    = static_cast<unsigned>(size);
+			sqe.off    = 0;
+			if (fixed_buffers_) { sqe.buf_index = 0; }
+		}
+
+		// Queue the requests to read one file. Returns the number of completions to wait for.
+		auto queue_file(const std::size_t i, const unsigned slot, const int at, const char * path, const int fd,
+		                char * buffer, const std::size_t size, const op read_op, const op open_op) -> unsigned
+		{
+			if (std::cmp_not_equal(fd, -1))
+			{
+				auto & read = next_sqe();
+				prep_read(read, fd, buffer, size);
+				read.user_data = user_data(i, read_op);
+				return 1;
+			}
+
+			auto & open = next_sqe();
+			open.opcode      = IORING_OP_OPENAT;
+			open.fd          = at;
+			open.addr        = reinterpret_cast<std::uint64_t>(path);
+			open.open_flags  = O_RDONLY; // O_CLOEXEC is not allowed (nor needed) for direct descriptors
+			open.file_index  = slot + 1;
+			open.flags       = IOSQE_IO_LINK;
+			open.user_data   = user_data(i, open_op);
+
+			auto & read = next_sqe();
+			prep_read(read, static_cast<int>(slot), buffer, size);
+			read.flags     = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK; // Close even if the read fails
+			read.user_data = user_data(i, read_op);
+
+			auto & close = next_sqe();
+			close.opcode     = IORING_OP_CLOSE;
+			close.file_index = slot + 1;
+			close.user_data  = user_data(i, close_file);
+
+			return 3;
+		}
+
+		auto queue_statx(const std::size_t i, const uring_request & request, const char * stat_path) -> unsigned
+		{
+			auto & sqe  = next_sqe();
+			sqe.opcode  = IORING_OP_STATX;
+			sqe.len     = STATX_UID;
+			sqe.off     = reinterpret_cast<std::uint64_t>(&results_[i].stx);
+			sqe.user_data = user_data(i, do_statx);
+
+			if (std::cmp_not_equal(request.stat_fd, -1))
+			{
+				// Owner of the task, as proc_file_uid() reads it
+				static constexpr const char * EMPTY_PATH = "";
+
+				sqe.fd           = request.stat_fd;
+				sqe.addr         = reinterpret_cast<std::uint64_t>(EMPTY_PATH);
+				sqe.statx_flags  = AT_EMPTY_PATH;
+			}
+			else
+			{
+				sqe.fd   = at_of(request);
+				sqe.addr = reinterpret_cast<std::uint64_t>(stat_path);
+			}
+
+			return 1;
+		}
+
+		// Open a file synchronously (when direct descriptors are not available) into "opened", a descriptor of the
+		// results
+		static auto open_now(const int at, const char * path, int & opened) -> int
+		{
+			opened = ::openat(at, path, O_RDONLY | O_CLOEXEC);
+			return opened;
+		}
+
+		// Close the descriptors opened synchronously that have not been taken from the results
+		void close_opened()
+		{
+			for (auto & result : results_)
+			{
+				for (auto * fd : { &result.stat_fd, &result.children_fd, &result.schedstat_fd })
+				{
+					if (std::cmp_not_equal(*fd, -1)) { ::close(std::exchange(*fd, -1)); }
+				}
+			}
+		}
+
+		void collect_batch(std::span<const uring_request> requests)
+		{
+			close_opened();
+			results_.assign(requests.size(), {});
+
+			unsigned expected = 0;
+
+			for (std::size_t i = 0; i < requests.size(); ++i)
+			{
+				const auto & request = requests[i];
+				const auto   slot    = static_cast<unsigned>(FILES_PER_TASK * i);
+
+				auto stat_fd      = request.stat_fd;
+				auto children_fd  = request.children_fd;
+				auto schedstat_fd = request.schedstat_fd;
+
+				const auto   at             = at_of(request);
+				const auto * stat_path      = path_of(slot, request, STAT_NAME);
+				const auto * children_path  = path_of(slot + 1, request, CHILDREN_NAME);
+				const auto * schedstat_path = path_of(slot + 2, request, SCHEDSTAT_NAME);
+
+				if (not direct_open_)
+				{
+					if (std::cmp_equal(stat_fd, -1)) { stat_fd = open_now(at, stat_path, results_[i].stat_fd); }
+					if (request.read_children and std::cmp_equal(children_fd, -1))
+					{
+						children_fd = open_now(at, children_path, results_[i].children_fd);
+					}
+					if (request.read_schedstat and std::cmp_equal(schedstat_fd, -1))
+					{
+						schedstat_fd = open_now(at, schedstat_path, results_[i].schedstat_fd);
+					}
+
+					if (std::cmp_equal(stat_fd, -1) or (request.read_children and std::cmp_equal(children_fd, -1)) or
+					    (request.read_schedstat and std::cmp_equal(schedstat_fd, -1)))
+					{
+						results_[i].stat_res = -errno;
+						continue;
+					}
+				}
+
+				expected +=
+				    queue_file(i, slot, at, stat_path, stat_fd, stat_buffer(i), STAT_BUFFER_SIZE, read_stat, open_stat);
+				if (request.read_children)
+				{
+					expected += queue_file(i, slot + 1, at, children_path, children_fd, children_buffer(i),
+					                       CHILDREN_BUFFER_SIZE, read_children, open_children);
+				}
+				else { results_[i].children_res = 0; } // Empty
+				if (request.read_schedstat)
+				{
+					expected += queue_file(i, slot + 2, at, schedstat_path, schedstat_fd, schedstat_buffer(i),
+					                       SCHEDSTAT_BUFFER_SIZE, read_schedstat, open_schedstat);
+				}
+				else { results_[i].schedstat_res = 0; } // Empty
+				expected += queue_statx(i, request, stat_path);
+			}
+
+			unsigned completed = 0;
+
+			while (completed < expected)
+			{
+				ring_.submit_and_wait(expected - completed);
+
+				completed += ring_.for_each_cqe([&](const io_uring_cqe & cqe) {
+					const auto i = static_cast<std::size_t>(cqe.user_data / N_OPS);
+					auto &     r = results_[i];
+
+					// A failed openat cancels the read linked to it: report the error of the openat instead
+					const auto set_res = [&](int & res) {
+						if (cqe.res == -ECANCELED and res not_eq -ECANCELED) { return; }
+						res = cqe.res;
+					};
+
+					switch (static_cast<op>(cqe.user_data % N_OPS))
+					{
+						case read_stat:
+							set_res(r.stat_res);
+							if (cqe.res >= 0) { r.stat = { stat_buffer(i), static_cast<std::size_t>(cqe.res) }; }
+							break;
+						case read_children:
+							set_res(r.children_res);
+							if (cqe.res >= 0) { r.children = { children_buffer(i), static_cast<std::size_t>(cqe.res) }; }
+							break;
+						case read_schedstat:
+							set_res(r.schedstat_res);
+							if (cqe.res >= 0)
+							{
+								r.schedstat = { schedstat_buffer(i), static_cast<std::size_t>(cqe.res) };
+							}
+							break;
+						case do_statx:
+							r.statx_res = cqe.res;
+							break;
+						case open_stat:
+							if (cqe.res < 0) { r.stat_res = cqe.res; }
+							break;
+						case open_children:
+							if (cqe.res < 0) { r.children_res = cqe.res; }
+							break;
+						case open_schedstat:
+							if (cqe.res < 0) { r.schedstat_res = cqe.res; }
+							break;
+						default:
+							break;
+					}
+				});
+			}
+
+		}
+
+	public:
+		// Throws std::runtime_error if io_uring (or one of the operations needed) is not available
+		uring_collector()
+		{
+			if (not ring_.supports({ IORING_OP_READ, IORING_OP_STATX }))
+			{
+				throw std::runtime_error("io_uring: IORING_OP_READ/IORING_OP_STATX are not supported");
+			}
+
+			const iovec buffers{ buffers_.get(), BATCH_SIZE * SLOT_SIZE };
+			fixed_buffers_ = ring_.supports({ IORING_OP_READ_FIXED }) and ring_.register_buffers({ &buffers, 1 });
+
+			// Opening into a direct descriptor (file_index) needs Linux 5.15. IORING_FEAT_CQE_SKIP (5.17) is the
+			// closest feature flag that guarantees it.
+			direct_open_ = (ring_.features() & IORING_FEAT_CQE_SKIP) not_eq 0 and
+			               ring_.supports({ IORING_OP_OPENAT, IORING_OP_CLOSE }) and
+			               ring_.register_sparse_files(static_cast<unsigned>(FILES_PER_TASK * BATCH_SIZE));
+		}
+
+		uring_collector(const uring_collector &)                     = delete;
+		auto operator=(const uring_collector &) -> uring_collector & = delete;
+		uring_collector(uring_collector &&)                          = delete;
+		auto operator=(uring_collector &&) -> uring_collector &      = delete;
+
+		~uring_collector() { close_opened(); }
+
+		[[nodiscard]] auto fixed_buffers() const { return fixed_buffers_; }
+
+		[[nodiscard]] auto direct_open() const { return direct_open_; }
+
+		// Collect the files of "requests" in batches of BATCH_SIZE tasks. "fn(first, results)" is called after every
+		// batch, with the index of its first request. The contents of the results are only valid during the call, and
+		// so are the descriptors opened for them unless "fn" takes them.
+		template<typename Fn>
+		void collect(std::span<const uring_request> requests, Fn && fn)
+		{
+			for (std::size_t first = 0; first < requests.size(); first += BATCH_SIZE)
+			{
+				const auto n = std::min(BATCH_SIZE, requests.size() - first);
+
+				collect_batch(requests.subspan(first, n));
+
+				fn(first, std::span<uring_result>(results_));
+			}
+
+			close_opened();
+		}
+	};
+} // namespace prox
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <fcntl.h>  // for open, O_RDONLY, O_CLOEXEC
+#include <unistd.h> // for pread
+
+#include <algorithm>    // for min
+#include <array>        // for array
+#include <cerrno>       // for errno
+#include <charconv>     // for from_chars
+#include <cstdint>      // for uint64_t
+#include <cstring>      // for strerror
+#include <filesystem>   // for path
+#include <optional>     // for optional, nullopt
+#include <span>         // for span
+#include <stdexcept>    // for runtime_error
+#include <string_view>  // for string_view
+#include <system_error> // for errc
+#include <utility>      // for cmp_equal, cmp_less
+#include <vector>       // for vector
+
+#include <fmt/core.h> // for format
+
+#include "cpu_time.hpp"  // for CPU_time
+#include "fd_cache.hpp"  // for unique_fd
+#include "tokenizer.hpp" // for tokenize, decode_integers
+
+namespace prox
+{
+	// Time of one CPU, in clock ticks, from its "cpuN" line of /proc/stat. Aligned to a cache line, so the CPUs can be
+	// read (or written) from different threads without false sharing.
+	struct alignas(64) cpu_load
+	{
+		std::uint64_t busy  = 0; // User, nice, system, irq and softirq (the guest time is accounted in user)
+		std::uint64_t idle  = 0; // Idle and I/O wait
+		std::uint64_t steal = 0; // Stolen by the hypervisor
+
+		// Since the previous update (since boot, after the first one)
+		std::uint64_t busy_delta  = 0;
+		std::uint64_t idle_delta  = 0;
+		std::uint64_t steal_delta = 0;
+
+		bool online = false; // Listed by the last update
+
+		// Add the ticks of another CPU, e.g. to total a NUMA node
+		auto operator+=(const cpu_load & other) -> cpu_load &
+		{
+			busy += other.busy;
+			idle += other.idle;
+			steal += other.steal;
+			busy_delta += other.busy_delta;
+			idle_delta += other.idle_delta;
+			steal_delta += other.steal_delta;
+			online = online or other.online;
+			return *this;
+		}
+
+		[[nodiscard]] auto period() const { return busy_delta + idle_delta + steal_delta; }
+
+		// Fraction of the period the CPU was busy, in [0, 1]
+		[[nodiscard]] auto busy_fraction() const -> float
+		{
+			const auto ticks = period();
+			return ticks == 0 ? 0.0F : static_cast<float>(busy_delta) / static_cast<float>(ticks);
+		}
+
+		// Fraction of the period stolen by the hypervisor, in [0, 1]
+		[[nodiscard]] auto steal_fraction() const -> float
+		{
+			const auto ticks = period();
+			return ticks == 0 ? 0.0F : static_cast<float>(steal_delta) / static_cast<float>(ticks);
+		}
+	};
+
+	// Per-CPU sibling of CPU_time: the time of every CPU, from all the "cpuN" lines of /proc/stat in one read. The
+	// CPUs are kept in a flat array indexed by CPU number, and the read buffer is kept across updates, so an update
+	// does not allocate once it has seen every CPU.
+	class per_CPU_time
+	{
+	public:
+		constexpr static auto FILE_CPU_STAT = "/proc/stat";
+
+	private:
+		static constexpr std::size_t INITIAL_BUFFER_SIZE = 16 * 1024;
+
+		std::vector<cpu_load> cpus_{};
+
+		std::vector<char> buffer_ = std::vector<char>(INITIAL_BUFFER_SIZE);
+
+		// End of the "cpu" lines at the beginning of "contents", or std::nullopt if they may not all be there yet
+		[[nodiscard]] static auto cpu_lines_end(const std::string_view contents, const bool whole_file)
+		    -> std::optional<std::size_t>
+		{
+			std::size_t pos = 0;
+			while (pos < contents.size())
+			{
+				const auto rest = contents.substr(pos);
+				if (rest.size() < 3 and not whole_file) { break; } // Too short to tell
+				if (not rest.starts_with("cpu")) { return pos; }
+
+				const auto newline = contents.find('\n', pos);
+				if (newline == std::string_view::npos) { break; }
+				pos = newline + 1;
+			}
+
+			if (whole_file) { return contents.size(); }
+			return std::nullopt;
+		}
+
+		void scan_cpu_line(const std::string_view line, CPU_time * total)
+		{
+			// Make sure we have the right number of fields (one more to detect unexpected ones)
+			static constexpr std::size_t EXPECTED_FIELDS = 11;
+
+			std::array<field, EXPECTED_FIELDS + 1> fields;
+
+			const auto n_fields = tokenize(line, fields);
+
+			if (n_fields not_eq EXPECTED_FIELDS)
+			{
+				const auto error_str = fmt::format("Expected {} fields in CPU line: \"{}\"", EXPECTED_FIELDS, line);
+				throw std::runtime_error(error_str);
+			}
+
+			const auto cpu_str = line.substr(fields[0].begin, fields[0].size()); // = "cpuN"
+
+			// The aggregate of all the CPUs
+			if (cpu_str == "cpu")
+			{
+				if (total not_eq nullptr) { total->update_from(line); }
+				return;
+			}
+
+			std::size_t cpu = 0;
+			if (const auto [ptr, ec] = std::from_chars(cpu_str.data() + 3, cpu_str.data() + cpu_str.size(), cpu);
+			    ec not_eq std::errc{} or ptr not_eq cpu_str.data() + cpu_str.size())
+			{
+				const auto error_str = fmt::format("Invalid CPU string: {}", cpu_str);
+				throw std::runtime_error(error_str);
+			}
+
+			std::array<std::uint64_t, EXPECTED_FIELDS - 1> values;
+
+			if (const auto n_decoded = decode_integers(line, std::span(fields).subspan(1, values.size()), values);
+			    n_decoded not_eq values.size())
+			{
+				const auto error_str = fmt::format("Could not read {}th field of {}", n_decoded + 1, cpu_str);
+				throw std::runtime_error(error_str);
+			}
+
+			// user nice system idle iowait irq softirq steal guest guest_nice
+			const std::uint64_t busy  = values[0] + values[1] + values[2] + values[5] + values[6];
+			const std::uint64_t idle  = values[3] + values[4];
+			const std::uint64_t steal = values[7];
+
+			if (cpu >= cpus_.size()) { cpus_.resize(cpu + 1); }
+
+			auto & load = cpus_[cpu];
+
+			// The counters of a CPU that has been offline may have restarted
+			const auto delta = [](const std::uint64_t now, const std::uint64_t before) {
+				return now > before ? now - before : 0;
+			};
+
+			load.busy_delta  = delta(busy, load.busy);
+			load.idle_delta  = delta(idle, load.idle);
+			load.steal_delta = delta(steal, load.steal);
+			load.busy        = busy;
+			load.idle        = idle;
+			load.steal       = steal;
+			load.online      = true;
+		}
+
+		void scan_cpu_lines(const std::string_view lines, CPU_time * total)
+		{
+			for (auto & load : cpus_)
+			{
+				load.online = false;
+			}
+
+			std::size_t pos = 0;
+			while (pos < lines.size())
+			{
+				const auto newline = std::min(lines.find('\n', pos), lines.size());
+				scan_cpu_line(lines.substr(pos, newline - pos), total);
+				pos = newline + 1;
+			}
+		}
+
+	public:
+		per_CPU_time() = default;
+
+		// Indexed by CPU number. CPUs not listed by the last update (offline) have "online" unset.
+		[[nodiscard]] auto cpus() const -> std::span<const cpu_load> { return cpus_; }
+
+		[[nodiscard]] auto cpu(const std::size_t cpu) const -> const cpu_load & { return cpus_.at(cpu); }
+
+		// Highest CPU number seen plus one
+		[[nodiscard]] auto size() const { return cpus_.size(); }
+
+		// Read the "cpu" lines of "stat". If "total" is set, it is updated from the aggregate line in the same read.
+		void update(const char * stat, CPU_time * total = nullptr)
+		{
+			const unique_fd fd(::open(stat, O_RDONLY | O_CLOEXEC));
+
+			if (std::cmp_equal(fd.get(), -1))
+			{
+				const auto error_str =
+				    fmt::format("Could not open file {}. Error {} ({})", stat, errno, strerror(errno));
+				throw std::runtime_error(error_str);
+			}
+
+			// Read again with a larger buffer until all the CPU lines fit
+			while (true)
+			{
+				const auto n_read = ::pread(fd.get(), buffer_.data(), buffer_.size(), 0);
+
+				if (std::cmp_less(n_read, 0))
+				{
+					const auto error_str =
+					    fmt::format("Could not read file {}. Error {} ({})", stat, errno, strerror(errno));
+					throw std::runtime_error(error_str);
+				}
+
+				const std::string_view contents(buffer_.data(), static_cast<std::size_t>(n_read));
+
+				const auto whole_file = std::cmp_less(n_read, buffer_.size());
+
+				if (const auto end = cpu_lines_end(contents, whole_file); end.has_value())
+				{
+					scan_cpu_lines(contents.substr(0, *end), total);
+					return;
+				}
+
+				buffer_.resize(buffer_.size() * 2);
+			}
+		}
+
+		void update(const std::filesystem::path & stat) { update(stat.c_str()); }
+
+		void update(const std::filesystem::path & stat, CPU_time & total) { update(stat.c_str(), &total); }
+
+		void update() { update(FILE_CPU_STAT); }
+
+		void update(CPU_time & total) { update(FILE_CPU_STAT, &total); }
+	};
+} // namespace prox
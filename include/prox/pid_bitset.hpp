@@ -0,0 +1,146 @@
+#pragma once
+
+#include <fcntl.h>     // for open, O_RDONLY, O_CLOEXEC
+#include <sys/types.h> // for pid_t
+#include <unistd.h>    // for pread
+
+#include <algorithm>    // for fill_n, max
+#include <array>        // for array
+#include <bit>          // for popcount, countr_zero
+#include <charconv>     // for from_chars
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <system_error> // for errc
+#include <utility>      // for cmp_less, cmp_equal
+#include <vector>       // for vector
+
+#include "fd_cache.hpp" // for unique_fd
+
+namespace prox
+{
+	// Upper bound of pid_max on 64-bit kernels (PID_MAX_LIMIT)
+	constexpr std::size_t PID_MAX_LIMIT = 4 * 1024 * 1024;
+
+	// PIDs are below this value (read from /proc/sys/kernel/pid_max; PID_MAX_LIMIT if it cannot be read)
+	[[nodiscard]] static inline auto read_pid_max(const char * file = "/proc/sys/kernel/pid_max") -> std::size_t
+	{
+		const unique_fd fd(::open(file, O_RDONLY | O_CLOEXEC));
+		if (std::cmp_equal(fd.get(), -1)) { return PID_MAX_LIMIT; }
+
+		std::array<char, 32> buffer{};
+
+		const auto n_read = ::pread(fd.get(), buffer.data(), buffer.size(), 0);
+		if (std::cmp_less(n_read, 1)) { return PID_MAX_LIMIT; }
+
+		std::size_t pid_max = 0;
+
+		const auto [ptr, ec] = std::from_chars(buffer.data(), buffer.data() + n_read, pid_max);
+		if (ec not_eq std::errc{} or pid_max == 0) { return PID_MAX_LIMIT; }
+
+		return pid_max;
+	}
+
+	// Set of PIDs packed in 64-bit words. The words past the last one written are known to be zero, so clearing and
+	// iterating only touch the PIDs in use, whatever the size of the set (e.g. pid_max = 4194304).
+	class pid_bitset
+	{
+		using word_t = std::uint64_t;
+
+		static constexpr std::size_t WORD_BITS = 64;
+
+		std::vector<word_t> words_{};
+
+		std::size_t used_words_ = 0; // Words past this one are zero
+
+		[[nodiscard]] static auto word_of(const std::size_t bit) { return bit / WORD_BITS; }
+
+		[[nodiscard]] static auto mask_of(const std::size_t bit) { return word_t{ 1 } << (bit % WORD_BITS); }
+
+		// Call "fn(pid)" for every bit set in "word", the word number "w"
+		template<typename Fn>
+		static void for_each_bit(word_t word, const std::size_t w, Fn && fn)
+		{
+			while (word not_eq 0)
+			{
+				const auto bit = static_cast<std::size_t>(std::countr_zero(word));
+				fn(static_cast<pid_t>(w * WORD_BITS + bit));
+				word &= word - 1;
+			}
+		}
+
+	public:
+		pid_bitset() = default;
+
+		// Room for the PIDs in [0, size) (larger PIDs make the set grow)
+		explicit pid_bitset(const std::size_t size) : words_((size + WORD_BITS - 1) / WORD_BITS, 0) {}
+
+		[[nodiscard]] auto size() const { return words_.size() * WORD_BITS; }
+
+		[[nodiscard]] auto test(const pid_t pid) const -> bool
+		{
+			const auto bit = static_cast<std::size_t>(pid); // Negative PIDs wrap around, out of range
+			const auto w   = word_of(bit);
+			return w < used_words_ and (words_[w] & mask_of(bit)) not_eq 0;
+		}
+
+		void set(const pid_t pid)
+		{
+			if (std::cmp_less(pid, 0)) { return; }
+
+			const auto bit = static_cast<std::size_t>(pid);
+			const auto w   = word_of(bit);
+
+			if (w >= words_.size()) { words_.resize(w + 1, 0); }
+
+			words_[w] |= mask_of(bit);
+			used_words_ = std::max(used_words_, w + 1);
+		}
+
+		void reset(const pid_t pid)
+		{
+			const auto bit = static_cast<std::size_t>(pid);
+			const auto w   = word_of(bit);
+			if (w < used_words_) { words_[w] &= ~mask_of(bit); }
+		}
+
+		// Remove every PID (the memory is kept)
+		void clear()
+		{
+			std::fill_n(words_.begin(), used_words_, word_t{ 0 });
+			used_words_ = 0;
+		}
+
+		[[nodiscard]] auto count() const
+		{
+			std::size_t n = 0;
+			for (std::size_t w = 0; w < used_words_; ++w)
+			{
+				n += static_cast<std::size_t>(std::popcount(words_[w]));
+			}
+			return n;
+		}
+
+		[[nodiscard]] auto empty() const { return count() == 0; }
+
+		// Call "fn(pid)" for every PID in the set, in increasing order
+		template<typename Fn>
+		void for_each(Fn && fn) const
+		{
+			for (std::size_t w = 0; w < used_words_; ++w)
+			{
+				for_each_bit(words_[w], w, fn);
+			}
+		}
+
+		// Call "fn(pid)" for every PID in "a" that is not in "b" (a & ~b), in increasing order
+		template<typename Fn>
+		static void for_each_difference(const pid_bitset & a, const pid_bitset & b, Fn && fn)
+		{
+			for (std::size_t w = 0; w < a.used_words_; ++w)
+			{
+				const auto other = w < b.used_words_ ? b.words_[w] : word_t{ 0 };
+				for_each_bit(a.words_[w] & ~other, w, fn);
+			}
+		}
+	};
+} // namespace prox
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <linux/cn_proc.h>   // for proc_event, PROC_EVENT_*, proc_cn_mcast_op, PROC_CN_MCAST_LISTEN
+#include <linux/connector.h> // for cn_msg, CN_IDX_PROC, CN_VAL_PROC
+#include <linux/netlink.h>   // for nlmsghdr, sockaddr_nl, NETLINK_CONNECTOR, NLMSG_ALIGNTO, NLMSG_DONE, ...
+#include <sys/socket.h>      // for socket, bind, send, recv, setsockopt, SOL_SOCKET, SO_RCVBUF(FORCE)
+#include <sys/types.h>       // for pid_t
+#include <unistd.h>          // for getpid
+
+#include <algorithm> // for min
+#include <array>     // for array
+#include <cerrno>    // for errno, EAGAIN, EWOULDBLOCK, EINTR, ENOBUFS
+#include <cstddef>   // for byte, size_t
+#include <cstring>   // for memcpy, strerror
+#include <stdexcept> // for runtime_error
+#include <utility>   // for cmp_equal, cmp_less
+
+#include <fmt/core.h> // for format
+
+#include "fd_cache.hpp" // for unique_fd
+
+namespace prox
+{
+	// Typed versions of the NLMSG_* macros of <linux/netlink.h>, which are written with C-style casts
+	namespace netlink
+	{
+		[[nodiscard]] constexpr auto align(const std::size_t length) -> std::size_t
+		{
+			return (length + NLMSG_ALIGNTO - 1) & ~static_cast<std::size_t>(NLMSG_ALIGNTO - 1);
+		}
+
+		inline constexpr std::size_t HEADER_LENGTH = align(sizeof(nlmsghdr));
+
+		// Value of nlmsg_len for a payload of "length" bytes
+		[[nodiscard]] constexpr auto length(const std::size_t length) { return length + HEADER_LENGTH; }
+
+		// Bytes taken by a message with a payload of "length" bytes, padding included
+		[[nodiscard]] constexpr auto space(const std::size_t length) { return align(netlink::length(length)); }
+
+		[[nodiscard]] inline auto data(nlmsghdr * header) -> std::byte *
+		{
+			return reinterpret_cast<std::byte *>(header) + HEADER_LENGTH;
+		}
+
+		[[nodiscard]] inline auto data(const nlmsghdr * header) -> const std::byte *
+		{
+			return reinterpret_cast<const std::byte *>(header) + HEADER_LENGTH;
+		}
+
+		// Whether a whole message starts at "header", with "length" bytes left in the buffer
+		[[nodiscard]] inline auto ok(const nlmsghdr * header, const std::size_t length)
+		{
+			return length >= sizeof(nlmsghdr) and header->nlmsg_len >= sizeof(nlmsghdr) and
+			       header->nlmsg_len <= length;
+		}
+
+		// The message after "header". "length" is decreased by the bytes skipped.
+		[[nodiscard]] inline auto next(const nlmsghdr * header, std::size_t & length) -> const nlmsghdr *
+		{
+			const auto step = std::min(align(header->nlmsg_len), length);
+			length -= step;
+			return reinterpret_cast<const nlmsghdr *>(reinterpret_cast<const std::byte *>(header) + step);
+		}
+	} // namespace netlink
+
+	// Process event of the kernel proc connector, reduced to what a process tree needs
+	struct process_event
+	{
+		enum class kind
+		{
+			fork, // "pid" (of thread group "tgid") was created by "parent_pid" (of thread group "parent_tgid")
+			exec, // "pid" has a new program image
+			exit, // "pid" has finished
+			comm, // "pid" has a new name
+			other
+		};
+
+		kind  what        = kind::other;
+		pid_t pid         = -1;
+		pid_t tgid        = -1;
+		pid_t parent_pid  = -1;
+		pid_t parent_tgid = -1;
+	};
+
+	// Subscription to the kernel proc connector (NETLINK_CONNECTOR, CN_IDX_PROC): the kernel reports every fork,
+	// exec, exit and name change, so a process tree does not have to scan /proc to find out.
+	// Subscribing requires CAP_NET_ADMIN. If the socket buffer overflows, events are lost and the subscriber has to
+	// scan /proc again (see poll()).
+	class proc_connector
+	{
+		// Room for many events per receive
+		static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+		// Ask for a large socket buffer, so bursts of forks do not overflow it
+		static constexpr int SOCKET_BUFFER_SIZE = 4 * 1024 * 1024;
+
+		unique_fd fd_{};
+
+		alignas(nlmsghdr) std::array<char, BUFFER_SIZE> buffer_{};
+
+		[[nodiscard]] static auto to_event(const proc_event & event) -> process_event
+		{
+			switch (event.what)
+			{
+				case proc_event::PROC_EVENT_FORK:
+					return { process_event::kind::fork, event.event_data.fork.child_pid,
+					         event.event_data.fork.child_tgid, event.event_data.fork.parent_pid,
+					         event.event_data.fork.parent_tgid };
+				case proc_event::PROC_EVENT_EXEC:
+					return { process_event::kind::exec, event.event_data.exec.process_pid,
+					         event.event_data.exec.process_tgid };
+				case proc_event::PROC_EVENT_EXIT:
+					return { process_event::kind::exit, event.event_data.exit.process_pid,
+					         event.event_data.exit.process_tgid };
+				case proc_event::PROC_EVENT_COMM:
+					return { process_event::kind::comm, event.event_data.comm.process_pid,
+					         event.event_data.comm.process_tgid };
+				default:
+					return {};
+			}
+		}
+
+		void subscribe()
+		{
+			// Best effort: SO_RCVBUFFORCE ignores the system limit, but needs CAP_NET_ADMIN
+			if (::setsockopt(fd_.get(), SOL_SOCKET, SO_RCVBUFFORCE, &SOCKET_BUFFER_SIZE, sizeof(SOCKET_BUFFER_SIZE)) ==
+			    -1)
+			{
+				::setsockopt(fd_.get(), SOL_SOCKET, SO_RCVBUF, &SOCKET_BUFFER_SIZE, sizeof(SOCKET_BUFFER_SIZE));
+			}
+
+			sockaddr_nl address{};
+			address.nl_family = AF_NETLINK;
+			address.nl_groups = CN_IDX_PROC;
+			address.nl_pid    = 0; // Assigned by the kernel
+
+			if (std::cmp_equal(::bind(fd_.get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)), -1))
+			{
+				const auto error = fmt::format("Could not bind the proc connector. Error: {}", std::strerror(errno));
+				throw std::runtime_error(error);
+			}
+
+			static constexpr std::size_t REQUEST_SIZE = netlink::space(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+
+			alignas(nlmsghdr) std::array<char, REQUEST_SIZE> request{};
+
+			auto * header      = reinterpret_cast<nlmsghdr *>(request.data());
+			header->nlmsg_len  = static_cast<__u32>(netlink::length(sizeof(cn_msg) + sizeof(proc_cn_mcast_op)));
+			header->nlmsg_type = NLMSG_DONE;
+			header->nlmsg_pid  = static_cast<__u32>(::getpid());
+
+			auto * message  = reinterpret_cast<cn_msg *>(netlink::data(header));
+			message->id.idx = CN_IDX_PROC;
+			message->id.val = CN_VAL_PROC;
+			message->len    = sizeof(proc_cn_mcast_op);
+
+			const proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+			std::memcpy(message->data, &op, sizeof(op));
+
+			if (std::cmp_less(::send(fd_.get(), request.data(), header->nlmsg_len, 0), 0))
+			{
+				const auto error =
+				    fmt::format("Could not subscribe to the proc connector. Error: {}", std::strerror(errno));
+				throw std::runtime_error(error);
+			}
+		}
+
+	public:
+		// Subscribe to the events of the kernel. Throws if it is not possible (e.g. without CAP_NET_ADMIN).
+		proc_connector() :
+		    fd_(::socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR))
+		{
+			if (std::cmp_equal(fd_.get(), -1))
+			{
+				const auto error = fmt::format("Could not open the proc connector. Error: {}", std::strerror(errno));
+				throw std::runtime_error(error);
+			}
+
+			subscribe();
+		}
+
+		// Read the events from "fd" instead: a non-blocking datagram socket that carries the same messages as the
+		// kernel (e.g. one end of a socketpair). The descriptor is owned by the connector.
+		explicit proc_connector(const int fd) : fd_(fd) {}
+
+		[[nodiscard]] auto fd() const { return fd_.get(); }
+
+		// Call "fn(event)" for every event received since the last call. Does not block.
+		// Returns false if events have been lost (the socket buffer overflowed) since the last call.
+		template<typename Fn>
+		auto poll(Fn && fn) -> bool
+		{
+			bool complete = true;
+
+			while (true)
+			{
+				const auto n_read = ::recv(fd_.get(), buffer_.data(), buffer_.size(), MSG_DONTWAIT);
+
+				if (std::cmp_less(n_read, 0))
+				{
+					if (errno == EINTR) { continue; }
+					if (errno == ENOBUFS)
+					{
+						complete = false;
+						continue;
+					}
+					if (errno == EAGAIN or errno == EWOULDBLOCK) { return complete; }
+
+					const auto error =
+					    fmt::format("Could not read from the proc connector. Error: {}", std::strerror(errno));
+					throw std::runtime_error(error);
+				}
+
+				auto length = static_cast<std::size_t>(n_read);
+
+				for (auto * header = reinterpret_cast<const nlmsghdr *>(buffer_.data()); netlink::ok(header, length);
+				     header = netlink::next(header, length))
+				{
+					if (header->nlmsg_type == NLMSG_OVERRUN)
+					{
+						complete = false;
+						continue;
+					}
+
+					if (header->nlmsg_type == NLMSG_NOOP or header->nlmsg_type == NLMSG_ERROR) { continue; }
+
+					const auto * message = reinterpret_cast<const cn_msg *>(netlink::data(header));
+
+					if (message->id.idx not_eq CN_IDX_PROC or message->id.val not_eq CN_VAL_PROC) { continue; }
+					if (message->len < sizeof(proc_event)) { continue; }
+
+					// The payload is not necessarily aligned
+					proc_event event;
+					std::memcpy(&event, message->data, sizeof(event));
+
+					if (const auto e = to_event(event); e.what not_eq process_event::kind::other) { fn(e); }
+				}
+			}
+		}
+	};
+} // namespace prox
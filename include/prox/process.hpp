@@ -1,35 +1,55 @@
 #pragma once
 
 #include <cerrno>     // for errno, EFAULT, EINVAL, EPERM, ESRCH
+#include <charconv>   // for from_chars
 #include <cmath>      // for isnormal
 #include <cstring>    // for strerror
+#include <fcntl.h>    // for openat, O_DIRECTORY, O_RDONLY, O_CLOEXEC
 #include <numa.h>     // for numa_allocate_cpumask, numa_free_cpumask, numa_node_to_cpus, numa_sched_setaffinity
 #include <sched.h>    // for sched_setaffinity, cpu_set_t, sched_getaffinity, CPU_SET, CPU_ZERO
-#include <sys/stat.h> // for stat
-#include <unistd.h>   // for sysconf, _SC_NPROCESSORS_ONLN
+#include <unistd.h>   // for sysconf, _SC_NPROCESSORS_ONLN, close
 
 #include <algorithm>   // for clamp
 #include <chrono>      // for time_point, system_clock, chrono_literals
 #include <exception>   // for exception
 #include <filesystem>  // for path, directory_iterator, exists, is_directory, is_regular_file, directory_entry
-#include <fstream>     // for ifstream, basic_istream, operator>>, basic_ostream, getline
 #include <optional>    // for optional
 #include <set>         // for set
+#include <span>        // for span
 #include <stdexcept>   // for runtime_error
 #include <string>      // for string, to_string, getline
 #include <string_view> // for string_view
-#include <utility>     // for
+#include <utility>     // for pair, move
 #include <vector>      // for vector
 
 #include <fmt/core.h> // for format
 
 #include <range/v3/all.hpp> // for views::split, views::to, views::concat
 
-#include "stat.hpp" // for stat
+#include "dir_scanner.hpp" // for pid_scanner
+#include "fd_cache.hpp"    // for fd_cache, proc_file, open_proc_file, pread_proc_file, proc_file_uid
+#include "schedstat.hpp"   // for sched_usage, parse_schedstat
+#include "stat.hpp"        // for stat, stat_mask, update_stat_fd
+#include "topology.hpp"    // for cpu_topology
 
 namespace prox
 {
-	template<typename CPU_time_provider>
+	// Fields of the stat file that process itself relies on
+	constexpr stat_mask PROCESS_STAT_FIELDS =
+	    stat_fields<stat_field::state, stat_field::ppid, stat_field::pgrp, stat_field::flags, stat_field::utime,
+	                stat_field::stime, stat_field::starttime, stat_field::processor>;
+
+	// Fields of the stat file that tell an exec apart (see process::renamed() and process::cmdline_changed())
+	constexpr stat_mask EXEC_STAT_FIELDS = stat_fields<stat_field::comm, stat_field::arg_start, stat_field::arg_end>;
+
+	// Where the children of a process come from
+	enum class hierarchy_source
+	{
+		children_files, // /proc/<pid>/task/<tid>/children (needs CONFIG_PROC_CHILDREN)
+		ppid            // The ppid field of the stat files: the children are linked by the caller (see process_tree)
+	};
+
+	template<typename CPU_time_provider, stat_mask Fields = ALL_STAT_FIELDS>
 	class process
 	{
 		// From htop: supposed to be in linux/sched.h
@@ -38,6 +58,9 @@ namespace prox
 	public:
 		constexpr static std::string_view DEFAULT_PROC = "/proc";
 
+		// Fields parsed from the stat file on every update. The rest of stat_info() keeps its default values.
+		constexpr static stat_mask STAT_FIELDS = Fields | PROCESS_STAT_FIELDS;
+
 	private:
 		std::reference_wrapper<const CPU_time_provider> cpu_time_;
 
@@ -48,6 +71,9 @@ namespace prox
 
 		std::filesystem::path path_{}; // The path to the process folder.
 
+		fd_cache * fd_cache_     = nullptr; // Descriptors kept open across updates (optional).
+		bool       fd_key_valid_ = false;   // The starttime used to key fd_cache_ has been read.
+
 		pid_t effective_ppid_{}; // The parent process ID.
 		                         // PPID is the same for "main" threads and its "LWP" threads.
 		                         // This keeps track of the "main" thread when this process is a "LWP".
@@ -59,6 +85,13 @@ namespace prox
 		                          // or "ps" command is empty.
 		bool task_       = false; // Is a task of the effective parent. Path contains "task" somewhere.
 
+		hierarchy_source hierarchy_ = hierarchy_source::children_files; // Read the children file or not.
+
+		const cpu_topology * topology_ = nullptr; // CPU -> NUMA node table (optional, libnuma otherwise).
+
+		std::string dir_{};     // Path of the task folder, opened when the fd cache does not hold its descriptor.
+		unique_fd   new_dir_{}; // Task folder opened until the fd cache takes it (kept if there is no cache).
+
 		uid_t st_uid_{}; // User ID the process belongs to.
 
 		stat stat_{}; // Struct with the information from the stat file.
@@ -71,8 +104,16 @@ namespace prox
 		unsigned long long last_times_{}; // (utime + stime). Updated when the process is updated.
 		float              cpu_use_{};    // Portion of CPU time used (between 0 and 1).
 
+		bool        track_schedstat_ = false; // Read the schedstat file on every update.
+		sched_usage schedstat_{};             // Nanosecond CPU usage, if track_schedstat_.
+
 		std::string cmdline_{}; // The command line of this process.
 
+		std::string previous_comm_{};         // The comm before the last update (to detect renames).
+		bool        renamed_         = false; // The comm has changed in the last update.
+		bool        exec_suspected_  = false; // The comm or the arguments area has changed: cmdline_ is re-read.
+		bool        cmdline_changed_ = false; // The cmdline has changed in the last update.
+
 		std::chrono::time_point<std::chrono::high_resolution_clock> last_update_{}; // Last time the process was updated.
 
 		[[nodiscard]] static auto uid() -> uid_t
@@ -102,13 +143,114 @@ namespace prox
 			}
 		}
 
+		// Path of the task folder (/proc/<pid>/task/<pid>, or path_ itself for tasks)
+		[[nodiscard]] auto task_dir() const
+		{
+			return task_ ? path_.string() : (path_ / "task" / std::to_string(pid_)).string();
+		}
+
+		// Run "fn" on an O_PATH descriptor of the task folder, which its files are opened relative to. The descriptor
+		// is taken from (and handed over to) the fd cache, if any.
+		template<typename Fn>
+		void with_dir(Fn && fn)
+		{
+			if (fd_cache_ not_eq nullptr and fd_key_valid_)
+			{
+				if (const int fd = fd_cache_->find(fd_key(), proc_file::dir); std::cmp_not_equal(fd, -1))
+				{
+					fn(fd);
+					return;
+				}
+			}
+
+			if (std::cmp_equal(new_dir_.get(), -1)) { new_dir_.reset(open_proc_dir(dir_)); }
+
+			fn(new_dir_.get());
+
+			// "fn" might have read the starttime that keys the cache
+			if (fd_cache_ not_eq nullptr and fd_key_valid_)
+			{
+				fd_cache_->insert(fd_key(), proc_file::dir, new_dir_.release());
+			}
+		}
+
+		// Run "fn" on a descriptor of "file". The descriptor is taken from (and handed over to) the fd cache, if any.
+		template<typename Fn>
+		void with_proc_file(const proc_file file, const char * name, Fn && fn)
+		{
+			if (fd_cache_ not_eq nullptr and fd_key_valid_)
+			{
+				if (const int fd = fd_cache_->find(fd_key(), file); std::cmp_not_equal(fd, -1))
+				{
+					fn(fd);
+					return;
+				}
+			}
+
+			int fd = -1;
+			with_dir([&](const int dir_fd) { fd = open_proc_file(dir_fd, name); });
+
+			try
+			{
+				fn(fd);
+			}
+			catch (...)
+			{
+				::close(fd);
+				throw;
+			}
+
+			if (fd_cache_ not_eq nullptr and fd_key_valid_) { fd_cache_->insert(fd_key(), file, fd); }
+			else { ::close(fd); }
+		}
+
+		// Run "parse", which overwrites stat_, and note whether the comm has changed (if it is parsed at all). An exec
+		// is suspected if the comm or the address of the arguments (a new stack, if arg_start and arg_end are parsed)
+		// has changed: the cmdline is only read again then, see refresh_cmdline().
+		template<typename Parse>
+		void parse_tracking_exec(Parse && parse)
+		{
+			const bool parsed_before = fd_key_valid_;
+			const auto previous_args = std::pair{ stat_.arg_start, stat_.arg_end };
+
+			if constexpr (contains(STAT_FIELDS, stat_field::comm))
+			{
+				previous_comm_.assign(stat_.comm);
+				parse();
+				renamed_ = parsed_before and previous_comm_ not_eq stat_.comm;
+			}
+			else { parse(); }
+
+			bool new_args = false;
+			if constexpr (contains(STAT_FIELDS, stat_field::arg_start) and contains(STAT_FIELDS, stat_field::arg_end))
+			{
+				new_args = parsed_before and previous_args not_eq std::pair{ stat_.arg_start, stat_.arg_end };
+			}
+
+			exec_suspected_ = renamed_ or new_args;
+		}
+
+		// Read the cmdline again if an exec is suspected, relative to "dir_fd" (the task folder) unless it is -1
+		void refresh_cmdline(const int dir_fd = -1)
+		{
+			cmdline_changed_ = false;
+
+			if (not exec_suspected_) { return; }
+
+			auto cmdline     = std::cmp_equal(dir_fd, -1) ? obtain_cmdline() : obtain_cmdline(dir_fd);
+			cmdline_changed_ = cmdline not_eq cmdline_;
+			cmdline_         = std::move(cmdline);
+		}
+
 		void read_stat_file()
 		{
 			// Update the process info from the stat file
-			const auto pid_str        = std::to_string(pid_);
-			const auto stat_file_path = task_ ? path_ / "stat" : path_ / "task" / pid_str / "stat";
-
-			update_stat_file(stat_file_path, stat_);
+			with_proc_file(proc_file::stat, "stat", [this](const int fd) {
+				parse_tracking_exec([&] { update_stat_fd<STAT_FIELDS>(fd, "stat", stat_); });
+				fd_key_valid_ = true;
+				// Update the st_uid
+				st_uid_ = proc_file_uid(fd, "stat");
+			});
 		}
 
 		void update_cpu_use()
@@ -129,62 +271,93 @@ namespace prox
 			last_update_ = std::chrono::high_resolution_clock::now();
 		}
 
-		void update_st_uid()
+		void read_schedstat_file()
 		{
-			struct ::stat sstat;
+			with_proc_file(proc_file::schedstat, "schedstat", [this](const int fd) {
+				thread_local std::string buffer;
 
-			int ret = ::stat(path_.c_str(), &sstat);
+				const auto n_read = pread_proc_file(fd, "schedstat", buffer);
 
-			if (std::cmp_equal(ret, -1))
-			{
-				const auto error_str =
-				    fmt::format("Could not stat file {}. Error {} ({})", path_.string(), errno, strerror(errno));
-				throw std::runtime_error(error_str);
-			}
-
-			st_uid_ = sstat.st_uid;
+				schedstat_.sample(parse_schedstat(std::string_view(buffer.data(), n_read)));
+			});
 		}
 
-		void update_list_of_tasks()
+		// "dir_fd" is the task folder (from the fd cache if -1)
+		void update_list_of_tasks(const int dir_fd = -1)
 		{
 			// A task cannot have tasks
 			if (task_) { return; }
 
+			if (std::cmp_equal(dir_fd, -1))
+			{
+				with_dir([this](const int fd) { update_list_of_tasks(fd); });
+				return;
+			}
+
 			tasks_.clear();
 
-			// Tasks is a directory with subfolders named after the thread IDs
-			for (const auto & entry : std::filesystem::directory_iterator(path_ / "task"))
-			{
-				if (not entry.is_directory()) { continue; }
+			thread_local pid_scanner scanner;
 
-				const auto tid = std::strtol(entry.path().filename().c_str(), nullptr, 10);
+			// The parent of the task folder (/proc/<pid>/task)
+			const unique_fd tasks_fd(::openat(dir_fd, "..", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
 
-				if (std::cmp_equal(tid, pid_)) { continue; }
+			if (std::cmp_equal(tasks_fd.get(), -1))
+			{
+				const auto error = fmt::format("Could not open the task folder of PID {}. Error {} ({})", pid_, errno,
+				                               strerror(errno));
+				throw std::runtime_error(error);
+			}
+
+			// Tasks is a directory with subfolders named after the thread IDs
+			scanner.scan(tasks_fd.get(), [this](const pid_t tid) {
+				if (std::cmp_equal(tid, pid_)) { return; }
 
 				tasks_.emplace_back(tid);
-			}
+			});
 		}
 
-		void update_list_of_children()
+		// Children is a file with a list of PIDs
+		void parse_children(const std::string_view data)
 		{
-			children_ = {};
-
-			const auto children_path = task_ ? path_ / "children" : path_ / "task" / std::to_string(pid_) / "children";
+			children_.clear();
 
-			// Children is a file with a list of PIDs
-			std::ifstream file(children_path, std::ios::in);
+			const char * it  = data.data();
+			const char * end = data.data() + data.size();
 
-			if (not file.is_open())
+			while (it not_eq end)
 			{
-				const auto error_str = fmt::format("Could not open file {}. Error {} ({})", children_path.string(),
-				                                   errno, strerror(errno));
-				throw std::runtime_error(error_str);
+				if (*it == ' ' or *it == '\n')
+				{
+					++it;
+					continue;
+				}
+
+				pid_t child_pid = 0;
+
+				const auto [ptr, ec] = std::from_chars(it, end, child_pid);
+				if (ec not_eq std::errc{}) { break; }
+
+				children_.emplace_back(child_pid);
+				it = ptr;
 			}
+		}
 
-			for (pid_t child_pid = 0; file >> child_pid;)
+		void update_list_of_children()
+		{
+			// The children are linked from their ppid by the caller
+			if (hierarchy_ == hierarchy_source::ppid)
 			{
-				children_.emplace_back(child_pid);
+				children_.clear();
+				return;
 			}
+
+			with_proc_file(proc_file::children, "children", [this](const int fd) {
+				thread_local std::string buffer;
+
+				const auto n_read = pread_proc_file(fd, "children", buffer);
+
+				parse_children(std::string_view(buffer.data(), n_read));
+			});
 		}
 
 		[[nodiscard]] auto is_migratable() const -> bool
@@ -197,36 +370,53 @@ namespace prox
 			return std::cmp_equal(st_uid_, uid());
 		}
 
-		[[nodiscard]] auto obtain_cmdline()
+		// Command line of the task, read relative to "dir_fd" (its task folder). Empty, as for kernel threads, if it
+		// cannot be read (e.g. the task is exiting).
+		[[nodiscard]] auto obtain_cmdline(const int dir_fd) const -> std::string
 		{
 			try
 			{
-				std::ifstream cmdline_file(path_ / "cmdline");
+				// The cmdline of a process is next to its task folder
+				const unique_fd fd(open_proc_file(dir_fd, task_ ? "cmdline" : "../../cmdline"));
+
+				std::string buffer;
+				buffer.resize(pread_proc_file(fd.get(), "cmdline", buffer));
 
-				std::ostringstream cmdline_stream;
+				// Words separated by a single space, without trailing whitespace(s)
+				static constexpr std::string_view whitespaces{ " \t\f\v\n\r" };
 
-				ranges::copy(ranges::istream_view<std::string>(cmdline_file),
-				             ranges::ostream_iterator<std::string>(cmdline_stream, " "));
+				std::string cmdline;
 
-				// Remove trailing whitespace(s)
-				auto cmdline = cmdline_stream.str();
+				for (std::size_t begin = buffer.find_first_not_of(whitespaces); begin not_eq std::string::npos;)
+				{
+					const auto end = std::min(buffer.find_first_of(whitespaces, begin), buffer.size());
 
-				static constexpr auto whitespaces{ " \t\f\v\n\r" };
+					if (not cmdline.empty()) { cmdline += ' '; }
+					cmdline.append(buffer, begin, end - begin);
 
-				const auto it = cmdline.find_last_not_of(whitespaces);
-				if (it not_eq std::string::npos) { cmdline.erase(it + 1); }
+					begin = buffer.find_first_not_of(whitespaces, end);
+				}
 
 				return cmdline;
 			}
-			catch (std::exception & e)
+			catch (...)
 			{
-				const auto error = fmt::format("Could not retrieve cmdline from PID {}: {}", pid_, e.what());
-				throw std::runtime_error(error);
+				return {};
+			}
+		}
+
+		// Same as obtain_cmdline(dir_fd), with the task folder from the fd cache (or opened)
+		[[nodiscard]] auto obtain_cmdline() -> std::string
+		{
+			try
+			{
+				std::string cmdline;
+				with_dir([&](const int dir_fd) { cmdline = obtain_cmdline(dir_fd); });
+				return cmdline;
 			}
 			catch (...)
 			{
-				const auto error = fmt::format("Could not retrieve cmdline from PID {}", pid_);
-				throw std::runtime_error(error);
+				return {};
 			}
 		}
 
@@ -237,14 +427,20 @@ namespace prox
 	public:
 		process() = delete;
 
-		explicit process(const pid_t pid, const CPU_time_provider & cpu_time) :
+		explicit process(const pid_t pid, const CPU_time_provider & cpu_time, fd_cache * fds = nullptr,
+		                 const hierarchy_source hierarchy = hierarchy_source::children_files,
+		                 const cpu_topology *   topology  = nullptr) :
 		    cpu_time_(cpu_time),
 		    pid_(pid),
 		    path_(fmt::format("/proc/{}", pid)),
+		    fd_cache_(fds),
 		    migratable_(is_migratable()),
 		    // First guess to know if it is a LWP
 		    lwp_(not std::filesystem::exists(fmt::format("/proc/{}", pid))),
 		    task_(path_.string().find("task") != std::string::npos),
+		    hierarchy_(hierarchy),
+		    topology_(topology),
+		    dir_(task_dir()),
 		    cmdline_(obtain_cmdline())
 		{
 			update();
@@ -254,14 +450,20 @@ namespace prox
 			lwp_ = is_userland_lwp() or is_kernel_lwp();
 		}
 
-		process(const pid_t pid, std::filesystem::path path, const CPU_time_provider & cpu_time) :
+		process(const pid_t pid, std::filesystem::path path, const CPU_time_provider & cpu_time,
+		        fd_cache * fds = nullptr, const hierarchy_source hierarchy = hierarchy_source::children_files,
+		        const cpu_topology * topology = nullptr) :
 		    cpu_time_(cpu_time),
 		    pid_(pid),
 		    path_(std::move(path)),
+		    fd_cache_(fds),
 		    migratable_(is_migratable()),
 		    // First guess to know if it is a LWP
 		    lwp_(not std::filesystem::exists(fmt::format("/proc/{}", pid))),
 		    task_(path_.string().find("task") != std::string::npos),
+		    hierarchy_(hierarchy),
+		    topology_(topology),
+		    dir_(task_dir()),
 		    cmdline_(obtain_cmdline())
 		{
 			update();
@@ -293,11 +495,17 @@ namespace prox
 
 		[[nodiscard]] auto numa_node() const
 		{
-			return pinned_numa_node_.has_value() ? pinned_numa_node_.value() : numa_node_of_cpu(stat_.processor);
+			if (pinned_numa_node_.has_value()) { return pinned_numa_node_.value(); }
+			if (topology_ not_eq nullptr and topology_->size() > 0) { return topology_->node_of(stat_.processor); }
+			return numa_node_of_cpu(stat_.processor);
 		}
 
+		[[nodiscard]] auto topology() const { return topology_; }
+
 		[[nodiscard]] auto cpu_use() const { return cpu_use_; }
 
+		[[nodiscard]] auto st_uid() const { return st_uid_; }
+
 		[[nodiscard]] auto path() const { return path_; }
 
 		[[nodiscard]] auto lwp() const { return lwp_; }
@@ -310,20 +518,80 @@ namespace prox
 
 		[[nodiscard]] auto last_update() const { return last_update_; }
 
+		// Path of the task folder (the stat, children and schedstat files are in it)
+		[[nodiscard]] auto dir_path() const -> const std::string & { return dir_; }
+
+		// Key of the descriptors of this task in the fd cache
+		[[nodiscard]] auto fd_key() const { return fd_cache::key{ pid_, stat_.starttime }; }
+
 		void update()
 		{
-			// Update the values from the stat file
+			// Update the values (and the st_uid) from the stat file
 			read_stat_file();
+			// Read the cmdline again after an exec
+			refresh_cmdline();
 			// Update the CPU usage
 			update_cpu_use();
-			// Update the st_uid
-			update_st_uid();
+			if (track_schedstat_) { read_schedstat_file(); }
 			// Update the list of tasks
 			update_list_of_tasks();
 			// Update the list of children
 			update_list_of_children();
 		}
 
+		// Update from the contents of the stat and children files and the owner of the task, already collected by the
+		// caller (e.g. in a batch, see uring_collector). "children_data" is ignored if the hierarchy comes from ppid.
+		// The schedstat file is read here if tracked and "schedstat_data" is not given, and the tasks are listed from
+		// "dir_fd" (the task folder) unless it is -1: callers in other threads must give both, as the fd cache is used
+		// otherwise.
+		void update(const std::string_view stat_data, const uid_t st_uid, const std::string_view children_data,
+		            const std::optional<std::string_view> schedstat_data = std::nullopt, const int dir_fd = -1)
+		{
+			parse_tracking_exec([&] { parse_stat<STAT_FIELDS>(stat_data, stat_); });
+			fd_key_valid_ = true;
+			st_uid_       = st_uid;
+
+			update_cpu_use();
+			if (track_schedstat_)
+			{
+				if (schedstat_data.has_value()) { schedstat_.sample(parse_schedstat(*schedstat_data)); }
+				else { read_schedstat_file(); }
+			}
+			refresh_cmdline(dir_fd);
+			update_list_of_tasks(dir_fd);
+			parse_children(hierarchy_ == hierarchy_source::ppid ? std::string_view{} : children_data);
+		}
+
+		// Read the schedstat file of the task on every update (false stops it), for a CPU usage in nanoseconds instead
+		// of clock ticks. The file is read right away, so the first deltas are zero.
+		void track_schedstat(const bool enable)
+		{
+			if (enable == track_schedstat_) { return; }
+
+			schedstat_ = {};
+			if (enable) { read_schedstat_file(); }
+			track_schedstat_ = enable;
+		}
+
+		[[nodiscard]] auto tracks_schedstat() const { return track_schedstat_; }
+
+		// Run time, run-queue wait and timeslices of the task between the last two updates. Only sampled while
+		// tracked, see track_schedstat().
+		[[nodiscard]] auto schedstat() const -> const sched_usage & { return schedstat_; }
+
+		// True if the comm has changed in the last update (e.g. after an exec). Always false if the comm is not parsed.
+		[[nodiscard]] auto renamed() const { return renamed_; }
+
+		// True if the cmdline has changed in the last update (e.g. an interpreter that runs another script). It is only
+		// read again if the comm or the address of the arguments has changed, so it is always false if neither is
+		// parsed.
+		[[nodiscard]] auto cmdline_changed() const { return cmdline_changed_; }
+
+		[[nodiscard]] auto hierarchy() const { return hierarchy_; }
+
+		// Takes effect on the next update
+		void hierarchy(const hierarchy_source hierarchy) { hierarchy_ = hierarchy; }
+
 		[[nodiscard]] auto children() const { return children_ | ranges::to<std::set<pid_t>>(); }
 
 		[[nodiscard]] auto add_child(const pid_t pid)
@@ -350,8 +618,19 @@ namespace prox
 			ranges::actions::sort(tasks_);
 		}
 
+		// Same as add_child() and add_task(), for callers that already know that "pid" is not listed (e.g. the
+		// reconciliation of process_tree::update()): no lookup and no sort
+		void link_child(const pid_t pid) { children_.emplace_back(pid); }
+
+		void link_task(const pid_t pid) { tasks_.emplace_back(pid); }
+
 		[[nodiscard]] auto children_and_tasks() const { return ranges::views::concat(children_, tasks_); }
 
+		// Same as children() and tasks(), without copies. Valid until the next update.
+		[[nodiscard]] auto children_pids() const -> std::span<const pid_t> { return children_; }
+
+		[[nodiscard]] auto task_pids() const -> std::span<const pid_t> { return tasks_; }
+
 		void pin_processor(const int processor)
 		{
 			if (pinned_processor_.has_value() and std::cmp_equal(pinned_processor_.value(), processor)) { return; }
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <sys/types.h> // for pid_t
+
+#include <algorithm> // for max
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t
+#include <limits>   // for numeric_limits
+#include <optional> // for optional, nullopt
+#include <span>     // for span
+#include <utility>  // for cmp_less
+#include <vector>   // for vector
+
+#include <range/v3/all.hpp> // for views::indices, views::transform
+
+#include "secondary_index.hpp" // for string_interner
+#include "stat.hpp"            // for stat
+
+namespace prox
+{
+	// Fields of the processes that are scanned the most (CPU use, placement, state), as a structure of arrays. Every
+	// column is a contiguous array and row "slot" of every column belongs to the same process, so filtering all the
+	// processes is a linear scan. PIDs are mapped to slots with a flat index (see slot()). The tree keeps its
+	// processes in the order of the rows, looks them up through this index and refreshes the row of a process in
+	// place right after updating it (see assign()).
+	class process_store
+	{
+		using slot_t    = std::uint32_t;
+		using comm_id_t = string_interner::id_t;
+
+		static constexpr slot_t NO_SLOT = std::numeric_limits<slot_t>::max();
+
+		std::vector<pid_t>       pid_{};
+		std::vector<pid_t>       ppid_{};
+		std::vector<char>        state_{};
+		std::vector<stat::luint> utime_{};
+		std::vector<stat::luint> stime_{};
+		std::vector<int>         processor_{};
+		std::vector<float>       cpu_use_{};
+		std::vector<stat::uint>  flags_{};
+		std::vector<stat::lint>  rss_{};
+		std::vector<stat::luint> majflt_{};
+		std::vector<uid_t>       uid_{};
+		std::vector<comm_id_t>   comm_id_{}; // Only if the comms are interned
+		std::vector<char>        lwp_{};     // Bool, without the packing of std::vector<bool>
+
+		std::vector<slot_t> index_{}; // PID -> slot
+
+		bool            intern_comms_ = false;
+		string_interner comms_{};
+
+	public:
+		// One row of the store
+		class row
+		{
+			const process_store * store_ = nullptr;
+			std::size_t           slot_  = 0;
+
+		public:
+			row() = default;
+
+			row(const process_store & store, const std::size_t slot) : store_(&store), slot_(slot) {}
+
+			[[nodiscard]] auto slot() const { return slot_; }
+
+			[[nodiscard]] auto pid() const { return store_->pid_[slot_]; }
+
+			[[nodiscard]] auto ppid() const { return store_->ppid_[slot_]; }
+
+			[[nodiscard]] auto state() const { return store_->state_[slot_]; }
+
+			[[nodiscard]] auto running() const { return state() == 'R'; }
+
+			[[nodiscard]] auto utime() const { return store_->utime_[slot_]; }
+
+			[[nodiscard]] auto stime() const { return store_->stime_[slot_]; }
+
+			[[nodiscard]] auto processor() const { return store_->processor_[slot_]; }
+
+			[[nodiscard]] auto cpu_use() const { return store_->cpu_use_[slot_]; }
+
+			[[nodiscard]] auto flags() const { return store_->flags_[slot_]; }
+
+			[[nodiscard]] auto rss() const { return store_->rss_[slot_]; }
+
+			[[nodiscard]] auto majflt() const { return store_->majflt_[slot_]; }
+
+			[[nodiscard]] auto uid() const { return store_->uid_[slot_]; }
+
+			[[nodiscard]] auto comm_id() const { return store_->comm_id_[slot_]; }
+
+			[[nodiscard]] auto lwp() const { return store_->lwp_[slot_] not_eq 0; }
+		};
+
+		[[nodiscard]] auto size() const { return pid_.size(); }
+
+		[[nodiscard]] auto empty() const { return pid_.empty(); }
+
+		[[nodiscard]] auto slot(const pid_t pid) const -> std::optional<std::size_t>
+		{
+			if (std::cmp_less(pid, 0) or not std::cmp_less(pid, index_.size())) { return std::nullopt; }
+
+			const auto s = index_[static_cast<std::size_t>(pid)];
+			if (s == NO_SLOT) { return std::nullopt; }
+			return s;
+		}
+
+		[[nodiscard]] auto contains(const pid_t pid) const { return slot(pid).has_value(); }
+
+		[[nodiscard]] auto find(const pid_t pid) const -> std::optional<row>
+		{
+			if (const auto s = slot(pid); s.has_value()) { return row{ *this, *s }; }
+			return std::nullopt;
+		}
+
+		// Insert the process, or refresh its row if it is already in the store
+		template<typename Process>
+		void assign(const Process & proc)
+		{
+			const auto pid = proc.pid();
+
+			if (std::cmp_less(pid, 0)) { return; }
+
+			const auto i = static_cast<std::size_t>(pid);
+
+			if (i >= index_.size()) { index_.resize(i + 1, NO_SLOT); }
+
+			auto & s = index_[i];
+
+			if (s == NO_SLOT)
+			{
+				s = static_cast<slot_t>(pid_.size());
+
+				pid_.emplace_back(pid);
+				ppid_.emplace_back();
+				state_.emplace_back();
+				utime_.emplace_back();
+				stime_.emplace_back();
+				processor_.emplace_back();
+				cpu_use_.emplace_back();
+				flags_.emplace_back();
+				rss_.emplace_back();
+				majflt_.emplace_back();
+				uid_.emplace_back();
+				comm_id_.emplace_back();
+				lwp_.emplace_back();
+			}
+
+			const auto & stat = proc.stat_info();
+
+			ppid_[s]      = proc.ppid();
+			state_[s]     = stat.state;
+			utime_[s]     = stat.utime;
+			stime_[s]     = stat.stime;
+			processor_[s] = proc.processor();
+			cpu_use_[s]   = proc.cpu_use();
+			flags_[s]     = stat.flags;
+			rss_[s]       = stat.rss;
+			majflt_[s]    = stat.majflt;
+			uid_[s]       = proc.st_uid();
+			lwp_[s]       = static_cast<char>(proc.lwp());
+
+			if (intern_comms_) { comm_id_[s] = comms_.intern(stat.comm); }
+		}
+
+		// Remove the row of "pid". The last row is moved into its slot.
+		void erase(const pid_t pid)
+		{
+			const auto s = slot(pid);
+			if (not s.has_value()) { return; }
+
+			const auto last = pid_.size() - 1;
+
+			if (*s not_eq last)
+			{
+				pid_[*s]       = pid_[last];
+				ppid_[*s]      = ppid_[last];
+				state_[*s]     = state_[last];
+				utime_[*s]     = utime_[last];
+				stime_[*s]     = stime_[last];
+				processor_[*s] = processor_[last];
+				cpu_use_[*s]   = cpu_use_[last];
+				flags_[*s]     = flags_[last];
+				rss_[*s]       = rss_[last];
+				majflt_[*s]    = majflt_[last];
+				uid_[*s]       = uid_[last];
+				comm_id_[*s]   = comm_id_[last];
+				lwp_[*s]       = lwp_[last];
+
+				index_[static_cast<std::size_t>(pid_[*s])] = static_cast<slot_t>(*s);
+			}
+
+			pid_.pop_back();
+			ppid_.pop_back();
+			state_.pop_back();
+			utime_.pop_back();
+			stime_.pop_back();
+			processor_.pop_back();
+			cpu_use_.pop_back();
+			flags_.pop_back();
+			rss_.pop_back();
+			majflt_.pop_back();
+			uid_.pop_back();
+			comm_id_.pop_back();
+			lwp_.pop_back();
+
+			index_[static_cast<std::size_t>(pid)] = NO_SLOT;
+		}
+
+		void clear()
+		{
+			for (const auto pid : pid_)
+			{
+				index_[static_cast<std::size_t>(pid)] = NO_SLOT;
+			}
+
+			pid_.clear();
+			ppid_.clear();
+			state_.clear();
+			utime_.clear();
+			stime_.clear();
+			processor_.clear();
+			cpu_use_.clear();
+			flags_.clear();
+			rss_.clear();
+			majflt_.clear();
+			uid_.clear();
+			comm_id_.clear();
+			lwp_.clear();
+		}
+
+		// Columns
+		[[nodiscard]] auto pids() const { return std::span(pid_); }
+
+		[[nodiscard]] auto ppids() const { return std::span(ppid_); }
+
+		[[nodiscard]] auto states() const { return std::span(state_); }
+
+		[[nodiscard]] auto utimes() const { return std::span(utime_); }
+
+		[[nodiscard]] auto stimes() const { return std::span(stime_); }
+
+		[[nodiscard]] auto processors() const { return std::span(processor_); }
+
+		[[nodiscard]] auto cpu_uses() const { return std::span(cpu_use_); }
+
+		[[nodiscard]] auto flags() const { return std::span(flags_); }
+
+		[[nodiscard]] auto rsss() const { return std::span(rss_); }
+
+		[[nodiscard]] auto majflts() const { return std::span(majflt_); }
+
+		[[nodiscard]] auto uids() const { return std::span(uid_); }
+
+		[[nodiscard]] auto comm_ids() const { return std::span(comm_id_); }
+
+		[[nodiscard]] auto lwps() const { return std::span(lwp_); }
+
+		// Fill the comm_ids() column on assign() (the rows assigned before keep their ids)
+		void intern_comms(const bool intern) { intern_comms_ = intern; }
+
+		[[nodiscard]] auto intern_comms() const { return intern_comms_; }
+
+		// Comms of the comm_ids() column
+		[[nodiscard]] auto comms() const -> const string_interner & { return comms_; }
+
+		// Drop the comms of the erased rows once they outnumber the live ones (renumbers the comm_ids() column)
+		void compact_comms()
+		{
+			static constexpr std::size_t MIN_COMMS = 1024;
+
+			if (not intern_comms_ or comms_.size() <= std::max(MIN_COMMS, 2 * comm_id_.size())) { return; }
+
+			comms_.compact(comm_id_);
+		}
+
+		// Rows, in storage order
+		[[nodiscard]] auto rows() const
+		{
+			return ranges::views::indices(size()) |
+			       ranges::views::transform([this](const std::size_t slot) { return row{ *this, slot }; });
+		}
+	};
+} // namespace prox
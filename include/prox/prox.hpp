@@ -1,232 +1,1562 @@
 #pragma once
 
+#include <fcntl.h>
+#include <numa.h>
+
 #include <iostream>
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <filesystem>
-#include <map>
+#include <limits>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <queue>
 #include <set>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <range/v3/all.hpp>
 
-#include "cpu_time.hpp"
-#include "process.hpp"
+#include "change_log.hpp"
+#include "cpu_time.hpp"
+#include "dir_scanner.hpp"
+#include "euler_tour.hpp"
+#include "fd_cache.hpp"
+#include "io_uring.hpp"
+#include "pid_bitset.hpp"
+#include "proc_connector.hpp"
+#include "process.hpp"
+#include "process_store.hpp"
+#include "scratch_arena.hpp"
+#include "secondary_index.hpp"
+#include "slab.hpp"
+#include "thread_pool.hpp"
+#include "top_k.hpp"
+#include "topology.hpp"
+
+namespace prox
+{
+	// taken from https://stackoverflow.com/a/478960
+	template<size_t buff_length = 128>
+	auto exec_cmd(const std::string_view cmd, const bool truncate_final_newlines = true) -> std::string
+	{
+		std::array<char, buff_length> buffer{};
+
+		std::string result;
+
+		const std::unique_ptr<std::FILE, decltype(&pclose)> pipe(popen(cmd.data(), "r"), pclose);
+
+		if (pipe == nullptr) { throw std::runtime_error("Could not execute command " + std::string(cmd)); }
+
+		while (fgets(buffer.data(), buffer.size(), pipe.get()) not_eq nullptr)
+		{
+			result += buffer.data();
+		}
+
+		if (truncate_final_newlines)
+		{
+			// Remove last '\n' (if there is one)
+			while (result[result.length() - 1] == '\n')
+			{
+				result.pop_back();
+			}
+		}
+
+		return result;
+	}
+
+	// How process_tree::update() reads the files of the processes already in the tree
+	enum class collection_backend
+	{
+		synchronous, // One process at a time, one system call per file
+		io_uring,    // In batches, through io_uring (see uring_collector)
+		parallel     // Shared by a pool of threads (see work_stealing_pool)
+	};
+
+	// Processes that process_tree::update() looks for
+	enum class tree_scope
+	{
+		system, // Every process in the proc folder
+		subtree // Only the descendants (children and tasks, recursively) of the root
+	};
+
+	// Values that process_tree can rank the processes by (see process_tree::rank())
+	enum class rank_key : std::size_t
+	{
+		cpu_use, // process::cpu_use()
+		rss,     // Resident set size (pages), if parsed from the stat file
+		majflt,  // Major page faults, if parsed from the stat file
+		count
+	};
+
+	// Keys that process_tree can index the processes by (see process_tree::index())
+	enum class index_key : std::size_t
+	{
+		processor, // process::processor()
+		numa_node, // NUMA node of process::processor()
+		uid,       // Owner of the /proc/<pid> directory
+		comm,      // Name of the executable, if parsed from the stat file
+		count
+	};
+
+	// Totals of a process and its descendants (children and tasks, recursively), see process_tree::subtree()
+	struct subtree_aggregate
+	{
+		double      cpu_use   = 0.0; // Processes and tasks (the stat file of a task has its own times)
+		stat::lint  rss       = 0;   // Once per process: tasks share the memory of their process
+		stat::luint majflt    = 0;   // Processes and tasks
+		std::size_t threads   = 0;   // Processes and tasks
+		std::size_t processes = 0;
+
+		auto operator+=(const subtree_aggregate & other) -> subtree_aggregate &
+		{
+			cpu_use += other.cpu_use;
+			rss += other.rss;
+			majflt += other.majflt;
+			threads += other.threads;
+			processes += other.processes;
+			return *this;
+		}
+	};
+
+	// Tree of the processes of the system. "Fields" selects which fields of the stat files are parsed on every update.
+	template<stat_mask Fields = ALL_STAT_FIELDS>
+	class basic_process_tree
+	{
+		using proc_t     = process<CPU_time, Fields>;
+		using proc_ptr_t = typename slab<proc_t>::handle;
+
+		// PID to update and, for tasks, the PID of the process they belong to (-1 otherwise)
+		struct queued_pid
+		{
+			pid_t pid  = -1;
+			pid_t tgid = -1;
+		};
+
+		using pid_queue = std::queue<queued_pid, std::pmr::deque<queued_pid>>;
+
+		// Build the process "pid" (at "path", if given) on the state shared by the processes of the tree
+		template<typename... Path>
+		[[nodiscard]] auto make_proc_ptr(const pid_t pid, Path &&... path)
+		{
+			auto proc = procs_.emplace(pid, std::forward<Path>(path)..., shared_->cpu_time, &shared_->fds,
+			                           followed_hierarchy(), &shared_->topology);
+			if (track_schedstat_) { proc->track_schedstat(true); }
+			return proc;
+		}
+
+		static constexpr const char * TREE_STR_HORZ = "\xe2\x94\x80"; // TREE_STR_HORZ ─
+		static constexpr const char * TREE_STR_VERT = "\xe2\x94\x82"; // TREE_STR_VERT │
+		static constexpr const char * TREE_STR_RTEE = "\xe2\x94\x9c"; // TREE_STR_RTEE ├
+		static constexpr const char * TREE_STR_BEND = "\xe2\x94\x94"; // TREE_STR_BEND └
+		static constexpr const char * TREE_STR_TEND = "\xe2\x94\x8c"; // TREE_STR_TEND ┌
+		static constexpr const char * TREE_STR_OPEN = "+";            // TREE_STR_OPEN +
+		static constexpr const char * TREE_STR_SHUT = "\xe2\x94\x80"; // TREE_STR_SHUT ─
+
+		static constexpr pid_t DEFAULT_ROOT      = 1;
+		static constexpr auto  DEFAULT_PROC_PATH = "/proc";
+
+		static constexpr std::size_t MAX_DEFAULT_WORKERS = 8;
+
+		pid_t root_ = DEFAULT_ROOT;
+
+		tree_scope scope_ = tree_scope::system;
+
+		hierarchy_source hierarchy_ = hierarchy_source::children_files;
+
+		std::filesystem::path proc_path_ = DEFAULT_PROC_PATH;
+
+		// State that the processes point at. Behind a pointer, so that moving the tree does not move it under them.
+		struct shared_state
+		{
+			CPU_time     cpu_time = {};
+			cpu_topology topology = cpu_topology::discover(); // See refresh_topology()
+			fd_cache     fds      = {};                       // Stat/children descriptors kept open across updates
+		};
+
+		std::unique_ptr<shared_state> shared_ = std::make_unique<shared_state>();
+
+		bool track_cpu_loads_ = false; // Read every CPU of /proc/stat, not only the aggregate
+
+		bool track_schedstat_ = false; // Sample the schedstat file of every process, see process::track_schedstat()
+
+		per_CPU_time  per_cpu_time_  = {};
+		topology_load topology_load_ = {};
+
+		slab<proc_t> procs_ = {}; // Owns the processes of the tree
+
+		process_store store_ = {}; // Rows of the processes, refreshed in place as they are updated
+
+		std::vector<proc_ptr_t> handles_ = {}; // Slot of the columns -> process, kept in step with store_
+
+		std::array<top_k, static_cast<std::size_t>(rank_key::count)> rankings_ = {}; // Capacity 0 if not ranked
+
+		std::array<bool, static_cast<std::size_t>(index_key::count)> indexed_ = {};
+
+		key_index<int>                   by_processor_ = {}; // Empty if not indexed
+		key_index<int>                   by_numa_node_ = {};
+		key_index<uid_t>                 by_uid_       = {};
+		key_index<string_interner::id_t> by_comm_      = {};
+
+		bool aggregated_ = false;
+
+		// Euler tour of the tree and totals of its subtrees, rebuilt at the end of update(), or by the first query
+		// after insert() or erase() (see current_tour()). Behind a pointer, so that the tree stays movable.
+		struct tour_state
+		{
+			euler_tour                     tour       = {};
+			std::vector<subtree_aggregate> aggregates = {}; // Slot of the columns -> totals of its subtree
+
+			// Parent and kind of every slot, kept across rebuilds so that a stable tree does not allocate
+			std::vector<std::size_t> parent_of = {};
+			std::vector<char>        task      = {}; // Bool: threads of the process of their parent
+
+			std::atomic<bool> toured = true;
+			std::mutex        mutex  = {}; // Serializes the rebuilds of concurrent queries
+		};
+
+		std::unique_ptr<tour_state> tour_ = std::make_unique<tour_state>();
+
+		std::unique_ptr<uring_collector> uring_ = {}; // Set if the io_uring backend is in use
+
+		std::size_t workers_ = default_workers(); // Threads of the parallel backend (the caller included)
+
+		std::unique_ptr<work_stealing_pool> pool_ = {}; // Set if the parallel backend is in use
+
+		std::unique_ptr<proc_connector> events_ = {}; // Forks and exits, if the tree is event-driven
+
+		bool rescan_ = true; // Scan proc_path_ on the next update (the events are not enough)
+
+		unique_fd proc_fd_ = {}; // proc_path_, opened once
+
+		pid_scanner scanner_ = {}; // Lists the PIDs in proc_path_
+
+		// Temporaries of update(), released on every update. The arena itself cannot move, the pointer can.
+		std::unique_ptr<scratch_arena> arena_ = std::make_unique<scratch_arena>();
+
+		std::size_t pid_max_ = read_pid_max(); // Read once, before the bitsets that it sizes
+
+		// Bookkeeping of update(), sized for every possible PID once and reused
+		pid_bitset old_pids_     = pid_bitset(pid_max_);
+		pid_bitset updated_pids_ = pid_bitset(pid_max_);
+		pid_bitset reached_      = pid_bitset(pid_max_); // Descendants of the root, in subtree scope
+		pid_bitset listed_       = pid_bitset(pid_max_); // Children and tasks of one parent, see link_parents()
+
+		change_log * log_ = nullptr; // Log of the running update(), if any, see refresh_row()
+
+		void open_proc_path()
+		{
+			// Check that the proc path exists
+			if (not std::filesystem::exists(proc_path_) or not std::filesystem::is_directory(proc_path_))
+			{
+				throw std::runtime_error("The proc path \"" + proc_path_.string() + "\" is not valid");
+			}
+
+			proc_fd_.reset(::open(proc_path_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+
+			if (std::cmp_equal(proc_fd_.get(), -1))
+			{
+				throw std::runtime_error("The proc path \"" + proc_path_.string() + "\" could not be opened");
+			}
+		}
+
+		[[nodiscard]] static auto default_workers() -> std::size_t
+		{
+			return std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, MAX_DEFAULT_WORKERS);
+		}
+
+		// Only needed to build new processes
+		[[nodiscard]] auto path_of(const queued_pid & queued) const
+		{
+			if (std::cmp_less(queued.tgid, 0)) { return proc_path_ / std::to_string(queued.pid); }
+			return proc_path_ / std::to_string(queued.tgid) / "task" / std::to_string(queued.pid);
+		}
+
+		// Hierarchy source of the processes: the children files are always read in subtree scope (see scope())
+		[[nodiscard]] auto followed_hierarchy() const
+		{
+			return scope_ == tree_scope::subtree ? hierarchy_source::children_files : hierarchy_;
+		}
+
+		void follow_hierarchy()
+		{
+			for (const auto & proc : handles_)
+			{
+				proc->hierarchy(followed_hierarchy());
+			}
+		}
+
+		// Process of "pid", or nullptr if it is not in the tree. O(1), through the PID -> slot index of the columns.
+		// Valid until a process is added.
+		[[nodiscard]] auto handle_of(const pid_t pid) const -> const proc_ptr_t *
+		{
+			const auto slot = store_.slot(pid);
+			return slot.has_value() ? &handles_[*slot] : nullptr;
+		}
+
+		// Add "proc" to the tree and to the columns
+		void add_row(const proc_ptr_t & proc)
+		{
+			store_.assign(*proc);
+			if (handles_.size() < store_.size()) { handles_.push_back(proc); }
+		}
+
+		void insert(const proc_ptr_t & proc)
+		{
+			// Check if the process is already in the tree
+			if (const auto * found = handle_of(proc->pid()); found not_eq nullptr)
+			{
+				// If the process is already in the tree, the new one is not needed
+				if (*found not_eq proc) { procs_.erase(proc); }
+				return;
+			}
+
+			// Add the process to the tree
+			add_row(proc);
+
+			// Add their tasks and children as well (if not already in the tree)
+			for (const auto & task : proc->tasks())
+			{
+				if (store_.contains(task)) { continue; }
+				const auto task_path = proc->path() / "task" / std::to_string(task);
+				add_row(make_proc_ptr(task, task_path.string()));
+			}
+
+			for (const auto & child : proc->children())
+			{
+				if (store_.contains(child)) { continue; }
+				add_row(make_proc_ptr(child));
+			}
+		}
+
+		// Build the process "pid" and add it to the tree. The tree is not toured again (see insert()).
+		auto add(const pid_t pid, const std::filesystem::path & path) -> proc_ptr_t
+		{
+			auto proc_ptr = make_proc_ptr(pid, path);
+			insert(proc_ptr);
+			return proc_ptr;
+		}
+
+		// Remove the process "pid" (if in the tree). The tree is not toured again (see erase()).
+		void remove(const pid_t pid)
+		{
+			const auto slot = store_.slot(pid);
+			if (not slot.has_value()) { return; }
+
+			const auto proc = handles_[*slot];
+
+			// Close its cached descriptors and remove the process. Handles to it become stale. The last row of the
+			// columns is moved into its slot, and so is the last handle.
+			shared_->fds.erase(proc->fd_key());
+			store_.erase(pid);
+			handles_[*slot] = handles_.back();
+			handles_.pop_back();
+			procs_.erase(proc);
+		}
+
+		// Update the processes already in the tree with the io_uring backend, then the tasks and children they have
+		// gained since the last update
+		void update_known(pid_bitset & updated_pids)
+		{
+			auto & fds = shared_->fds;
+
+			std::pmr::vector<proc_t *>      procs(arena_->resource());
+			std::pmr::vector<uring_request> requests(arena_->resource());
+
+			procs.reserve(handles_.size());
+			requests.reserve(uring_collector::BATCH_SIZE);
+
+			for (const auto & proc : handles_)
+			{
+				procs.emplace_back(proc.get());
+			}
+
+			// A batch at a time: updating a process may close descriptors of the fd cache (e.g. of a recycled PID), so
+			// those of a batch are looked up right before it is collected
+			for (std::size_t first = 0; first < procs.size(); first += uring_collector::BATCH_SIZE)
+			{
+				const auto n     = std::min(uring_collector::BATCH_SIZE, procs.size() - first);
+				const auto batch = std::span(procs).subspan(first, n);
+
+				requests.clear();
+
+				for (const auto * proc : batch)
+				{
+					const auto key = proc->fd_key();
+					requests.push_back({ proc->dir_path(), fds.find(key, proc_file::dir), fds.find(key, proc_file::stat),
+					                     fds.find(key, proc_file::children),
+					                     followed_hierarchy() == hierarchy_source::children_files,
+					                     fds.find(key, proc_file::schedstat), proc->tracks_schedstat() });
+				}
+
+				uring_->collect(requests, [&](const std::size_t /*first*/, const auto results) {
+					for (std::size_t i = 0; i < results.size(); ++i)
+					{
+						auto & proc   = *batch[i];
+						auto & result = results[i];
+
+						// The process has finished: it will be removed
+						if (result.stat_res == -ESRCH or result.stat_res == -ENOENT) { continue; }
+
+						try
+						{
+							if (result.ok())
+							{
+								const auto schedstat =
+								    proc.tracks_schedstat() ? std::optional(result.schedstat) : std::nullopt;
+								proc.update(result.stat, result.stx.stx_uid, result.children, schedstat);
+							}
+							else { proc.update(); } // E.g. the children do not fit in the buffer
+
+							updated_pids.set(proc.pid());
+						}
+						catch (...)
+						{
+							continue;
+						}
+
+						refresh_row(proc);
+
+						// Keep the descriptors opened for the batch (without direct descriptors)
+						if (std::cmp_not_equal(result.stat_fd, -1))
+						{
+							fds.insert(proc.fd_key(), proc_file::stat, std::exchange(result.stat_fd, -1));
+						}
+						if (std::cmp_not_equal(result.children_fd, -1))
+						{
+							fds.insert(proc.fd_key(), proc_file::children, std::exchange(result.children_fd, -1));
+						}
+						if (std::cmp_not_equal(result.schedstat_fd, -1))
+						{
+							fds.insert(proc.fd_key(), proc_file::schedstat, std::exchange(result.schedstat_fd, -1));
+						}
+					}
+				});
+			}
+
+			update_new(procs, updated_pids);
+		}
+
+		// Files of one process to read in a worker of the parallel backend. A descriptor of -1 means that the file has
+		// to be opened: relative to "dir_fd", or from the path "dir" if the folder is not open either.
+		struct parallel_request
+		{
+			std::string_view dir{};      // Path of the task folder (/proc/<pid>/task/<tid>)
+			int              dir_fd = -1; // O_PATH descriptor of the task folder
+
+			int  stat_fd        = -1;
+			int  children_fd    = -1;
+			int  schedstat_fd   = -1;
+			bool read_children  = true; // False if the children are derived from ppid (see hierarchy_source)
+			bool read_schedstat = false;
+		};
+
+		// Files read by a worker of the parallel backend. Descriptors that were not cached are handed over to the
+		// fd cache once the workers are done.
+		struct parallel_result
+		{
+			int  dir_fd       = -1;
+			int  stat_fd      = -1;
+			int  children_fd  = -1;
+			int  schedstat_fd = -1;
+			bool updated      = false;
+		};
+
+		// Read (and parse) the files of one process, the schedstat file included. Runs in any thread of the pool: only
+		// "proc" and "result" are written (the fd cache is not touched).
+		static void collect(proc_t & proc, const parallel_request & request, parallel_result & result)
+		{
+			thread_local std::string stat_buffer;
+			thread_local std::string children_buffer;
+			thread_local std::string schedstat_buffer;
+
+			int dir_fd = request.dir_fd;
+			if (std::cmp_equal(dir_fd, -1)) { dir_fd = result.dir_fd = open_proc_dir(request.dir); }
+
+			int stat_fd = request.stat_fd;
+			if (std::cmp_equal(stat_fd, -1)) { stat_fd = result.stat_fd = open_proc_file(dir_fd, "stat"); }
+
+			const auto stat_size = pread_proc_file(stat_fd, "stat", stat_buffer);
+
+			std::size_t children_size = 0;
+			if (request.read_children)
+			{
+				int children_fd = request.children_fd;
+				if (std::cmp_equal(children_fd, -1))
+				{
+					children_fd = result.children_fd = open_proc_file(dir_fd, "children");
+				}
+
+				children_size = pread_proc_file(children_fd, "children", children_buffer);
+			}
+
+			std::optional<std::string_view> schedstat_data;
+			if (request.read_schedstat)
+			{
+				int schedstat_fd = request.schedstat_fd;
+				if (std::cmp_equal(schedstat_fd, -1))
+				{
+					schedstat_fd = result.schedstat_fd = open_proc_file(dir_fd, "schedstat");
+				}
+
+				const auto schedstat_size = pread_proc_file(schedstat_fd, "schedstat", schedstat_buffer);
+				schedstat_data.emplace(schedstat_buffer.data(), schedstat_size);
+			}
+
+			proc.update(std::string_view(stat_buffer.data(), stat_size), proc_file_uid(stat_fd, "stat"),
+			            std::string_view(children_buffer.data(), children_size), schedstat_data, dir_fd);
+
+			result.updated = true;
+		}
+
+		// Update the processes already in the tree with the parallel backend: the workers read the files of the
+		// processes, then the results are merged into the tree by this thread
+		void update_known_parallel(pid_bitset & updated_pids)
+		{
+			auto & fds = shared_->fds;
+
+			std::pmr::vector<proc_t *>         procs(arena_->resource());
+			std::pmr::vector<parallel_request> requests(arena_->resource());
+
+			procs.reserve(handles_.size());
+			requests.reserve(handles_.size());
+
+			for (const auto & proc : handles_)
+			{
+				const auto key = proc->fd_key();
+
+				procs.emplace_back(proc.get());
+				requests.push_back({ proc->dir_path(), fds.find(key, proc_file::dir), fds.find(key, proc_file::stat),
+				                     fds.find(key, proc_file::children), fds.find(key, proc_file::schedstat),
+				                     followed_hierarchy() == hierarchy_source::children_files, proc->tracks_schedstat() });
+			}
+
+			std::pmr::vector<parallel_result> results(procs.size(), arena_->resource());
+
+			pool_->for_each(procs.size(), [&](const std::size_t i) {
+				try
+				{
+					collect(*procs[i], requests[i], results[i]);
+				}
+				catch (const std::runtime_error &)
+				{
+					// The process has finished: it will be removed. Anything else (e.g. std::bad_alloc) is rethrown
+					// by the pool.
+				}
+			});
+
+			// Reconciliation
+			for (std::size_t i = 0; i < procs.size(); ++i)
+			{
+				const auto & proc   = *procs[i];
+				const auto & result = results[i];
+
+				if (std::cmp_not_equal(result.dir_fd, -1))
+				{
+					fds.insert(proc.fd_key(), proc_file::dir, result.dir_fd);
+				}
+				if (std::cmp_not_equal(result.stat_fd, -1))
+				{
+					fds.insert(proc.fd_key(), proc_file::stat, result.stat_fd);
+				}
+				if (std::cmp_not_equal(result.children_fd, -1))
+				{
+					fds.insert(proc.fd_key(), proc_file::children, result.children_fd);
+				}
+				if (std::cmp_not_equal(result.schedstat_fd, -1))
+				{
+					fds.insert(proc.fd_key(), proc_file::schedstat, result.schedstat_fd);
+				}
+
+				if (result.updated)
+				{
+					updated_pids.set(proc.pid());
+					refresh_row(proc);
+				}
+			}
+
+			update_new(procs, updated_pids);
+		}
+
+		// Update the tasks and children of "procs" that are not in the tree yet
+		template<typename Procs>
+		void update_new(const Procs & procs, pid_bitset & updated_pids)
+		{
+			pid_queue to_update(arena_->resource());
+
+			for (const auto * proc : procs)
+			{
+				if (not updated_pids.test(proc->pid())) { continue; }
+
+				for (const auto & task : proc->task_pids())
+				{
+					if (store_.contains(task)) { continue; }
+					to_update.push({ task, proc->pid() });
+				}
+
+				for (const auto & child : proc->children_pids())
+				{
+					if (store_.contains(child)) { continue; }
+					to_update.push({ child });
+				}
+			}
+
+			update(to_update, updated_pids);
+		}
+
+		// Apply the events received since the last update: finished processes are removed and new ones are queued
+		// in "forked". Execs of processes of the tree are recorded in "log" (if any). Returns false if some events
+		// have been lost.
+		auto apply_events(pid_queue & forked, change_log * log) -> bool
+		{
+			return events_->poll([&](const process_event & event) {
+				switch (event.what)
+				{
+					case process_event::kind::fork:
+						if (std::cmp_equal(event.pid, event.tgid)) { forked.push({ event.pid }); }
+						else { forked.push({ event.pid, event.tgid }); }
+						break;
+					case process_event::kind::exec:
+						// New program image: build it again (e.g. the cmdline has changed)
+						if (log not_eq nullptr and old_pids_.test(event.pid))
+						{
+							log->record(process_change::kind::exec, event.pid);
+						}
+						remove(event.pid);
+						forked.push({ event.pid });
+						break;
+					case process_event::kind::exit:
+						remove(event.pid);
+						break;
+					default:
+						// The name is parsed from the stat file on every update
+						break;
+				}
+			});
+		}
+
+		static void check_rank_key(const rank_key key)
+		{
+			if (key >= rank_key::count)
+			{
+				const auto error = fmt::format("Invalid rank key {}", static_cast<std::size_t>(key));
+				throw std::runtime_error(error);
+			}
+		}
+
+		// Throw if "field" is not parsed from the stat files: "what" would only see its default value
+		static void check_parsed(const stat_field field, const std::string_view what)
+		{
+			if (not contains(proc_t::STAT_FIELDS, field))
+			{
+				const auto error = fmt::format("{} needs stat field {}, which the tree does not parse", what,
+				                               static_cast<unsigned>(field));
+				throw std::runtime_error(error);
+			}
+		}
+
+		// Offer "proc" to the rankings, with the same values as its row of the columns
+		void rank_process(const proc_t & proc)
+		{
+			const auto & stat = proc.stat_info();
+
+			rankings_[static_cast<std::size_t>(rank_key::cpu_use)].offer(proc.pid(), proc.cpu_use());
+			rankings_[static_cast<std::size_t>(rank_key::rss)].offer(proc.pid(), static_cast<double>(stat.rss));
+			rankings_[static_cast<std::size_t>(rank_key::majflt)].offer(proc.pid(), static_cast<double>(stat.majflt));
+		}
+
+		// Rank the rows of the columns by "key"
+		void rank_columns(top_k & ranking, const rank_key key) const
+		{
+			if (ranking.capacity() == 0) { return; }
+
+			ranking.clear();
+
+			const auto pids = store_.pids();
+
+			const auto offer_all = [&](const auto & values) {
+				for (std::size_t s = 0; s < pids.size(); ++s)
+				{
+					ranking.offer(pids[s], static_cast<double>(values[s]));
+				}
+			};
+
+			switch (key)
+			{
+				case rank_key::cpu_use:
+					offer_all(store_.cpu_uses());
+					break;
+				case rank_key::rss:
+					offer_all(store_.rsss());
+					break;
+				case rank_key::majflt:
+					offer_all(store_.majflts());
+					break;
+				default:
+					break;
+			}
+
+			ranking.finish();
+		}
+
+		// Index the rows of the columns by "key"
+		void index_columns(const index_key key)
+		{
+			if (not indexed_[static_cast<std::size_t>(key)]) { return; }
+
+			const auto pids       = store_.pids();
+			const auto processors = store_.processors();
+
+			switch (key)
+			{
+				case index_key::processor:
+					by_processor_.build(pids, [&](const std::size_t s) { return std::optional(processors[s]); });
+					break;
+				case index_key::numa_node:
+					by_numa_node_.build(pids, [&](const std::size_t s) {
+						const auto node = shared_->topology.node_of(processors[s]);
+						return node < 0 ? std::nullopt : std::optional(node);
+					});
+					break;
+				case index_key::uid:
+					by_uid_.build(pids, [&](const std::size_t s) { return std::optional(store_.uids()[s]); });
+					break;
+				case index_key::comm:
+					by_comm_.build(pids, [&](const std::size_t s) { return std::optional(store_.comm_ids()[s]); });
+					break;
+				default:
+					break;
+			}
+		}
+
+		static void check_index_key(const index_key key)
+		{
+			if (key >= index_key::count)
+			{
+				const auto error = fmt::format("Invalid index key {}", static_cast<std::size_t>(key));
+				throw std::runtime_error(error);
+			}
+		}
+
+		void check_indexed(const index_key key) const
+		{
+			check_index_key(key);
+
+			if (not indexed_[static_cast<std::size_t>(key)])
+			{
+				const auto error = fmt::format("Processes are not indexed by key {}", static_cast<std::size_t>(key));
+				throw std::runtime_error(error);
+			}
+		}
+
+		// Update the CPU time and, if tracked, the load of every CPU and its NUMA node and LLC domain, in one read
+		void update_cpu_time()
+		{
+			if (not track_cpu_loads_)
+			{
+				shared_->cpu_time.update();
+				return;
+			}
+
+			per_cpu_time_.update(shared_->cpu_time);
+			topology_load_.roll_up(shared_->topology, per_cpu_time_.cpus());
+		}
+
+		void check_cpu_loads() const
+		{
+			if (not track_cpu_loads_) { throw std::runtime_error("CPU loads are not tracked"); }
+		}
+
+		// Record the exec and the migration of "proc" since the last update. Must run before its row is refreshed.
+		void record_changes(const proc_t & proc, change_log & log) const
+		{
+			const auto pid = proc.pid();
+
+			// New processes are recorded once the tree is complete
+			if (not old_pids_.test(pid)) { return; }
+
+			if (proc.renamed() or proc.cmdline_changed()) { log.record(process_change::kind::exec, pid); }
+
+			const auto row = store_.find(pid);
+			if (not row.has_value() or row->processor() == proc.processor()) { return; }
+
+			log.record({ process_change::kind::migrate, pid, row->processor(), proc.processor(),
+			             shared_->topology.node_of(row->processor()), shared_->topology.node_of(proc.processor()) });
+		}
+
+		// Refresh the row of "proc" in place, right after it has been updated, and rank it. Its changes are recorded
+		// first, while the row still holds the values of the last update.
+		void refresh_row(const proc_t & proc)
+		{
+			if (log_ not_eq nullptr) { record_changes(proc, *log_); }
+			store_.assign(proc);
+			rank_process(proc);
+		}
+
+		// Slot of the parent of a root of the tree
+		static constexpr auto NO_PARENT = euler_tour::NO_PARENT;
+
+		// Slots of the columns grouped by the slot of their parent: rows [first[p], first[p + 1]) of "linked" are the
+		// slots of the children of slot p
+		struct slot_groups
+		{
+			std::pmr::vector<std::size_t> first;
+			std::pmr::vector<std::size_t> linked;
+		};
+
+		// Counting sort of the slots by "parent_of" (the slot of the parent of every slot, or NO_PARENT), O(n)
+		[[nodiscard]] static auto group_by_parent(const std::span<const std::size_t> parent_of,
+		                                          std::pmr::memory_resource *      scratch) -> slot_groups
+		{
+			const auto n_rows = parent_of.size();
+
+			slot_groups groups{ std::pmr::vector<std::size_t>(n_rows + 1, 0, scratch),
+				                std::pmr::vector<std::size_t>(scratch) };
+
+			auto & [first, linked] = groups;
+
+			for (const auto parent : parent_of)
+			{
+				if (parent not_eq NO_PARENT) { ++first[parent + 1]; }
+			}
+
+			std::partial_sum(first.begin(), first.end(), first.begin());
+
+			std::pmr::vector<std::size_t> next(first.begin(), first.end() - 1, scratch);
+			linked.resize(first.back());
+
+			for (std::size_t s = 0; s < n_rows; ++s)
+			{
+				if (parent_of[s] not_eq NO_PARENT) { linked[next[parent_of[s]]++] = s; }
+			}
+
+			return groups;
+		}
+
+		// Add every process to the children (or tasks) of its parent, if the parent does not list it yet. The edges are
+		// taken from the ppid and lwp columns and grouped by the slot of the parent with a counting sort, so the whole
+		// pass is linear in the number of processes and does not read from proc_path_.
+		void link_parents(std::pmr::memory_resource * scratch)
+		{
+			const auto pids  = store_.pids();
+			const auto ppids = store_.ppids();
+			const auto lwps  = store_.lwps();
+
+			const auto n_rows = pids.size();
+
+			// Slot of the parent of every slot
+			std::pmr::vector<std::size_t> parent_of(n_rows, NO_PARENT, scratch);
+
+			for (std::size_t s = 0; s < n_rows; ++s)
+			{
+				if (pids[s] == root_) { continue; }
+
+				const auto parent = store_.slot(ppids[s]);
+				if (not parent.has_value() or *parent == s) { continue; }
+
+				parent_of[s] = *parent;
+			}
+
+			const auto [first, linked] = group_by_parent(parent_of, scratch);
+
+			for (std::size_t p = 0; p < n_rows; ++p)
+			{
+				if (first[p] == first[p + 1]) { continue; }
+
+				auto & parent = *handles_[p];
+
+				// Mark what the parent lists already, so every child is checked in O(1)
+				const auto mark = [&](const auto & set_or_reset) {
+					ranges::for_each(parent.children_pids(), set_or_reset);
+					ranges::for_each(parent.task_pids(), set_or_reset);
+				};
+
+				mark([&](const pid_t pid) { listed_.set(pid); });
+
+				for (auto i = first[p]; i < first[p + 1]; ++i)
+				{
+					const auto s   = linked[i];
+					const auto pid = pids[s];
+
+					if (listed_.test(pid)) { continue; }
+					listed_.set(pid);
+
+					if (lwps[s] not_eq 0) { parent.link_task(pid); }
+					else { parent.link_child(pid); }
+				}
+
+				mark([&](const pid_t pid) { listed_.reset(pid); });
+			}
+		}
+
+		// Slot of the parent of every slot of the columns along the children and tasks of the processes (NO_PARENT if
+		// none), and whether it is a task of its parent. A process listed by several parents belongs to the first one.
+		void link_slots(std::span<std::size_t> parent_of, std::span<char> task) const
+		{
+			for (const auto & proc : handles_)
+			{
+				const auto parent = store_.slot(proc->pid());
+				if (not parent.has_value()) { continue; }
+
+				const auto link = [&](const pid_t pid, const bool is_task) {
+					const auto s = store_.slot(pid);
+					if (not s.has_value() or *s == *parent or parent_of[*s] not_eq NO_PARENT) { return; }
+
+					parent_of[*s] = *parent;
+					task[*s]      = static_cast<char>(is_task);
+				};
+
+				ranges::for_each(proc->task_pids(), [&](const pid_t pid) { link(pid, true); });
+				ranges::for_each(proc->children_pids(), [&](const pid_t pid) { link(pid, false); });
+			}
+		}
+
+		// Rebuild the Euler tour of the tree, and the totals of the subtrees if aggregated, O(n). The subtrees follow
+		// the children and tasks of the processes.
+		void tour_columns() const
+		{
+			auto & state = *tour_;
+
+			const auto n_rows = store_.size();
+
+			state.parent_of.assign(n_rows, NO_PARENT);
+			state.task.assign(n_rows, 0);
+			link_slots(state.parent_of, state.task);
+
+			state.tour.build(store_.pids(), state.parent_of);
+
+			aggregate_columns();
+
+			state.toured.store(true, std::memory_order_release);
+		}
+
+		// Euler tour of the tree, rebuilt (with the totals of the subtrees) if the tree has changed since update().
+		// Many insert() or erase() calls in a row cost a single rebuild, O(n).
+		[[nodiscard]] auto current_tour() const -> const euler_tour &
+		{
+			auto & state = *tour_;
+
+			if (not state.toured.load(std::memory_order_acquire))
+			{
+				const std::lock_guard lock(state.mutex);
+				if (not state.toured.load(std::memory_order_relaxed)) { tour_columns(); }
+			}
+			return state.tour;
+		}
+
+		// Total the columns over the subtree of every slot, children before parents (reverse pre-order), O(n)
+		void aggregate_columns() const
+		{
+			if (not aggregated_) { return; }
+
+			auto & state = *tour_;
+
+			const auto cpu_uses = store_.cpu_uses();
+			const auto rsss     = store_.rsss();
+			const auto majflts  = store_.majflts();
+
+			state.aggregates.resize(store_.size());
+
+			for (std::size_t s = 0; s < state.aggregates.size(); ++s)
+			{
+				const auto is_task  = state.task[s] not_eq 0;
+				state.aggregates[s] = { cpu_uses[s], is_task ? 0 : rsss[s], majflts[s], 1, is_task ? 0U : 1U };
+			}
+
+			for (const auto s : state.tour.rows() | ranges::views::reverse)
+			{
+				const auto parent = state.parent_of[s];
+				if (parent not_eq NO_PARENT) { state.aggregates[parent] += state.aggregates[s]; }
+			}
+		}
+
+		// Mark in reached_ the processes of the tree that can be reached from the root through children and tasks
+		void mark_subtree(std::pmr::memory_resource * scratch)
+		{
+			reached_.clear();
+
+			pid_queue to_visit(scratch);
+			if (store_.contains(root_)) { to_visit.push({ root_ }); }
+
+			while (not to_visit.empty())
+			{
+				const auto pid = to_visit.front().pid;
+				to_visit.pop();
+
+				if (reached_.test(pid)) { continue; }
+				reached_.set(pid);
+
+				const auto * proc = handle_of(pid);
+				if (proc == nullptr) { continue; }
+
+				for (const auto & task : (*proc)->task_pids())
+				{
+					to_visit.push({ task });
+				}
+
+				for (const auto & child : (*proc)->children_pids())
+				{
+					to_visit.push({ child });
+				}
+			}
+		}
+
+		void print_level(std::ostream & os, const proc_t & p, const size_t level = 0) const
+		{
+			static constexpr size_t TAB_SIZE = 3;
+
+			for (const auto i : ranges::views::indices(size_t(), level * TAB_SIZE))
+			{
+				os << ((i % TAB_SIZE == 0 and i > 0) ? TREE_STR_VERT : " ");
+			}
+
+			if (level not_eq 0) { os << TREE_STR_RTEE << TREE_STR_HORZ << " "; }
+
+			os << p << '\n';
+
+			for (const auto & child : p.children_and_tasks())
+			{
+				const auto & child_proc = get(child);
+				if (not child_proc.has_value()) { continue; }
+				print_level(os, *child_proc.value(), level + 1);
+			}
+		}
+
+		// Update the tree. If "log" is not null, it is cleared and the changes of this update are recorded in it.
+		void update(change_log * log)
+		{
+			if (log not_eq nullptr) { log->clear(); }
+			log_ = log;
+
+			// The temporaries of the previous update are not needed anymore
+			auto * scratch = arena_->reset();
+
+			update_cpu_time();
+
+			// PIDs in the tree before the update
+			old_pids_.clear();
+			ranges::for_each(store_.pids(), [&](const auto & pid) { old_pids_.set(pid); });
+
+			// Set of updated PIDs to avoid updating the same process twice
+			updated_pids_.clear();
+
+			// Processes created since the last update, if the tree is event-driven
+			pid_queue forked(scratch);
+
+			// The processes are ranked as their rows are refreshed
+			ranges::for_each(rankings_, [](top_k & ranking) { ranking.clear(); });
+
+			const bool subtree = scope_ == tree_scope::subtree;
+
+			const bool scan = events_ == nullptr or not apply_events(forked, log) or std::exchange(rescan_, false);
+
+			// Update the processes already in the tree in batches
+			if (uring_ not_eq nullptr) { update_known(updated_pids_); }
+			else if (pool_ not_eq nullptr) { update_known_parallel(updated_pids_); }
+
+			pid_queue to_update(scratch);
+
+			const auto update_pid = [&](const pid_t pid) {
+				// Check if the PID is already updated
+				if (updated_pids_.test(pid)) { return; }
+
+				// Update in "tree-mode"
+				to_update.push({ pid });
+				update(to_update, updated_pids_);
+			};
+
+			if (subtree)
+			{
+				// New descendants are found through the children and tasks of their ancestors
+				update_pid(root_);
+				update(forked, updated_pids_);
+			}
+			else if (scan) { scanner_.scan(proc_fd_.get(), update_pid); }
+			else
+			{
+				// Only the processes already in the tree and the new ones. Updating adds rows: go through a copy of
+				// the PIDs.
+				const auto pids = store_.pids();
+				ranges::for_each(std::pmr::vector<pid_t>(pids.begin(), pids.end(), scratch), update_pid);
+				update(forked, updated_pids_);
+			}
+
+			// Make sure that all processes know their children/tasks
+			link_parents(scratch);
+
+			// Remove the processes that couldn't be updated (old & ~updated, a word at a time)
+			pid_bitset::for_each_difference(old_pids_, updated_pids_, [&](const pid_t pid) { remove(pid); });
+
+			// Remove the processes that are not descendants of the root anymore (e.g. orphans adopted by init)
+			if (subtree)
+			{
+				mark_subtree(scratch);
+
+				// Collect them first: erasing moves the rows around
+				std::pmr::vector<pid_t> outside(scratch);
+				for (const auto pid : store_.pids())
+				{
+					if (not reached_.test(pid)) { outside.emplace_back(pid); }
+				}
+
+				ranges::for_each(outside, [&](const auto & pid) { remove(pid); });
+
+				// Some of them may have been ranked: rank the processes that are left again (rare, the subtree
+				// rarely loses a process that is still alive)
+				if (not outside.empty())
+				{
+					for (std::size_t key = 0; key < rankings_.size(); ++key)
+					{
+						rank_columns(rankings_[key], static_cast<rank_key>(key));
+					}
+				}
+			}
 
-namespace prox
-{
-	static const auto write_into_bool_vector = [](std::vector<bool> & vec, const auto & pos, const auto & value) {
-		if (std::cmp_less(pos, 0)) { throw std::runtime_error("Cannot write into a negative position"); }
-		const auto pos_ = static_cast<std::size_t>(pos);
-		if (std::cmp_less_equal(vec.size(), pos)) { vec.resize(pos_ + 1, false); }
-		vec.at(pos_) = value;
-	};
+			ranges::for_each(rankings_, [](top_k & ranking) { ranking.finish(); });
 
-	static const auto read_from_bool_vector = [](const std::vector<bool> & vec, const auto & pos) -> bool {
-		if (std::cmp_less(pos, 0)) { throw std::runtime_error("Cannot read from a negative position"); }
-		const auto pos_ = static_cast<std::size_t>(pos);
-		if (std::cmp_less_equal(vec.size(), pos)) { return false; }
-		return vec.at(pos_);
-	};
+			// Index them
+			store_.compact_comms();
+			for (std::size_t key = 0; key < indexed_.size(); ++key)
+			{
+				index_columns(static_cast<index_key>(key));
+			}
 
-	// taken from https://stackoverflow.com/a/478960
-	template<size_t buff_length = 128>
-	auto exec_cmd(const std::string_view cmd, const bool truncate_final_newlines = true) -> std::string
-	{
-		std::array<char, buff_length> buffer{};
+			// And tour (and total) their subtrees
+			tour_columns();
 
-		std::string result;
+			if (log not_eq nullptr)
+			{
+				for (const auto pid : store_.pids())
+				{
+					if (not old_pids_.test(pid)) { log->record(process_change::kind::spawn, pid); }
+				}
 
-		const std::unique_ptr<std::FILE, decltype(&pclose)> pipe(popen(cmd.data(), "r"), pclose);
+				old_pids_.for_each([&](const pid_t pid) {
+					if (not store_.contains(pid)) { log->record(process_change::kind::exit, pid); }
+				});
+			}
 
-		if (pipe == nullptr) { throw std::runtime_error("Could not execute command " + std::string(cmd)); }
+			log_ = nullptr;
+		}
 
-		while (fgets(buffer.data(), buffer.size(), pipe.get()) not_eq nullptr)
+	public:
+		basic_process_tree()
 		{
-			result += buffer.data();
+			open_proc_path();
+
+			update();
+
+			// Check that the root process exists
+			if (not store_.contains(root_))
+			{
+				throw std::runtime_error("The root process \"" + std::to_string(root_) + "\" is not valid");
+			}
+
+			// Check that the tree is not empty
+			if (store_.empty()) { throw std::runtime_error("The process tree is empty"); }
 		}
 
-		if (truncate_final_newlines)
+		basic_process_tree(const pid_t root, std::filesystem::path proc_path,
+		                   const tree_scope scope = tree_scope::system) :
+		    root_(root), scope_(scope), proc_path_(std::move(proc_path))
 		{
-			// Remove last '\n' (if there is one)
-			while (result[result.length() - 1] == '\n')
+			open_proc_path();
+
+			update();
+
+			// Check that the root process exists
+			if (not store_.contains(root_))
 			{
-				result.pop_back();
+				throw std::runtime_error("The root process \"" + std::to_string(root_) + "\" is not valid");
 			}
+
+			// Check that the tree is not empty
+			if (store_.empty()) { throw std::runtime_error("The process tree is empty"); }
 		}
 
-		return result;
-	}
+		// The moved-from tree can only be assigned to or destroyed
+		basic_process_tree(basic_process_tree &&)                     = default;
+		auto operator=(basic_process_tree &&) -> basic_process_tree & = default;
 
-	class process_tree
-	{
-		using proc_t     = process<CPU_time>;
-		using proc_ptr_t = std::shared_ptr<proc_t>;
+		basic_process_tree(const basic_process_tree &)                     = delete;
+		auto operator=(const basic_process_tree &) -> basic_process_tree & = delete;
 
-		template<typename... Args>
-		[[nodiscard]] static auto make_proc_ptr(Args &&... args)
+		~basic_process_tree() = default;
+
+		auto find(const pid_t pid) -> auto &
 		{
-			return std::make_shared<proc_t>(args...);
+			const auto * proc = handle_of(pid);
+
+			// If the process is not found, throw an exception
+			if (proc == nullptr) { throw std::runtime_error("Process not found"); }
+
+			return **proc;
 		}
 
-		static constexpr const char * TREE_STR_HORZ = "\xe2\x94\x80"; // TREE_STR_HORZ ─
-		static constexpr const char * TREE_STR_VERT = "\xe2\x94\x82"; // TREE_STR_VERT │
-		static constexpr const char * TREE_STR_RTEE = "\xe2\x94\x9c"; // TREE_STR_RTEE ├
-		static constexpr const char * TREE_STR_BEND = "\xe2\x94\x94"; // TREE_STR_BEND └
-		static constexpr const char * TREE_STR_TEND = "\xe2\x94\x8c"; // TREE_STR_TEND ┌
-		static constexpr const char * TREE_STR_OPEN = "+";            // TREE_STR_OPEN +
-		static constexpr const char * TREE_STR_SHUT = "\xe2\x94\x80"; // TREE_STR_SHUT ─
+		auto find(const pid_t pid) const -> const auto &
+		{
+			const auto * proc = handle_of(pid);
 
-		static constexpr pid_t DEFAULT_ROOT      = 1;
-		static constexpr auto  DEFAULT_PROC_PATH = "/proc";
+			// If the process is not found, throw an exception
+			if (proc == nullptr) { throw std::runtime_error("Process not found"); }
 
-		pid_t root_ = DEFAULT_ROOT;
+			return **proc;
+		}
 
-		std::filesystem::path proc_path_ = DEFAULT_PROC_PATH;
+		[[nodiscard]] auto root() const -> pid_t { return root_; }
 
-		CPU_time cpu_time_ = {};
+		// Takes effect on the next update
+		void root(const pid_t root) { root_ = root; }
 
-		std::map<pid_t, proc_ptr_t> processes_ = {};
+		[[nodiscard]] auto scope() const { return scope_; }
 
-		void insert(const proc_ptr_t & proc_)
+		// With tree_scope::subtree, update() only follows the children and tasks of the root, so its cost depends on
+		// the size of the subtree instead of the number of processes of the system: the children files are read
+		// whatever hierarchy() says, and the rest of the proc folder is never listed. Takes effect on the next update.
+		void scope(const tree_scope scope)
 		{
-			// Check if the process is already in the tree
-			if (const auto find_it = processes_.find(proc_->pid()); find_it not_eq processes_.end())
-			{
-				// If the process is already in the tree, nothing to do...
-				return;
-			}
+			scope_ = scope;
+			follow_hierarchy();
+		}
 
-			// Add the process to the tree
-			const auto & [it, inserted] = processes_.try_emplace(proc_->pid(), proc_);
+		[[nodiscard]] auto hierarchy() const { return hierarchy_; }
+
+		// With hierarchy_source::ppid, the children files are not read: every process is linked to its parent from
+		// the ppid of its stat file. Only in system scope: in subtree scope, the children files are the only way to
+		// find new descendants without reading the stat file of every process of the system (see scope()).
+		// Takes effect on the next update.
+		void hierarchy(const hierarchy_source hierarchy)
+		{
+			hierarchy_ = hierarchy;
+			follow_hierarchy();
+		}
 
-			auto & [pid, proc] = *it;
+		[[nodiscard]] auto begin() const
+		{
+			auto proc_view = handles_ | ranges::views::indirect;
+			return proc_view.begin();
+		}
 
-			// Add their tasks and children as well (if not already in the tree)
-			for (const auto & task : proc->tasks())
+		[[nodiscard]] auto end() const
+		{
+			auto proc_view = handles_ | ranges::views::indirect;
+			return proc_view.end();
+		}
+
+		[[nodiscard]] auto size() const { return store_.size(); }
+
+		// Maximum number of procfs descriptors kept open between updates. Once reached, the descriptors of the tasks that
+		// did not fit are opened and closed on every update, see fd_cache.
+		[[nodiscard]] auto max_open_fds() const { return shared_->fds.max_open_fds(); }
+
+		void max_open_fds(const std::size_t max_open_fds) { shared_->fds.max_open_fds(max_open_fds); }
+
+		[[nodiscard]] auto open_fds() const { return shared_->fds.open_fds(); }
+
+		[[nodiscard]] auto backend() const
+		{
+			if (uring_ not_eq nullptr) { return collection_backend::io_uring; }
+			if (pool_ not_eq nullptr) { return collection_backend::parallel; }
+			return collection_backend::synchronous;
+		}
+
+		// Select how the processes are read on update(). Falls back to the synchronous backend if io_uring is not
+		// available. Returns the backend in use.
+		auto backend(const collection_backend backend) -> collection_backend
+		{
+			uring_.reset();
+			pool_.reset();
+
+			if (backend == collection_backend::parallel) { pool_ = std::make_unique<work_stealing_pool>(workers_); }
+
+			if (backend == collection_backend::io_uring)
 			{
-				const auto task_path = proc->path() / "task" / std::to_string(task);
-				std::ignore          = processes_.try_emplace(task, make_proc_ptr(task, task_path.string(), cpu_time_));
+				try
+				{
+					uring_ = std::make_unique<uring_collector>();
+				}
+				catch (const std::exception &)
+				{
+					// Keep the synchronous backend
+				}
 			}
 
-			for (const auto & child : proc->children())
+			return this->backend();
+		}
+
+		// Find new and finished processes from the events of the kernel proc connector, instead of scanning proc_path_
+		// on every update. proc_path_ is only scanned on the next update and when events are lost. Returns false if
+		// the proc connector is not available (it needs CAP_NET_ADMIN).
+		auto watch_events() -> bool
+		{
+			try
+			{
+				watch_events(proc_connector{});
+				return true;
+			}
+			catch (const std::exception &)
 			{
-				std::ignore = processes_.try_emplace(child, make_proc_ptr(child, cpu_time_));
+				return false;
 			}
 		}
 
-		void print_level(std::ostream & os, const proc_t & p, const size_t level = 0) const
+		// Same, with the events of "events" (e.g. replayed by a test)
+		void watch_events(proc_connector events)
 		{
-			static constexpr size_t TAB_SIZE = 3;
+			events_ = std::make_unique<proc_connector>(std::move(events));
+			rescan_ = true; // Forks before the subscription are not reported
+		}
 
-			for (const auto i : ranges::views::indices(size_t(), level * TAB_SIZE))
+		void stop_watching_events() { events_.reset(); }
+
+		[[nodiscard]] auto watching_events() const { return events_ not_eq nullptr; }
+
+		// Number of threads of the parallel backend, including the one that calls update()
+		[[nodiscard]] auto workers() const { return workers_; }
+
+		void workers(const std::size_t workers)
+		{
+			workers_ = std::max<std::size_t>(workers, 1);
+
+			if (pool_ not_eq nullptr) { pool_ = std::make_unique<work_stealing_pool>(workers_); }
+		}
+
+		// Processes of the tree, in the order of the rows of columns()
+		[[nodiscard]] auto processes() const { return handles_ | ranges::views::indirect; }
+
+		// Most used fields of processes(), as columns for linear scans. The rows are refreshed as the processes are
+		// updated.
+		[[nodiscard]] auto columns() const -> const process_store & { return store_; }
+
+		// Keep the "capacity" processes with the highest "key" ranked on every update (0 stops ranking them).
+		// The processes are offered to the ranking as their rows are refreshed, right after their CPU use is
+		// computed, so there is no pass of its own: O(log capacity) per process. Throws if "key" is rank_key::count,
+		// or if its field is not parsed from the stat files (e.g. rank_key::rss on a cpu_process_tree).
+		void rank(const rank_key key, const std::size_t capacity)
+		{
+			check_rank_key(key);
+
+			if (capacity not_eq 0)
 			{
-				os << ((i % TAB_SIZE == 0 and i > 0) ? TREE_STR_VERT : " ");
+				if (key == rank_key::rss) { check_parsed(stat_field::rss, "Ranking by RSS"); }
+				if (key == rank_key::majflt) { check_parsed(stat_field::majflt, "Ranking by major faults"); }
 			}
 
-			if (level not_eq 0) { os << TREE_STR_RTEE << TREE_STR_HORZ << " "; }
+			auto & ranking = rankings_[static_cast<std::size_t>(key)];
+			ranking        = top_k(capacity);
+			rank_columns(ranking, key);
+		}
 
-			os << p << '\n';
+		// The (at most) "k" processes with the highest "key" at the last update, highest first. Throws if "key" is
+		// not ranked. O(1): ranked_pid::pid can be looked up with find() or columns().find().
+		[[nodiscard]] auto top(const rank_key key, const std::size_t k) const -> std::span<const ranked_pid>
+		{
+			check_rank_key(key);
 
-			for (const auto & child : p.children_and_tasks())
+			const auto & ranking = rankings_[static_cast<std::size_t>(key)];
+
+			if (ranking.capacity() == 0)
 			{
-				const auto & child_proc = get(child);
-				if (not child_proc.has_value()) { continue; }
-				print_level(os, *child_proc.value(), level + 1);
+				const auto error = fmt::format("Processes are not ranked by key {}", static_cast<std::size_t>(key));
+				throw std::runtime_error(error);
 			}
+
+			return ranking.top(k);
 		}
 
-	public:
-		process_tree()
+		[[nodiscard]] auto top_cpu(const std::size_t k) const { return top(rank_key::cpu_use, k); }
+
+		// Keep the processes indexed by "key" on every update (false stops indexing them). Indexing costs O(n)
+		// per update, plus O(k log k) for the k processes whose key changed; a query is O(log n) and returns a span
+		// into the index. Throws if "key" is index_key::count, or if it is index_key::comm and the comm is not parsed
+		// from the stat files (e.g. on a cpu_process_tree).
+		void index(const index_key key, const bool enable)
 		{
-			// Check that the proc path exists
-			if (not std::filesystem::exists(proc_path_) or not std::filesystem::is_directory(proc_path_))
+			check_index_key(key);
+
+			if (enable and key == index_key::comm) { check_parsed(stat_field::comm, "Indexing by comm"); }
+
+			indexed_[static_cast<std::size_t>(key)] = enable;
+
+			if (key == index_key::comm and enable not_eq store_.intern_comms())
 			{
-				throw std::runtime_error("The proc path \"" + proc_path_.string() + "\" is not valid");
+				// The rows need their comm ids
+				store_.intern_comms(enable);
+				if (enable)
+				{
+					for (const auto & proc : handles_)
+					{
+						store_.assign(*proc);
+					}
+				}
 			}
 
-			update();
-
-			// Check that the root process exists
-			if (not processes_.contains(root_))
+			if (enable) { index_columns(key); }
+			else
 			{
-				throw std::runtime_error("The root process \"" + std::to_string(root_) + "\" is not valid");
+				switch (key)
+				{
+					case index_key::processor:
+						by_processor_.clear();
+						break;
+					case index_key::numa_node:
+						by_numa_node_.clear();
+						break;
+					case index_key::uid:
+						by_uid_.clear();
+						break;
+					case index_key::comm:
+						by_comm_.clear();
+						break;
+					default:
+						break;
+				}
 			}
+		}
 
-			// Check that the tree is not empty
-			if (processes_.empty()) { throw std::runtime_error("The process tree is empty"); }
+		// Throws if "key" is index_key::count
+		[[nodiscard]] auto indexed(const index_key key) const
+		{
+			check_index_key(key);
+			return indexed_[static_cast<std::size_t>(key)];
 		}
 
-		process_tree(const pid_t root, std::filesystem::path proc_path) : root_(root), proc_path_(std::move(proc_path))
+		// Read the load of every CPU and total it per NUMA node and LLC domain on every update (false stops it). The
+		// loads are read right away, so the first deltas are the time since boot.
+		void track_cpu_loads(const bool enable)
 		{
-			// Check that the proc path exists
-			if (not std::filesystem::exists(proc_path_) or not std::filesystem::is_directory(proc_path_))
-			{
-				throw std::runtime_error("The proc path \"" + proc_path_.string() + "\" is not valid");
-			}
+			track_cpu_loads_ = enable;
+			if (enable) { update_cpu_time(); }
+		}
 
-			update();
+		[[nodiscard]] auto tracks_cpu_loads() const { return track_cpu_loads_; }
 
-			// Check that the root process exists
-			if (not processes_.contains(root_))
+		// Read the schedstat file of every process on every update (false stops it), for CPU usages and run-queue
+		// delays in nanoseconds. See process::schedstat(). The io_uring backend collects them in the same batches as
+		// the stat files.
+		void track_schedstat(const bool enable)
+		{
+			track_schedstat_ = enable;
+			for (const auto & proc : handles_)
 			{
-				throw std::runtime_error("The root process \"" + std::to_string(root_) + "\" is not valid");
+				proc->track_schedstat(enable);
 			}
+		}
 
-			// Check that the tree is not empty
-			if (processes_.empty()) { throw std::runtime_error("The process tree is empty"); }
+		[[nodiscard]] auto tracks_schedstat() const { return track_schedstat_; }
+
+		// Topology of the CPUs, discovered when the tree is built
+		[[nodiscard]] auto topology() const -> const cpu_topology & { return shared_->topology; }
+
+		// Read the topology again after CPUs have been plugged or unplugged. The processes see the new one at once.
+		void refresh_topology()
+		{
+			if (shared_->topology.size() == 0) { shared_->topology = cpu_topology::discover(); }
+			else { shared_->topology.refresh(); }
 		}
 
-		auto find(const pid_t pid) -> auto &
+		// Load of every CPU at the last update, indexed by CPU number. Throws if the loads are not tracked.
+		[[nodiscard]] auto cpu_loads() const -> std::span<const cpu_load>
 		{
-			const auto & proc_it = processes_.find(pid);
+			check_cpu_loads();
+			return per_cpu_time_.cpus();
+		}
 
-			// If the process is not found, throw an exception
-			if (proc_it == processes_.end()) { throw std::runtime_error("Process not found"); }
+		// Load of every NUMA node at the last update. Throws if the loads are not tracked.
+		[[nodiscard]] auto node_loads() const -> std::span<const cpu_load>
+		{
+			check_cpu_loads();
+			return topology_load_.nodes();
+		}
 
-			return *proc_it->second;
+		// Load of every LLC domain (see cpu_topology::llc_of()) at the last update. Throws if the loads are not
+		// tracked.
+		[[nodiscard]] auto llc_loads() const -> std::span<const cpu_load>
+		{
+			check_cpu_loads();
+			return topology_load_.llcs();
 		}
 
-		auto find(const pid_t pid) const -> const auto &
+		// Total the CPU use, RSS, major faults and threads of the subtree of every process on every update (false
+		// stops it). Aggregating costs O(n) per update, over the columns. Throws if the RSS or the major faults are not
+		// parsed from the stat files (e.g. on a cpu_process_tree).
+		void aggregate_subtrees(const bool enable)
 		{
-			const auto & proc_it = processes_.find(pid);
+			if (enable)
+			{
+				check_parsed(stat_field::rss, "Aggregating the subtrees");
+				check_parsed(stat_field::majflt, "Aggregating the subtrees");
+			}
 
-			// If the process is not found, throw an exception
-			if (proc_it == processes_.end()) { throw std::runtime_error("Process not found"); }
+			aggregated_ = enable;
 
-			return *proc_it->second;
+			if (enable) { tour_->toured = false; }
+			else { tour_->aggregates.clear(); }
 		}
 
-		[[nodiscard]] auto root() const -> pid_t { return root_; }
+		[[nodiscard]] auto aggregated() const { return aggregated_; }
 
-		[[nodiscard]] auto begin() const
+		// Totals of "pid" and its descendants at the last update, or std::nullopt if "pid" is not in the tree. Throws
+		// if the subtrees are not aggregated. O(1).
+		[[nodiscard]] auto subtree(const pid_t pid) const -> std::optional<subtree_aggregate>
 		{
-			auto proc_view = processes_ | ranges::views::values | ranges::views::indirect;
-			return proc_view.begin();
+			if (not aggregated_) { throw std::runtime_error("Subtrees are not aggregated"); }
+
+			static_cast<void>(current_tour());
+
+			const auto slot = store_.slot(pid);
+			if (not slot.has_value() or *slot >= tour_->aggregates.size()) { return std::nullopt; }
+
+			return tour_->aggregates[*slot];
 		}
 
-		[[nodiscard]] auto end() const
+		// PIDs (sorted) of the processes on "processor" at the last update. Throws if the processor is not indexed.
+		[[nodiscard]] auto on_processor(const int processor) const -> std::span<const pid_t>
 		{
-			auto proc_view = processes_ | ranges::views::values | ranges::views::indirect;
-			return proc_view.end();
+			check_indexed(index_key::processor);
+			return by_processor_.of(processor);
 		}
 
-		[[nodiscard]] auto size() const { return processes_.size(); }
+		// PIDs (sorted) of the processes on "numa_node" at the last update. Throws if the node is not indexed.
+		[[nodiscard]] auto on_numa_node(const int numa_node) const -> std::span<const pid_t>
+		{
+			check_indexed(index_key::numa_node);
+			return by_numa_node_.of(numa_node);
+		}
+
+		// PIDs (sorted) of the processes of "uid" at the last update. Throws if the uid is not indexed.
+		[[nodiscard]] auto of_uid(const uid_t uid) const -> std::span<const pid_t>
+		{
+			check_indexed(index_key::uid);
+			return by_uid_.of(uid);
+		}
 
-		[[nodiscard]] auto processes() const { return processes_ | ranges::views::values | ranges::views::indirect; }
+		// PIDs (sorted) of the processes named "comm" at the last update. Throws if the comm is not indexed.
+		[[nodiscard]] auto with_comm(const std::string_view comm) const -> std::span<const pid_t>
+		{
+			check_indexed(index_key::comm);
+			const auto id = store_.comms().find(comm);
+			return id.has_value() ? by_comm_.of(*id) : std::span<const pid_t>{};
+		}
 
 		auto insert(const pid_t pid, const std::filesystem::path & path) -> proc_ptr_t
 		{
 			// Try to find it within the process tree. If the process is found, nothing to do...
-			if (const auto proc_it = processes_.find(pid); proc_it not_eq processes_.end()) { return proc_it->second; }
+			if (const auto * proc = handle_of(pid); proc not_eq nullptr) { return *proc; }
 
-			// Otherwise, try to create a new process
-			auto proc_ptr = make_proc_ptr(pid, path, cpu_time_);
-			insert(proc_ptr);
+			// Otherwise, try to create a new process. The subtrees it joins are toured again on the next query.
+			auto proc_ptr = add(pid, path);
+			tour_->toured = false;
 			return proc_ptr;
 		}
 
@@ -235,8 +1565,7 @@ namespace prox
 		[[nodiscard]] auto get(const pid_t pid) -> std::optional<proc_ptr_t>
 		{
 			// If the process is found, return a reference to it
-			const auto & proc_it = processes_.find(pid);
-			if (proc_it not_eq processes_.end()) { return { proc_it->second }; }
+			if (const auto * proc = handle_of(pid); proc not_eq nullptr) { return { *proc }; }
 
 			// Otherwise, try to create a new process
 			try
@@ -253,10 +1582,7 @@ namespace prox
 		[[nodiscard]] auto get(const pid_t pid) const -> std::optional<proc_ptr_t>
 		{
 			// If the process is found, return a reference to it
-			if (const auto & proc_it = processes_.find(pid); proc_it not_eq processes_.end())
-			{
-				return { proc_it->second };
-			}
+			if (const auto * proc = handle_of(pid); proc not_eq nullptr) { return { *proc }; }
 
 			// Otherwise, return an empty optional
 			return {};
@@ -288,39 +1614,30 @@ namespace prox
 
 		[[nodiscard]] auto all_children_of(const pid_t pid_) const -> std::set<pid_t>
 		{
-			std::set<pid_t> children = {};
-
-			std::queue<pid_t> q = {};
-			q.push(pid_);
-
-			while (not q.empty())
-			{
-				const auto p = q.front();
-				q.pop();
-
-				const auto opt_proc_ptr = get(p);
-
-				if (not opt_proc_ptr.has_value()) { continue; }
-
-				const auto & proc = *opt_proc_ptr.value();
-
-				for (const auto & task : proc.tasks())
-				{
-					q.push(task);
-					children.insert(task);
-				}
+			const auto children = descendants(pid_);
+			return std::set<pid_t>(children.begin(), children.end());
+		}
 
-				for (const auto & child : proc.children())
-				{
-					q.push(child);
-					children.insert(child);
-				}
-			}
+		// Descendants (children and tasks, recursively) of "pid" in the tree, in pre-order, without copying them.
+		// O(1) plus the size of the subtree (after insert() or erase(), the first query tours the tree again, O(n));
+		// valid until the tree changes.
+		[[nodiscard]] auto descendants(const pid_t pid) const -> std::span<const pid_t>
+		{
+			const auto slot = store_.slot(pid);
+			if (not slot.has_value()) { return {}; }
+			return current_tour().descendants(*slot);
+		}
 
-			return children;
+		// Whether "pid" is a descendant (child or task, recursively) of "ancestor" in the tree. O(1).
+		[[nodiscard]] auto is_descendant(const pid_t pid, const pid_t ancestor) const
+		{
+			const auto slot          = store_.slot(pid);
+			const auto ancestor_slot = store_.slot(ancestor);
+			if (not slot.has_value() or not ancestor_slot.has_value() or *slot == *ancestor_slot) { return false; }
+			return current_tour().within(*slot, *ancestor_slot);
 		}
 
-		[[nodiscard]] auto alive(const pid_t pid) const { return processes_.contains(pid); }
+		[[nodiscard]] auto alive(const pid_t pid) const { return store_.contains(pid); }
 
 		[[nodiscard]] auto stat(const pid_t pid) -> const auto & { return find(pid).stat_info(); }
 
@@ -355,7 +1672,7 @@ namespace prox
 
 		[[nodiscard]] auto unpin()
 		{
-			for (const auto & proc : ranges::views::values(processes_))
+			for (const auto & proc : handles_)
 			{
 				proc->unpin();
 			}
@@ -387,141 +1704,94 @@ namespace prox
 
 		void erase(const pid_t pid)
 		{
-			const auto proc_it = processes_.find(pid);
-			if (proc_it == processes_.end())
+			if (not store_.contains(pid))
 			{
 				// Process not found, nothing to do
 				return;
 			}
 
-			// Get the process
-			processes_.erase(proc_it);
+			// Remove the process. The subtrees it leaves are toured again on the next query.
+			remove(pid);
+			tour_->toured = false;
 		}
 
-		template<typename Bool_map>
-		void update(const pid_t root, Bool_map & updated_pids)
+		void update(const pid_t root, pid_bitset & updated_pids)
 		{
-			namespace fs = std::filesystem;
-
-			// Pair for PID and the /proc path
-			using pid_path_t = std::pair<pid_t, std::optional<fs::path>>;
+			// Queue of PIDs to update (released on the next update())
+			pid_queue to_update(arena_->resource());
+			to_update.push({ root });
 
-			// Queue of PIDs to update
-			std::queue<pid_path_t> to_update;
-			to_update.emplace(root, std::nullopt);
+			update(to_update, updated_pids);
+		}
 
+		// Update the processes in "to_update" (and their tasks and children) in "tree-mode"
+		void update(pid_queue & to_update, pid_bitset & updated_pids)
+		{
 			while (not to_update.empty())
 			{
-				const auto [pid, path_opt] = to_update.front();
+				const auto queued = to_update.front();
+				const auto pid    = queued.pid;
 				to_update.pop();
 
 				// Check if the PID is already updated
-				if (read_from_bool_vector(updated_pids, pid)) { continue; }
+				if (updated_pids.test(pid)) { continue; }
 
 				// Find the process
-				auto proc_it = processes_.find(pid);
-
-				// If the process is not found, try to create a new one
-				auto path = path_opt.value_or(proc_path_ / std::to_string(pid));
+				const auto * found = handle_of(pid);
 
 				proc_ptr_t proc_ptr;
 
 				try
 				{
-					// Insert the process or update it
-					if (proc_it == processes_.end()) { proc_ptr = insert(pid, path.string()); }
+					// Insert the process (if it is not found) or update it
+					if (found == nullptr) { proc_ptr = add(pid, path_of(queued)); }
 					else
 					{
-						proc_ptr = proc_it->second;
+						proc_ptr = *found;
 						// Update the process
 						proc_ptr->update();
 					}
 
 					// Add the PID to the updated PIDs
-					write_into_bool_vector(updated_pids, pid, true);
+					updated_pids.set(pid);
 				}
 				catch (...)
 				{
 					continue;
 				}
 
+				// A new process has got its row when it was added
+				if (found == nullptr) { rank_process(*proc_ptr); }
+				else { refresh_row(*proc_ptr); }
+
 				// Update its tasks
-				for (const auto & task : proc_ptr->tasks())
+				for (const auto & task : proc_ptr->task_pids())
 				{
-					to_update.emplace(task, path / "task" / std::to_string(task));
+					to_update.push({ task, pid });
 				}
 
 				// Add the children to the queue
-				for (const auto & child : proc_ptr->children())
+				for (const auto & child : proc_ptr->children_pids())
 				{
-					to_update.emplace(child, std::nullopt);
+					to_update.push({ child });
 				}
 			}
 		}
 
-		void update()
-		{
-			namespace fs = std::filesystem;
-
-			cpu_time_.update();
-
-			const auto max_pid = processes_.empty() ? 99'999 : ranges::max(processes_ | ranges::views::keys);
-
-			std::vector<bool> old_pids(static_cast<std::size_t>(max_pid + 1), false);
-			ranges::for_each(processes_ | ranges::views::keys,
-			                 [&](const auto & pid) { write_into_bool_vector(old_pids, pid, true); });
-
-			// Set of updated PIDs to avoid updating the same process twice
-			std::vector<bool> updated_pids(static_cast<size_t>(max_pid + 1), false);
-
-			for (const auto & entry : fs::directory_iterator(proc_path_))
-			{
-				// Check if the entry is a directory
-				if (not fs::is_directory(entry)) { continue; }
-
-				const auto & path = entry.path().filename().string();
-
-				// Check if the entry is a number (checking the first character is enough)
-				if (std::isdigit(path[0]) == 0) { continue; }
-
-				const pid_t pid = std::stoi(path);
-
-				// Check if the PID is already updated
-				if (read_from_bool_vector(updated_pids, pid)) { continue; }
-
-				// Update in "tree-mode"
-				update(pid, updated_pids);
-			}
-
-			// Make sure that all processes know their children/tasks
-			for (const auto & proc : ranges::views::values(processes_))
-			{
-				if (proc->pid() == root_) { continue; }
-
-				const auto ppid = proc->ppid();
+		void update() { update(nullptr); }
 
-				// Get the parent process
-				auto parent_opt = get(ppid);
-				if (not parent_opt.has_value()) { continue; }
-				auto & parent = *parent_opt.value();
-
-				// Add the process to the parent
-				if (proc->lwp()) { parent.add_task(proc->pid()); }
-				else { parent.add_child(proc->pid()); }
-			}
-
-			// Remove the processes that couldn't be updated or that are not in the tree anymore
-			const auto condition_to_remove = [&](const auto & pid) {
-				return read_from_bool_vector(old_pids, pid) and not read_from_bool_vector(updated_pids, pid);
-			};
-
-			ranges::for_each(processes_ | ranges::views::keys | ranges::views::filter(condition_to_remove),
-			                 [&](const auto & pid) { erase(pid); });
+		// Same as update(), and record what has changed (spawns, exits, execs and migrations) in "log". Execs are told
+		// from the comm and the address of the arguments, so the tree must parse EXEC_STAT_FIELDS: e.g.
+		// basic_process_tree<CPU_STAT_FIELDS | EXEC_STAT_FIELDS> instead of cpu_process_tree.
+		void update(change_log & log)
+		    requires((proc_t::STAT_FIELDS & EXEC_STAT_FIELDS) == EXEC_STAT_FIELDS)
+		{
+			update(&log);
 		}
 
-		friend auto operator<<(std::ostream & os, const process_tree & p) -> std::ostream &
+		friend auto operator<<(std::ostream & os, const basic_process_tree & p) -> std::ostream &
 		{
-			os << "Process tree with " << p.processes_.size() << " entries." << '\n';
+			os << "Process tree with " << p.size() << " entries." << '\n';
 			const auto & root_opt = p.get(p.root());
 
 			if (not root_opt.has_value()) { return os; }
@@ -531,4 +1801,10 @@ namespace prox
 			return os;
 		}
 	};
+
+	// Process tree that parses every field of the stat files
+	using process_tree = basic_process_tree<>;
+
+	// Process tree that only parses what CPU monitoring needs (see CPU_STAT_FIELDS)
+	using cpu_process_tree = basic_process_tree<CPU_STAT_FIELDS>;
 } // namespace prox
\ No newline at end of file
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <time.h> // for clock_gettime, timespec, CLOCK_MONOTONIC
+
+#include <algorithm>    // for clamp
+#include <array>        // for array
+#include <cerrno>       // for errno
+#include <charconv>     // for from_chars
+#include <cstdint>      // for uint64_t
+#include <cstring>      // for strerror
+#include <stdexcept>    // for runtime_error
+#include <string_view>  // for string_view
+#include <system_error> // for errc
+#include <utility>      // for cmp_equal
+
+#include <fmt/core.h> // for format
+
+namespace prox
+{
+	// Contents of /proc/<pid>/task/<tid>/schedstat: nanoseconds, not clock ticks
+	struct sched_times
+	{
+		std::uint64_t run_ns     = 0; // Time spent on a CPU
+		std::uint64_t wait_ns    = 0; // Time spent runnable on a run queue, waiting for a CPU
+		std::uint64_t timeslices = 0; // Number of times run on a CPU
+	};
+
+	// Parse the three fields of a schedstat file in place, without copying "data"
+	[[nodiscard]] inline auto parse_schedstat(const std::string_view data) -> sched_times
+	{
+		std::array<std::uint64_t, 3> values{};
+
+		const char * it  = data.data();
+		const char * end = data.data() + data.size();
+
+		for (auto & value : values)
+		{
+			while (it not_eq end and *it == ' ')
+			{
+				++it;
+			}
+
+			const auto [ptr, ec] = std::from_chars(it, end, value);
+			if (ec not_eq std::errc{})
+			{
+				const auto error = fmt::format("Invalid schedstat contents: \"{}\"", data);
+				throw std::runtime_error(error);
+			}
+			it = ptr;
+		}
+
+		while (it not_eq end and (*it == ' ' or *it == '\n'))
+		{
+			++it;
+		}
+
+		if (it not_eq end)
+		{
+			const auto error = fmt::format("Unexpected fields in schedstat contents: \"{}\"", data);
+			throw std::runtime_error(error);
+		}
+
+		return { values[0], values[1], values[2] };
+	}
+
+	// Nanoseconds of CLOCK_MONOTONIC, the clock the schedstat times are sampled against
+	[[nodiscard]] inline auto monotonic_ns() -> std::uint64_t
+	{
+		::timespec now{};
+
+		if (std::cmp_equal(::clock_gettime(CLOCK_MONOTONIC, &now), -1))
+		{
+			const auto error = fmt::format("Could not read CLOCK_MONOTONIC. Error {} ({})", errno, strerror(errno));
+			throw std::runtime_error(error);
+		}
+
+		static constexpr std::uint64_t NS_PER_S = 1'000'000'000;
+
+		return static_cast<std::uint64_t>(now.tv_sec) * NS_PER_S + static_cast<std::uint64_t>(now.tv_nsec);
+	}
+
+	// CPU usage and run-queue delay of a task between two schedstat samples. Unlike the utime and stime of the stat
+	// file, which are whole clock ticks, the times are nanoseconds, so short sampling intervals do not quantize the
+	// usage of steady tasks.
+	class sched_usage
+	{
+		sched_times times_{};
+
+		std::uint64_t sampled_ns_ = 0; // CLOCK_MONOTONIC of the last sample, 0 before the first one
+
+		// Since the previous sample (0 after the first one)
+		std::uint64_t period_ns_        = 0;
+		std::uint64_t run_delta_ns_     = 0;
+		std::uint64_t wait_delta_ns_    = 0;
+		std::uint64_t timeslices_delta_ = 0;
+
+		[[nodiscard]] auto percent_of_period(const std::uint64_t ns) const -> float
+		{
+			if (period_ns_ == 0) { return 0.0F; }
+			const auto percent = static_cast<float>(ns) / static_cast<float>(period_ns_) * 100.0F;
+			return std::clamp(percent, 0.0F, 100.0F);
+		}
+
+	public:
+		// Take "times", read at "now_ns" (CLOCK_MONOTONIC), as the new sample
+		void sample(const sched_times & times, const std::uint64_t now_ns)
+		{
+			// The counters of a task do not go back, unless the PID has been reused
+			const auto delta = [](const std::uint64_t now, const std::uint64_t before) {
+				return now > before ? now - before : 0;
+			};
+
+			if (sampled_ns_ not_eq 0)
+			{
+				period_ns_        = delta(now_ns, sampled_ns_);
+				run_delta_ns_     = delta(times.run_ns, times_.run_ns);
+				wait_delta_ns_    = delta(times.wait_ns, times_.wait_ns);
+				timeslices_delta_ = delta(times.timeslices, times_.timeslices);
+			}
+
+			times_      = times;
+			sampled_ns_ = now_ns;
+		}
+
+		void sample(const sched_times & times) { sample(times, monotonic_ns()); }
+
+		[[nodiscard]] auto times() const -> const sched_times & { return times_; }
+
+		[[nodiscard]] auto sampled_ns() const { return sampled_ns_; }
+
+		[[nodiscard]] auto period_ns() const { return period_ns_; }
+
+		[[nodiscard]] auto run_delta_ns() const { return run_delta_ns_; }
+
+		[[nodiscard]] auto wait_delta_ns() const { return wait_delta_ns_; }
+
+		[[nodiscard]] auto timeslices_delta() const { return timeslices_delta_; }
+
+		// Portion of one CPU used over the period (between 0 and 100)
+		[[nodiscard]] auto cpu_use() const { return percent_of_period(run_delta_ns_); }
+
+		// Portion of the period spent waiting on a run queue (between 0 and 100)
+		[[nodiscard]] auto run_queue_delay() const { return percent_of_period(wait_delta_ns_); }
+
+		// Average wait before each timeslice of the period, in nanoseconds
+		[[nodiscard]] auto wait_per_timeslice_ns() const
+		{
+			return timeslices_delta_ == 0 ? std::uint64_t{ 0 } : wait_delta_ns_ / timeslices_delta_;
+		}
+	};
+} // namespace prox
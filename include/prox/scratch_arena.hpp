@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>         // for size_t, byte, max_align_t
+#include <memory>          // for unique_ptr, make_unique
+#include <memory_resource> // for memory_resource, monotonic_buffer_resource, new_delete_resource
+#include <optional>        // for optional
+
+namespace prox
+{
+	// Monotonic arena for the temporaries of one process_tree::update(). Everything allocated from resource() is
+	// released at once by reset(). If a tick needed more memory than the arena holds, the arena grows on the next
+	// reset(), so once the size of the work is stable, ticks do not allocate from the heap.
+	class scratch_arena
+	{
+	public:
+		static constexpr std::size_t DEFAULT_SIZE = 64 * 1024;
+
+	private:
+		// Upstream of the monotonic resource: counts what did not fit in the buffer
+		class overflow_resource : public std::pmr::memory_resource
+		{
+			std::size_t requested_ = 0;
+
+			auto do_allocate(const std::size_t bytes, const std::size_t alignment) -> void * override
+			{
+				requested_ += bytes;
+				return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+			}
+
+			void do_deallocate(void * ptr, const std::size_t bytes, const std::size_t alignment) override
+			{
+				std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+			}
+
+			[[nodiscard]] auto do_is_equal(const std::pmr::memory_resource & other) const noexcept -> bool override
+			{
+				return this == &other;
+			}
+
+		public:
+			[[nodiscard]] auto requested() const { return requested_; }
+
+			void clear() { requested_ = 0; }
+		};
+
+		std::size_t size_ = DEFAULT_SIZE;
+
+		std::unique_ptr<std::byte[]> buffer_ = std::make_unique<std::byte[]>(size_);
+
+		overflow_resource overflow_{};
+
+		std::optional<std::pmr::monotonic_buffer_resource> resource_{};
+
+	public:
+		scratch_arena() { reset(); }
+
+		explicit scratch_arena(const std::size_t size) : size_(size), buffer_(std::make_unique<std::byte[]>(size_))
+		{
+			reset();
+		}
+
+		// The arena hands out pointers into itself
+		scratch_arena(const scratch_arena &)                     = delete;
+		auto operator=(const scratch_arena &) -> scratch_arena & = delete;
+		scratch_arena(scratch_arena &&)                          = delete;
+		auto operator=(scratch_arena &&) -> scratch_arena &      = delete;
+
+		~scratch_arena() = default;
+
+		// Release everything allocated since the last reset. Nothing allocated from the arena may be used afterwards.
+		auto reset() -> std::pmr::memory_resource *
+		{
+			resource_.reset(); // Gives the overflow back to the heap
+
+			if (overflow_.requested() > 0)
+			{
+				size_ += overflow_.requested();
+				buffer_ = std::make_unique<std::byte[]>(size_);
+				overflow_.clear();
+			}
+
+			resource_.emplace(buffer_.get(), size_, &overflow_);
+
+			return resource();
+		}
+
+		[[nodiscard]] auto resource() -> std::pmr::memory_resource * { return &*resource_; }
+
+		// Bytes available before the arena has to fall back on the heap
+		[[nodiscard]] auto size() const { return size_; }
+	};
+} // namespace prox
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <sys/types.h> // for pid_t
+
+#include <algorithm>     // for sort, equal_range
+#include <cstddef>       // for size_t
+#include <cstdint>       // for uint32_t
+#include <functional>    // for equal_to
+#include <limits>        // for numeric_limits
+#include <optional>      // for optional, nullopt
+#include <span>          // for span
+#include <string>        // for string, hash
+#include <string_view>   // for string_view
+#include <unordered_map> // for unordered_map
+#include <utility>       // for pair
+#include <vector>        // for vector
+
+namespace prox
+{
+	// Maps strings (e.g. comms) to small ids, so they can be stored in a column and compared as integers. Ids are
+	// stable until compact(), which drops the strings that are not referred to anymore (comms with counters, such as
+	// kworker/u16:3, would otherwise pile up in a long-running monitor).
+	class string_interner
+	{
+	public:
+		using id_t = std::uint32_t;
+
+	private:
+		struct hash
+		{
+			using is_transparent = void;
+
+			[[nodiscard]] auto operator()(const std::string_view s) const -> std::size_t
+			{
+				return std::hash<std::string_view>{}(s);
+			}
+		};
+
+		std::unordered_map<std::string, id_t, hash, std::equal_to<>> ids_{};
+
+		std::vector<const std::string *> strings_{}; // Id -> string (keys of ids_, which do not move)
+
+	public:
+		// Id of "s", added if it is new
+		auto intern(const std::string_view s) -> id_t
+		{
+			if (const auto it = ids_.find(s); it not_eq ids_.end()) { return it->second; }
+
+			const auto id = static_cast<id_t>(strings_.size());
+			const auto it = ids_.emplace(std::string(s), id).first;
+			strings_.emplace_back(&it->first);
+			return id;
+		}
+
+		[[nodiscard]] auto find(const std::string_view s) const -> std::optional<id_t>
+		{
+			if (const auto it = ids_.find(s); it not_eq ids_.end()) { return it->second; }
+			return std::nullopt;
+		}
+
+		[[nodiscard]] auto str(const id_t id) const -> std::string_view { return *strings_.at(id); }
+
+		[[nodiscard]] auto size() const { return strings_.size(); }
+
+		// Keep only the strings of "ids" and number them densely, in order of first appearance. "ids" is rewritten
+		// with the new ids. O(size() + ids.size()).
+		void compact(const std::span<id_t> ids)
+		{
+			static constexpr auto DROPPED = std::numeric_limits<id_t>::max();
+
+			std::vector<id_t> new_id(strings_.size(), DROPPED);
+
+			std::vector<const std::string *> strings;
+
+			for (auto & id : ids)
+			{
+				if (new_id[id] == DROPPED)
+				{
+					new_id[id] = static_cast<id_t>(strings.size());
+					strings.emplace_back(strings_[id]);
+				}
+				id = new_id[id];
+			}
+
+			std::erase_if(ids_, [&](const auto & entry) { return new_id[entry.second] == DROPPED; });
+
+			for (auto & [str, id] : ids_)
+			{
+				id = new_id[id];
+			}
+
+			strings_ = std::move(strings);
+		}
+	};
+
+	// PIDs grouped by a key (processor, NUMA node, uid, comm id...). The PIDs of each key are contiguous and sorted,
+	// so a query is a span into the index, and the PIDs that match two keys of different indices can be found with
+	// std::set_intersection. The memory is kept across rebuilds.
+	template<typename Key>
+	class key_index
+	{
+		using entry = std::pair<Key, pid_t>;
+
+		// Entries sorted by key, then by PID
+		std::vector<Key>   keys_{};
+		std::vector<pid_t> pids_{};
+
+		// The rows of the last build, to find the entries that have changed since
+		std::vector<pid_t>              row_pids_{};
+		std::vector<std::optional<Key>> row_keys_{};
+
+		// Temporaries of build(), kept for their memory
+		std::vector<entry> removed_{};
+		std::vector<entry> added_{};
+		std::vector<Key>   merged_keys_{};
+		std::vector<pid_t> merged_pids_{};
+
+	public:
+		// Index "pids[i]" under "key_of(i)" for every i. Rows for which key_of returns std::nullopt are left out.
+		// Only the entries of the rows that have changed since the last build are sorted, and then merged with the
+		// rest: O(n + k log k) for k changes.
+		template<typename Key_of>
+		void build(const std::span<const pid_t> pids, Key_of && key_of)
+		{
+			removed_.clear();
+			added_.clear();
+
+			const auto n_rows = pids.size();
+
+			for (std::size_t i = n_rows; i < row_pids_.size(); ++i)
+			{
+				if (row_keys_[i].has_value()) { removed_.emplace_back(*row_keys_[i], row_pids_[i]); }
+			}
+
+			row_pids_.resize(n_rows, -1);
+			row_keys_.resize(n_rows);
+
+			for (std::size_t i = 0; i < n_rows; ++i)
+			{
+				const std::optional<Key> key = key_of(i);
+
+				if (row_pids_[i] == pids[i] and row_keys_[i] == key) { continue; }
+
+				if (row_keys_[i].has_value()) { removed_.emplace_back(*row_keys_[i], row_pids_[i]); }
+				if (key.has_value()) { added_.emplace_back(*key, pids[i]); }
+
+				row_pids_[i] = pids[i];
+				row_keys_[i] = key;
+			}
+
+			if (removed_.empty() and added_.empty()) { return; }
+
+			std::sort(removed_.begin(), removed_.end());
+			std::sort(added_.begin(), added_.end());
+
+			merged_keys_.clear();
+			merged_pids_.clear();
+
+			const auto push = [&](const entry & e) {
+				merged_keys_.emplace_back(e.first);
+				merged_pids_.emplace_back(e.second);
+			};
+
+			// Every removed entry is in the index, so both lists are walked once
+			std::size_t r = 0;
+			std::size_t a = 0;
+
+			for (std::size_t e = 0; e < keys_.size(); ++e)
+			{
+				const entry current{ keys_[e], pids_[e] };
+
+				if (r < removed_.size() and removed_[r] == current)
+				{
+					++r;
+					continue;
+				}
+
+				for (; a < added_.size() and added_[a] < current; ++a)
+				{
+					push(added_[a]);
+				}
+
+				push(current);
+			}
+
+			for (; a < added_.size(); ++a)
+			{
+				push(added_[a]);
+			}
+
+			keys_.swap(merged_keys_);
+			pids_.swap(merged_pids_);
+		}
+
+		void clear()
+		{
+			keys_.clear();
+			pids_.clear();
+			row_pids_.clear();
+			row_keys_.clear();
+		}
+
+		[[nodiscard]] auto size() const { return pids_.size(); }
+
+		[[nodiscard]] auto empty() const { return pids_.empty(); }
+
+		// PIDs indexed under "key", sorted. Valid until the next build.
+		[[nodiscard]] auto of(const Key & key) const -> std::span<const pid_t>
+		{
+			const auto [first, last] = std::equal_range(keys_.begin(), keys_.end(), key);
+			return std::span(pids_).subspan(static_cast<std::size_t>(first - keys_.begin()),
+			                                static_cast<std::size_t>(last - first));
+		}
+	};
+} // namespace prox
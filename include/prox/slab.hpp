@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>   // for size_t, byte
+#include <cstdint>   // for uint32_t
+#include <memory>    // for unique_ptr, make_unique, construct_at, destroy_at
+#include <new>       // for launder
+#include <stdexcept> // for runtime_error
+#include <utility>   // for forward, exchange
+#include <vector>    // for vector
+
+namespace prox
+{
+	// Pool of objects of type T allocated in fixed-size chunks that are never released until the slab is destroyed,
+	// so creating and destroying objects does not go through the global allocator once the slab has grown.
+	// Objects are referred to by generational handles: erasing an object bumps the generation of its slot, so a
+	// handle to an object that has been erased (even if the slot has been reused since) is detected as stale.
+	template<typename T, std::size_t Chunk_size = 256>
+	class slab
+	{
+		static_assert(Chunk_size > 0, "Chunks must hold at least one object");
+
+		struct slot
+		{
+			alignas(T) std::byte storage_[sizeof(T)];
+
+			std::uint32_t generation_ = 0;
+			bool          live_       = false;
+
+			[[nodiscard]] auto object() { return std::launder(reinterpret_cast<T *>(storage_)); }
+		};
+
+		std::vector<std::unique_ptr<slot[]>> chunks_{};
+
+		std::vector<slot *> free_{}; // Slots available, the next one to use last
+
+		std::size_t size_ = 0;
+
+		void grow()
+		{
+			auto & chunk = chunks_.emplace_back(std::make_unique<slot[]>(Chunk_size));
+
+			for (std::size_t i = Chunk_size; i > 0; --i)
+			{
+				free_.emplace_back(&chunk[i - 1]);
+			}
+		}
+
+		void release(slot & s)
+		{
+			std::destroy_at(s.object());
+			s.live_ = false;
+			++s.generation_;
+			free_.emplace_back(&s);
+			--size_;
+		}
+
+	public:
+		// Reference to an object of the slab (slot + generation). Slots are never moved, so handles stay valid when
+		// the slab grows or is moved; they only become stale when the object is erased.
+		class handle
+		{
+			friend class slab;
+
+			slot *        slot_       = nullptr;
+			std::uint32_t generation_ = 0;
+
+			handle(slot & s, const std::uint32_t generation) : slot_(&s), generation_(generation) {}
+
+		public:
+			handle() = default;
+
+			// Whether the object still exists
+			[[nodiscard]] auto valid() const
+			{
+				return slot_ not_eq nullptr and slot_->live_ and slot_->generation_ == generation_;
+			}
+
+			// The object, or nullptr if the handle is stale
+			[[nodiscard]] auto get() const -> T * { return valid() ? slot_->object() : nullptr; }
+
+			// Throws if the handle is stale
+			[[nodiscard]] auto operator*() const -> T &
+			{
+				if (not valid()) { throw std::runtime_error("Stale handle"); }
+				return *slot_->object();
+			}
+
+			[[nodiscard]] auto operator->() const -> T * { return &**this; }
+
+			[[nodiscard]] auto generation() const { return generation_; }
+
+			[[nodiscard]] auto operator==(const handle & other) const -> bool = default;
+		};
+
+		slab() = default;
+
+		slab(const slab &)                     = delete;
+		auto operator=(const slab &) -> slab & = delete;
+
+		slab(slab && other) noexcept :
+		    chunks_(std::move(other.chunks_)), free_(std::move(other.free_)), size_(std::exchange(other.size_, 0))
+		{
+		}
+
+		auto operator=(slab && other) noexcept -> slab &
+		{
+			if (this == &other) { return *this; }
+			clear();
+			chunks_ = std::move(other.chunks_);
+			free_   = std::move(other.free_);
+			size_   = std::exchange(other.size_, 0);
+			return *this;
+		}
+
+		~slab() { clear(); }
+
+		// Construct an object in a free slot. If the constructor throws, the slot is given back.
+		template<typename... Args>
+		auto emplace(Args &&... args) -> handle
+		{
+			if (free_.empty()) { grow(); }
+
+			auto & s = *free_.back();
+
+			std::construct_at(s.object(), std::forward<Args>(args)...);
+
+			free_.pop_back();
+			s.live_ = true;
+			++size_;
+
+			return { s, s.generation_ };
+		}
+
+		// Destroy the object of "h" (nothing to do if the handle is stale)
+		void erase(const handle & h)
+		{
+			if (not h.valid()) { return; }
+			release(*h.slot_);
+		}
+
+		// Destroy every object. Chunks are kept for reuse.
+		void clear()
+		{
+			for (const auto & chunk : chunks_)
+			{
+				for (std::size_t i = 0; i < Chunk_size; ++i)
+				{
+					if (chunk[i].live_) { release(chunk[i]); }
+				}
+			}
+		}
+
+		[[nodiscard]] auto size() const { return size_; }
+
+		[[nodiscard]] auto empty() const { return size_ == 0; }
+
+		[[nodiscard]] auto capacity() const { return chunks_.size() * Chunk_size; }
+	};
+} // namespace prox
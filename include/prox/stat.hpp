@@ -1,13 +1,29 @@
 #pragma once
 
-#include <sys/types.h>
+#include <fcntl.h>     // for open, O_RDONLY, O_CLOEXEC
+#include <sys/types.h> // for pid_t, gid_t
+#include <unistd.h>    // for pread, close
 
-#include <filesystem>
-#include <fstream>
-#include <string>
+#include <array>        // for array
+#include <bit>          // for bit_width
+#include <cerrno>       // for errno
+#include <charconv>     // for from_chars
+#include <cstdint>      // for uint64_t
+#include <cstring>      // for strerror
+#include <filesystem>   // for path
+#include <stdexcept>    // for runtime_error
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <span>         // for span
+#include <system_error> // for errc
+#include <tuple>        // for get, make_tuple
+#include <type_traits>  // for remove_cvref_t
+#include <utility>      // for cmp_equal, cmp_less, index_sequence
 
 #include <fmt/core.h>
 
+#include "tokenizer.hpp" // for tokenize, decode_integer
+
 namespace prox
 {
 	struct stat
@@ -74,81 +90,278 @@ namespace prox
 		lint  exit_code{};   // The thread's exit status in the form reported by waitpid(2).
 	};
 
+	// Fields of /proc/<pid>/stat, in the order they appear in the file
+	enum class stat_field : unsigned
+	{
+		pid,
+		comm,
+		state,
+		ppid,
+		pgrp,
+		session,
+		tty_nr,
+		tpgid,
+		flags,
+		minflt,
+		cminflt,
+		majflt,
+		cmajflt,
+		utime,
+		stime,
+		cutime,
+		cstime,
+		priority,
+		nice,
+		num_threads,
+		itrealvalue,
+		starttime,
+		vsize,
+		rss,
+		rsslim,
+		startcode,
+		endcode,
+		startstack,
+		kstkesp,
+		kstkeip,
+		signal,
+		blocked,
+		sigignore,
+		sigcatch,
+		wchan,
+		nswap,
+		cnswap,
+		exit_signal,
+		processor,
+		rt_priority,
+		policy,
+		delayacct_blkio_ticks,
+		guest_time,
+		cguest_time,
+		start_data,
+		end_data,
+		start_brk,
+		arg_start,
+		arg_end,
+		env_start,
+		env_end,
+		exit_code,
+	};
+
+	// Set of stat fields, one bit per stat_field
+	using stat_mask = std::uint64_t;
+
+	template<stat_field... Fields>
+	constexpr stat_mask stat_fields = ((stat_mask{ 1 } << static_cast<unsigned>(Fields)) | ... | stat_mask{});
+
+	constexpr stat_mask ALL_STAT_FIELDS = (stat_mask{ 1 } << (static_cast<unsigned>(stat_field::exit_code) + 1)) - 1;
+
+	// What CPU monitoring needs: scheduling state, hierarchy, CPU times and placement
+	constexpr stat_mask CPU_STAT_FIELDS =
+	    stat_fields<stat_field::state, stat_field::ppid, stat_field::pgrp, stat_field::flags, stat_field::utime,
+	                stat_field::stime, stat_field::processor, stat_field::num_threads>;
+
+	[[nodiscard]] constexpr auto contains(const stat_mask mask, const stat_field f) -> bool
+	{
+		return static_cast<bool>((mask >> static_cast<unsigned>(f)) & 1U);
+	}
+
+	// Numeric members of prox::stat, from "ppid" to "exit_code"
+	constexpr auto STAT_NUMERIC_MEMBERS = std::make_tuple(
+	    &stat::ppid,
+	    &stat::pgrp,
+	    &stat::session,
+	    &stat::tty_nr,
+	    &stat::tpgid,
+	    &stat::flags,
+	    &stat::minflt,
+	    &stat::cminflt,
+	    &stat::majflt,
+	    &stat::cmajflt,
+	    &stat::utime,
+	    &stat::stime,
+	    &stat::cutime,
+	    &stat::cstime,
+	    &stat::priority,
+	    &stat::nice,
+	    &stat::num_threads,
+	    &stat::itrealvalue,
+	    &stat::starttime,
+	    &stat::vsize,
+	    &stat::rss,
+	    &stat::rsslim,
+	    &stat::startcode,
+	    &stat::endcode,
+	    &stat::startstack,
+	    &stat::kstkesp,
+	    &stat::kstkeip,
+	    &stat::signal,
+	    &stat::blocked,
+	    &stat::sigignore,
+	    &stat::sigcatch,
+	    &stat::wchan,
+	    &stat::nswap,
+	    &stat::cnswap,
+	    &stat::exit_signal,
+	    &stat::processor,
+	    &stat::rt_priority,
+	    &stat::policy,
+	    &stat::delayacct_blkio_ticks,
+	    &stat::guest_time,
+	    &stat::cguest_time,
+	    &stat::start_data,
+	    &stat::end_data,
+	    &stat::start_brk,
+	    &stat::arg_start,
+	    &stat::arg_end,
+	    &stat::env_start,
+	    &stat::env_end,
+	    &stat::exit_code);
+
+	constexpr auto FIRST_NUMERIC_STAT_FIELD = static_cast<std::size_t>(stat_field::ppid);
+
+	// Large enough for any /proc/<pid>/stat line (52 fields of at most 20 digits plus a 16-byte comm)
+	constexpr static std::size_t STAT_BUFFER_SIZE = 2048;
+
+	// Longest comm reported by the kernel (workqueue workers append their workqueue name to the 16-byte task comm)
+	constexpr static std::size_t STAT_MAX_COMM = 64;
+
+	// Decode the requested numeric fields. "fields" are the fields after the comm ("state" is the first one).
+	template<stat_mask Fields, std::size_t... I>
+	static void decode_stat_fields(const std::string_view rest, std::span<const field> fields, prox::stat & stat,
+	                               std::index_sequence<I...> /*indices*/)
+	{
+		const auto decode = [&]<std::size_t Index>() {
+			constexpr auto FIELD    = static_cast<stat_field>(FIRST_NUMERIC_STAT_FIELD + Index);
+			constexpr auto POSITION = Index + 1;
+
+			if constexpr (contains(Fields, FIELD))
+			{
+				if (POSITION >= fields.size()) { return; }
+
+				std::uint64_t value = 0;
+
+				if (not decode_integer(rest, fields[POSITION], value))
+				{
+					const auto & bad = fields[POSITION];
+					throw std::runtime_error(fmt::format("Malformed stat line (field {}): \"{}\"",
+					                                     FIRST_NUMERIC_STAT_FIELD + Index + 1,
+					                                     rest.substr(bad.begin, bad.size())));
+				}
+
+				auto & member = stat.*std::get<Index>(STAT_NUMERIC_MEMBERS);
+				member        = static_cast<std::remove_cvref_t<decltype(member)>>(value);
+			}
+		};
+
+		(decode.template operator()<I>(), ...);
+	}
+
+	// Parse the contents of a /proc/<pid>/stat file into "stat" without allocating (the comm fits in the SSO buffer).
+	// Only the fields in "Fields" are decoded; the line is not even tokenized past the last of them.
+	// Fields not reported by older kernels are left untouched.
+	template<stat_mask Fields = ALL_STAT_FIELDS>
+	static void parse_stat(const std::string_view content, prox::stat & stat)
+	{
+		// The comm may contain spaces and parentheses, so it is delimited by the first '(' and the *last* ')'.
+		// Only numbers follow the comm, so the search for ')' can start right after its longest possible end.
+		const auto comm_begin = content.find('(');
+		const auto comm_end   = content.rfind(')', comm_begin + STAT_MAX_COMM + 1);
+
+		if (comm_begin == std::string_view::npos or comm_end == std::string_view::npos or comm_end < comm_begin)
+		{
+			throw std::runtime_error(fmt::format("Malformed stat line (no comm found): \"{}\"", content));
+		}
+
+		if constexpr (contains(Fields, stat_field::pid))
+		{
+			if (const auto [ptr, ec] = std::from_chars(content.data(), content.data() + comm_begin, stat.pid);
+			    ec not_eq std::errc{})
+			{
+				throw std::runtime_error(fmt::format("Malformed stat line (invalid pid): \"{}\"", content));
+			}
+		}
+
+		if constexpr (contains(Fields, stat_field::comm))
+		{
+			stat.comm.assign(content.substr(comm_begin + 1, comm_end - comm_begin - 1));
+		}
+
+		constexpr auto AFTER_COMM = Fields >> static_cast<unsigned>(stat_field::state);
+
+		if constexpr (AFTER_COMM not_eq 0)
+		{
+			// Split the rest of the line (up to the last requested field) in one pass
+			const auto rest = content.substr(comm_end + 1);
+
+			constexpr auto N_FIELDS = static_cast<std::size_t>(std::bit_width(AFTER_COMM));
+
+			std::array<field, N_FIELDS> fields;
+
+			const auto n_fields = tokenize(rest, fields);
+
+			if (n_fields == 0) { return; }
+
+			if constexpr (contains(Fields, stat_field::state)) { stat.state = rest[fields[0].begin]; }
+
+			decode_stat_fields<Fields>(rest, std::span(fields).first(n_fields), stat,
+			                           std::make_index_sequence<N_FIELDS - 1>{});
+		}
+	}
+
+	// Parse the stat file behind an already open descriptor. The file is read from the beginning with pread(), so the
+	// same descriptor can be reused on every update. "stat_file" is only used for error messages.
+	template<stat_mask Fields = ALL_STAT_FIELDS>
+	static void update_stat_fd(const int fd, const std::string_view stat_file, prox::stat & stat)
+	{
+		std::array<char, STAT_BUFFER_SIZE> buffer;
+
+		const auto n_read = ::pread(fd, buffer.data(), buffer.size(), 0);
+
+		if (std::cmp_less(n_read, 0))
+		{
+			const auto error_str =
+			    fmt::format("Could not read stat file {}. Error: {}", stat_file, std::strerror(errno));
+			throw std::runtime_error(error_str);
+		}
+
+		if (std::cmp_equal(n_read, buffer.size()))
+		{
+			throw std::runtime_error(fmt::format("Stat file {} does not fit in the read buffer", stat_file));
+		}
+
+		parse_stat<Fields>(std::string_view(buffer.data(), static_cast<std::size_t>(n_read)), stat);
+	}
+
+	template<stat_mask Fields = ALL_STAT_FIELDS>
 	static void update_stat_file(const std::filesystem::path & stat_file, prox::stat & stat)
 	{
-		std::ifstream file(stat_file);
+		const int fd = ::open(stat_file.c_str(), O_RDONLY | O_CLOEXEC);
 
-		if (not file.is_open())
+		if (std::cmp_equal(fd, -1))
 		{
 			const auto error =
 			    fmt::format("Could not open stat file {}. Error: {}", stat_file.string(), std::strerror(errno));
 			throw std::runtime_error(error);
 		}
 
-		file >> stat.pid;
-
-		std::getline(file, stat.comm, ' '); // Skip space before name
-		std::getline(file, stat.comm, ' '); // get the name in the format -> "(name)"
-		// Remove the parentheses
-		if (stat.comm.starts_with("(")) { stat.comm.erase(0, 1); }
-		if (stat.comm.ends_with(")")) { stat.comm.erase(stat.comm.size() - 1); }
-
-		file >> stat.state;
-		file >> stat.ppid;
-		file >> stat.pgrp;
-		file >> stat.session;
-		file >> stat.tty_nr;
-		file >> stat.tpgid;
-		file >> stat.flags;
-		file >> stat.minflt;
-		file >> stat.cminflt;
-		file >> stat.majflt;
-		file >> stat.cmajflt;
-		file >> stat.utime;
-		file >> stat.stime;
-		file >> stat.cutime;
-		file >> stat.cstime;
-		file >> stat.priority;
-		file >> stat.nice;
-		file >> stat.num_threads;
-		file >> stat.itrealvalue;
-		file >> stat.starttime;
-		file >> stat.vsize;
-		file >> stat.rss;
-		file >> stat.rsslim;
-		file >> stat.startcode;
-		file >> stat.endcode;
-		file >> stat.startstack;
-		file >> stat.kstkesp;
-		file >> stat.kstkeip;
-		file >> stat.signal;
-		file >> stat.blocked;
-		file >> stat.sigignore;
-		file >> stat.sigcatch;
-		file >> stat.wchan;
-		file >> stat.nswap;
-		file >> stat.cnswap;
-		file >> stat.exit_signal;
-		file >> stat.processor;
-		file >> stat.rt_priority;
-		file >> stat.policy;
-		file >> stat.delayacct_blkio_ticks;
-		file >> stat.guest_time;
-		file >> stat.cguest_time;
-		file >> stat.start_data;
-		file >> stat.end_data;
-		file >> stat.start_brk;
-		file >> stat.arg_start;
-		file >> stat.arg_end;
-		file >> stat.env_start;
-		file >> stat.env_end;
-		file >> stat.exit_code;
+		try
+		{
+			update_stat_fd<Fields>(fd, stat_file.native(), stat);
+		}
+		catch (...)
+		{
+			::close(fd);
+			throw;
+		}
+
+		::close(fd);
 	}
 
+	template<stat_mask Fields = ALL_STAT_FIELDS>
 	static inline auto read_stat_file(const std::filesystem::path & stat_file)
 	{
 		prox::stat stat;
-		update_stat_file(stat_file, stat);
+		update_stat_file<Fields>(stat_file, stat);
 		return stat;
 	}
 } // namespace prox
\ No newline at end of file
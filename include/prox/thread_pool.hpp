@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>          // for max, min
+#include <condition_variable> // for condition_variable
+#include <cstddef>            // for size_t
+#include <cstdint>            // for uint64_t
+#include <deque>              // for deque
+#include <exception>          // for exception_ptr, current_exception, rethrow_exception
+#include <memory>             // for unique_ptr, make_unique, addressof
+#include <mutex>              // for mutex, lock_guard, unique_lock
+#include <optional>           // for optional
+#include <thread>             // for thread
+#include <type_traits>        // for remove_reference_t
+#include <utility>            // for exchange
+#include <vector>             // for vector
+
+namespace prox
+{
+	// Fixed pool of threads that run loops over indices. The indices are split in ranges that are dealt to one
+	// deque per thread; every thread takes ranges from the back of its own deque and, once it is empty, steals from
+	// the front of the others, so uneven work (e.g. processes with many tasks) is balanced. The calling thread takes
+	// part in the loop.
+	class work_stealing_pool
+	{
+		// Ranges per thread, so there is something left to steal when a thread is slower than the others
+		static constexpr std::size_t RANGES_PER_THREAD = 8;
+
+		struct range
+		{
+			std::size_t begin = 0;
+			std::size_t end   = 0;
+		};
+
+		struct work_queue
+		{
+			std::mutex        mutex_{};
+			std::deque<range> ranges_{};
+		};
+
+		std::vector<std::unique_ptr<work_queue>> queues_{}; // One per thread. The caller uses the first one.
+
+		std::vector<std::thread> threads_{};
+
+		std::mutex              mutex_{};
+		std::condition_variable job_cv_{};
+		std::condition_variable done_cv_{};
+
+		std::uint64_t job_    = 0; // Incremented for every loop
+		std::size_t   active_ = 0; // Threads (but the caller) working on the current loop
+		bool          stop_   = false;
+
+		// Body of the current loop, without the allocation of a std::function
+		void * fn_ = nullptr;
+		void (*invoke_)(void *, std::size_t) = nullptr;
+
+		std::exception_ptr error_{}; // First exception thrown by the body
+
+		[[nodiscard]] auto pop(const std::size_t self) -> std::optional<range>
+		{
+			{
+				auto &                own = *queues_[self];
+				const std::lock_guard lock(own.mutex_);
+				if (not own.ranges_.empty())
+				{
+					const auto r = own.ranges_.back();
+					own.ranges_.pop_back();
+					return r;
+				}
+			}
+
+			for (std::size_t i = 1; i < queues_.size(); ++i)
+			{
+				auto &                victim = *queues_[(self + i) % queues_.size()];
+				const std::lock_guard lock(victim.mutex_);
+				if (not victim.ranges_.empty())
+				{
+					const auto r = victim.ranges_.front();
+					victim.ranges_.pop_front();
+					return r;
+				}
+			}
+
+			return std::nullopt;
+		}
+
+		// Call the function of the job for index "i". If it throws, the first exception is kept for for_each().
+		void run(const std::size_t i)
+		{
+			try
+			{
+				invoke_(fn_, i);
+			}
+			catch (...)
+			{
+				const std::lock_guard lock(mutex_);
+				if (error_ == nullptr) { error_ = std::current_exception(); }
+			}
+		}
+
+		void work(const std::size_t self)
+		{
+			while (const auto r = pop(self))
+			{
+				for (auto i = r->begin; i < r->end; ++i)
+				{
+					run(i);
+				}
+			}
+		}
+
+		void worker(const std::size_t self)
+		{
+			std::uint64_t last_job = 0;
+
+			while (true)
+			{
+				{
+					std::unique_lock lock(mutex_);
+					job_cv_.wait(lock, [&] { return stop_ or job_ not_eq last_job; });
+					if (stop_) { return; }
+					last_job = job_;
+					++active_;
+				}
+
+				work(self);
+
+				{
+					const std::lock_guard lock(mutex_);
+					--active_;
+				}
+				done_cv_.notify_all();
+			}
+		}
+
+	public:
+		// "threads" counts the calling thread, so 1 runs the loops serially
+		explicit work_stealing_pool(const std::size_t threads)
+		{
+			const auto n_threads = std::max<std::size_t>(threads, 1);
+
+			for (std::size_t i = 0; i < n_threads; ++i)
+			{
+				queues_.emplace_back(std::make_unique<work_queue>());
+			}
+
+			for (std::size_t i = 1; i < n_threads; ++i)
+			{
+				threads_.emplace_back([this, i] { worker(i); });
+			}
+		}
+
+		work_stealing_pool(const work_stealing_pool &)                     = delete;
+		auto operator=(const work_stealing_pool &) -> work_stealing_pool & = delete;
+		work_stealing_pool(work_stealing_pool &&)                          = delete;
+		auto operator=(work_stealing_pool &&) -> work_stealing_pool &      = delete;
+
+		~work_stealing_pool()
+		{
+			{
+				const std::lock_guard lock(mutex_);
+				stop_ = true;
+			}
+			job_cv_.notify_all();
+
+			for (auto & thread : threads_)
+			{
+				thread.join();
+			}
+		}
+
+		[[nodiscard]] auto size() const { return queues_.size(); }
+
+		// Call "fn(i)" for every i in [0, n), in any order and from any thread of the pool. Returns when all the calls
+		// have finished. If some call throws, the first exception is rethrown (the other indices are still run).
+		template<typename Fn>
+		void for_each(const std::size_t n, Fn && fn)
+		{
+			if (n == 0) { return; }
+
+			{
+				const std::lock_guard lock(mutex_);
+
+				fn_     = const_cast<void *>(static_cast<const void *>(std::addressof(fn)));
+				invoke_ = [](void * f, const std::size_t i) { (*static_cast<std::remove_reference_t<Fn> *>(f))(i); };
+				error_  = nullptr;
+			}
+
+			if (threads_.empty())
+			{
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					run(i);
+				}
+
+				if (error_ not_eq nullptr) { std::rethrow_exception(std::exchange(error_, nullptr)); }
+				return;
+			}
+
+			const auto n_ranges = std::min(n, size() * RANGES_PER_THREAD);
+
+			{
+				const std::lock_guard lock(mutex_);
+
+				// Deal the ranges round-robin
+				for (std::size_t r = 0; r < n_ranges; ++r)
+				{
+					auto &                queue = *queues_[r % size()];
+					const std::lock_guard queue_lock(queue.mutex_);
+					queue.ranges_.push_back({ n * r / n_ranges, n * (r + 1) / n_ranges });
+				}
+
+				++job_;
+			}
+			job_cv_.notify_all();
+
+			work(0);
+
+			std::unique_lock lock(mutex_);
+			done_cv_.wait(lock, [&] { return active_ == 0; });
+
+			if (error_ not_eq nullptr) { std::rethrow_exception(std::exchange(error_, nullptr)); }
+		}
+	};
+} // namespace prox
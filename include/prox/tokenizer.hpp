@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>   // for min
+#include <bit>         // for countr_zero, endian
+#include <cstdint>     // for uint32_t, uint64_t
+#include <cstring>     // for memcpy
+#include <limits>      // for numeric_limits
+#include <span>        // for span
+#include <string_view> // for string_view
+#include <utility>     // for cmp_less
+
+#if defined(__x86_64__) and (defined(__GNUC__) or defined(__clang__))
+	#define PROX_TOKENIZER_X86 1
+	#include <immintrin.h> // for _mm_*, _mm256_*
+#else
+	#define PROX_TOKENIZER_X86 0
+#endif
+
+namespace prox
+{
+	// Position of a field within a line: [begin, end)
+	struct field
+	{
+		std::uint32_t begin{};
+		std::uint32_t end{};
+
+		[[nodiscard]] auto size() const -> std::uint32_t { return end - begin; }
+	};
+
+	enum class simd_level
+	{
+		scalar,
+		sse2,
+		avx2
+	};
+
+	namespace tokenizer
+	{
+		[[nodiscard]] constexpr auto is_separator(const char c) -> bool { return c == ' ' or c == '\n'; }
+
+		// Append the fields whose boundaries are marked in a block of "width" characters starting at "offset".
+		// "sep" has one bit per character set when it is a separator; "prev_sep" tells whether the character before the
+		// block was one.
+		inline void emit_block(std::uint64_t sep, const std::uint32_t offset, const unsigned width, bool & prev_sep,
+		                       std::span<field> fields, std::size_t & n_begins, std::size_t & n_ends)
+		{
+			const auto block_mask = (width == 64) ? ~std::uint64_t{} : ((std::uint64_t{ 1 } << width) - 1);
+
+			sep &= block_mask;
+
+			const auto shifted = (sep << 1) | static_cast<std::uint64_t>(prev_sep);
+
+			auto begins = ~sep & shifted & block_mask;
+			auto ends   = sep & ~shifted;
+
+			while (begins not_eq 0 and n_begins < fields.size())
+			{
+				fields[n_begins++].begin = offset + static_cast<std::uint32_t>(std::countr_zero(begins));
+				begins &= begins - 1;
+			}
+
+			while (ends not_eq 0 and n_ends < n_begins)
+			{
+				fields[n_ends++].end = offset + static_cast<std::uint32_t>(std::countr_zero(ends));
+				ends &= ends - 1;
+			}
+
+			prev_sep = static_cast<bool>((sep >> (width - 1)) & 1U);
+		}
+
+		// Scan the last (partial) block of a line character by character
+		inline void tail(const std::string_view line, std::uint32_t offset, bool & prev_sep, std::span<field> fields,
+		                 std::size_t & n_begins, std::size_t & n_ends)
+		{
+			while (offset < line.size() and n_ends < fields.size())
+			{
+				const auto width = static_cast<unsigned>(std::min<std::size_t>(64, line.size() - offset));
+
+				std::uint64_t sep = 0;
+				for (unsigned i = 0; i < width; ++i)
+				{
+					sep |= static_cast<std::uint64_t>(is_separator(line[offset + i])) << i;
+				}
+
+				emit_block(sep, offset, width, prev_sep, fields, n_begins, n_ends);
+
+				offset += width;
+			}
+		}
+
+		// Close the last field if the line does not end with a separator
+		inline auto finish(const std::string_view line, std::span<field> fields, const std::size_t n_begins,
+		                   std::size_t n_ends) -> std::size_t
+		{
+			if (n_ends < n_begins) { fields[n_ends++].end = static_cast<std::uint32_t>(line.size()); }
+			return n_begins;
+		}
+
+		inline auto tokenize_scalar(const std::string_view line, std::span<field> fields) -> std::size_t
+		{
+			bool        prev_sep = true;
+			std::size_t n_begins = 0;
+			std::size_t n_ends   = 0;
+
+			tail(line, 0, prev_sep, fields, n_begins, n_ends);
+
+			return finish(line, fields, n_begins, n_ends);
+		}
+
+#if PROX_TOKENIZER_X86
+		inline auto tokenize_sse2(const std::string_view line, std::span<field> fields) -> std::size_t
+		{
+			static constexpr std::uint32_t WIDTH = 16;
+
+			const auto spaces   = _mm_set1_epi8(' ');
+			const auto newlines = _mm_set1_epi8('\n');
+
+			bool          prev_sep = true;
+			std::size_t   n_begins = 0;
+			std::size_t   n_ends   = 0;
+			std::uint32_t offset   = 0;
+
+			for (; offset + WIDTH <= line.size() and n_ends < fields.size(); offset += WIDTH)
+			{
+				const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line.data() + offset));
+				const auto sep   = _mm_or_si128(_mm_cmpeq_epi8(chunk, spaces), _mm_cmpeq_epi8(chunk, newlines));
+				const auto mask  = static_cast<std::uint32_t>(_mm_movemask_epi8(sep));
+
+				emit_block(mask, offset, WIDTH, prev_sep, fields, n_begins, n_ends);
+			}
+
+			tail(line, offset, prev_sep, fields, n_begins, n_ends);
+
+			return finish(line, fields, n_begins, n_ends);
+		}
+
+		__attribute__((target("avx2"))) inline auto tokenize_avx2(const std::string_view line,
+		                                                          std::span<field>       fields) -> std::size_t
+		{
+			static constexpr std::uint32_t WIDTH = 32;
+
+			const auto spaces   = _mm256_set1_epi8(' ');
+			const auto newlines = _mm256_set1_epi8('\n');
+
+			bool          prev_sep = true;
+			std::size_t   n_begins = 0;
+			std::size_t   n_ends   = 0;
+			std::uint32_t offset   = 0;
+
+			for (; offset + WIDTH <= line.size() and n_ends < fields.size(); offset += WIDTH)
+			{
+				const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(line.data() + offset));
+				const auto sep = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, spaces), _mm256_cmpeq_epi8(chunk, newlines));
+				const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(sep));
+
+				emit_block(mask, offset, WIDTH, prev_sep, fields, n_begins, n_ends);
+			}
+
+			tail(line, offset, prev_sep, fields, n_begins, n_ends);
+
+			return finish(line, fields, n_begins, n_ends);
+		}
+#endif
+
+		using tokenize_fn = std::size_t (*)(std::string_view, std::span<field>);
+
+		[[nodiscard]] inline auto detect_simd_level() -> simd_level
+		{
+#if PROX_TOKENIZER_X86
+			if (__builtin_cpu_supports("avx2")) { return simd_level::avx2; }
+			return simd_level::sse2; // SSE2 is part of the x86-64 baseline
+#else
+			return simd_level::scalar;
+#endif
+		}
+
+		[[nodiscard]] inline auto tokenizer_for(const simd_level level) -> tokenize_fn
+		{
+			switch (level)
+			{
+#if PROX_TOKENIZER_X86
+				case simd_level::avx2:
+					return tokenize_avx2;
+				case simd_level::sse2:
+					return tokenize_sse2;
+#endif
+				default:
+					return tokenize_scalar;
+			}
+		}
+
+		static constexpr std::size_t CHUNK      = sizeof(std::uint64_t);
+		static constexpr std::size_t MAX_DIGITS = std::numeric_limits<std::uint64_t>::digits10 + 1;
+
+		// Decode 8 ASCII digits packed in a little-endian word at once (SWAR).
+		// Returns false if any of them is not a digit.
+		[[nodiscard]] inline auto decode_8_digits(std::uint64_t chunk, std::uint64_t & value) -> bool
+		{
+			static constexpr std::uint64_t ZEROS = 0x3030303030303030ULL;
+			static constexpr std::uint64_t HIGH  = 0xF0F0F0F0F0F0F0F0ULL;
+			static constexpr std::uint64_t SIXES = 0x0606060606060606ULL;
+
+			if (((chunk & HIGH) not_eq ZEROS) or (((chunk + SIXES) & HIGH) not_eq ZEROS)) { return false; }
+
+			// Combine pairs of digits, then pairs of pairs, then the two halves
+			chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+			chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+			chunk = ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+
+			value = chunk;
+			return true;
+		}
+
+		// Decode the "length" (1 to 8) digits that end right before "last". The 8 bytes before "last" must be readable.
+		[[nodiscard]] inline auto decode_chunk_ending_at(const char * last, const std::size_t length,
+		                                                 std::uint64_t & value) -> bool
+		{
+			static constexpr std::uint64_t ZEROS = 0x3030303030303030ULL;
+
+			std::uint64_t chunk = 0;
+			std::memcpy(&chunk, last - CHUNK, CHUNK);
+
+			// Replace the bytes that precede the digits by '0's
+			const auto padding = (length == CHUNK) ? std::uint64_t{} : (~std::uint64_t{} >> (length * 8));
+			chunk              = (chunk & ~padding) | (ZEROS & padding);
+
+			return decode_8_digits(chunk, value);
+		}
+
+		// Decode an unsigned decimal number of at most 20 digits one digit at a time
+		[[nodiscard]] inline auto decode_digits_scalar(const char * first, const char * last, std::uint64_t & value)
+		    -> bool
+		{
+			value = 0;
+
+			for (; first not_eq last; ++first)
+			{
+				const auto digit = static_cast<unsigned char>(*first - '0');
+				if (digit > 9 or __builtin_mul_overflow(value, 10U, &value) or
+				    __builtin_add_overflow(value, digit, &value))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Decode an unsigned decimal number of at most 20 digits in [first, last), 8 digits at a time.
+		// "line_begin" tells how far back the chunks can be loaded from.
+		[[nodiscard]] inline auto decode_digits(const char * line_begin, const char * first, const char * last,
+		                                        std::uint64_t & value) -> bool
+		{
+			static constexpr std::uint64_t POW_10_8  = 100'000'000ULL;
+			static constexpr std::uint64_t POW_10_16 = POW_10_8 * POW_10_8;
+
+			const auto length = static_cast<std::size_t>(last - first);
+
+			if (length == 0 or length > MAX_DIGITS) { return false; }
+
+			const auto n_chunks = (length + CHUNK - 1) / CHUNK;
+
+			// Fields too close to the beginning of the line cannot load whole words backwards
+			if (std::endian::native not_eq std::endian::little or
+			    std::cmp_less(last - line_begin, n_chunks * CHUNK))
+			{
+				return decode_digits_scalar(first, last, value);
+			}
+
+			if (not decode_chunk_ending_at(last, std::min(length, CHUNK), value)) { return false; }
+
+			if (length <= CHUNK) { return true; }
+
+			std::uint64_t mid = 0;
+			if (not decode_chunk_ending_at(last - CHUNK, std::min(length - CHUNK, CHUNK), mid)) { return false; }
+
+			value += mid * POW_10_8;
+
+			if (length <= 2 * CHUNK) { return true; }
+
+			std::uint64_t high = 0;
+			if (not decode_chunk_ending_at(last - (2 * CHUNK), length - (2 * CHUNK), high)) { return false; }
+
+			return not __builtin_mul_overflow(high, POW_10_16, &high) and
+			       not __builtin_add_overflow(value, high, &value);
+		}
+	} // namespace tokenizer
+
+	// SIMD level used by tokenize(), chosen once at runtime
+	[[nodiscard]] inline auto active_simd_level() -> simd_level
+	{
+		static const auto LEVEL = tokenizer::detect_simd_level();
+		return LEVEL;
+	}
+
+	// Find the boundaries of the space-separated fields of "line" in one pass.
+	// Returns the number of fields stored in "fields" (never more than fields.size()).
+	inline auto tokenize(const std::string_view line, std::span<field> fields) -> std::size_t
+	{
+		static const auto TOKENIZE = tokenizer::tokenizer_for(active_simd_level());
+		return TOKENIZE(line, fields);
+	}
+
+	// Decode a decimal integer (optionally negative, stored in two's complement) from a field of "line".
+	// Returns false if the field is not a valid integer.
+	[[nodiscard]] inline auto decode_integer(const std::string_view line, const field & f, std::uint64_t & value)
+	    -> bool
+	{
+		const auto * first = line.data() + f.begin;
+		const auto * last  = line.data() + f.end;
+
+		const bool negative = *first == '-';
+		if (negative) { ++first; }
+
+		if (not tokenizer::decode_digits(line.data(), first, last, value)) { return false; }
+
+		if (negative) { value = ~value + 1; }
+
+		return true;
+	}
+
+	// Decode a batch of decimal integers from the fields of "line".
+	// Returns the number of fields decoded; it is smaller than fields.size() if a field is not a valid integer.
+	// Only tokenize() uses SSE2/AVX2: the fields are converted one after another, 8 digits at a time within a
+	// general-purpose register (SWAR, see tokenizer::decode_digits()).
+	inline auto decode_integers(const std::string_view line, std::span<const field> fields,
+	                            std::span<std::uint64_t> values) -> std::size_t
+	{
+		const auto n = std::min(fields.size(), values.size());
+
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			if (not decode_integer(line, fields[i], values[i])) { return i; }
+		}
+
+		return n;
+	}
+} // namespace prox
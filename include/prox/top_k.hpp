@@ -0,0 +1,95 @@
+#pragma once
+
+#include <sys/types.h> // for pid_t
+
+#include <algorithm> // for make_heap, push_heap, pop_heap, sort_heap, min
+#include <cstddef>   // for size_t
+#include <span>      // for span
+#include <vector>    // for vector
+
+namespace prox
+{
+	// PID and the value it is ranked by
+	struct ranked_pid
+	{
+		pid_t  pid   = -1;
+		double value = 0.0;
+	};
+
+	// The "capacity" PIDs with the highest values among those offered since the last clear(). Kept in a bounded
+	// min-heap (the smallest of the kept values is at the front), so offering n values costs O(n log capacity) and
+	// the memory is allocated once. finish() sorts the heap, after which top(k) is O(1) for any k up to the capacity.
+	class top_k
+	{
+		std::size_t capacity_ = 0;
+
+		std::vector<ranked_pid> heap_{};
+
+		bool sorted_ = true;
+
+		// Heap order: higher values first, ties broken by the lower PID (so the result does not depend on the order
+		// of the offers)
+		[[nodiscard]] static auto before(const ranked_pid & a, const ranked_pid & b)
+		{
+			return a.value > b.value or (not (a.value < b.value) and a.pid < b.pid);
+		}
+
+	public:
+		top_k() = default;
+
+		explicit top_k(const std::size_t capacity) : capacity_(capacity) { heap_.reserve(capacity_); }
+
+		[[nodiscard]] auto capacity() const { return capacity_; }
+
+		[[nodiscard]] auto size() const { return heap_.size(); }
+
+		[[nodiscard]] auto empty() const { return heap_.empty(); }
+
+		void clear()
+		{
+			heap_.clear();
+			sorted_ = true;
+		}
+
+		void offer(const pid_t pid, const double value)
+		{
+			if (capacity_ == 0) { return; }
+
+			const ranked_pid candidate{ pid, value };
+
+			// Offered after finish(): back to a heap
+			if (sorted_)
+			{
+				std::make_heap(heap_.begin(), heap_.end(), before);
+				sorted_ = false;
+			}
+
+			if (heap_.size() < capacity_)
+			{
+				heap_.emplace_back(candidate);
+				std::push_heap(heap_.begin(), heap_.end(), before);
+			}
+			else if (before(candidate, heap_.front()))
+			{
+				std::pop_heap(heap_.begin(), heap_.end(), before);
+				heap_.back() = candidate;
+				std::push_heap(heap_.begin(), heap_.end(), before);
+			}
+		}
+
+		// Sort the kept PIDs from the highest value to the lowest. Must be called before top(), once all the values
+		// have been offered.
+		void finish()
+		{
+			if (sorted_) { return; }
+			std::sort_heap(heap_.begin(), heap_.end(), before);
+			sorted_ = true;
+		}
+
+		// The (at most) "k" PIDs with the highest values, highest first
+		[[nodiscard]] auto top(const std::size_t k) const -> std::span<const ranked_pid>
+		{
+			return std::span(heap_).first(std::min(k, heap_.size()));
+		}
+	};
+} // namespace prox
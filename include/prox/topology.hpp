@@ -0,0 +1,353 @@
+#pragma once
+
+#include <fcntl.h>  // for open, O_RDONLY, O_CLOEXEC
+#include <unistd.h> // for pread
+
+#include <algorithm>    // for max, min
+#include <array>        // for array
+#include <charconv>     // for from_chars
+#include <cstddef>      // for size_t
+#include <filesystem>   // for path, directory_iterator
+#include <numeric>      // for partial_sum
+#include <optional>     // for optional, nullopt
+#include <span>         // for span
+#include <stdexcept>    // for runtime_error
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <system_error> // for errc
+#include <utility>      // for cmp_equal, cmp_less, move
+#include <vector>       // for vector
+
+#include <fmt/core.h> // for format
+
+#include "fd_cache.hpp"     // for unique_fd
+#include "per_cpu_time.hpp" // for cpu_load
+
+namespace prox
+{
+	// Contents of a small sysfs file without the trailing newline, or std::nullopt if it cannot be read
+	[[nodiscard]] static inline auto read_sys_file(const std::filesystem::path & file) -> std::optional<std::string>
+	{
+		const unique_fd fd(::open(file.c_str(), O_RDONLY | O_CLOEXEC));
+		if (std::cmp_equal(fd.get(), -1)) { return std::nullopt; }
+
+		std::array<char, 4096> buffer{};
+
+		const auto n_read = ::pread(fd.get(), buffer.data(), buffer.size(), 0);
+		if (std::cmp_less(n_read, 0)) { return std::nullopt; }
+
+		std::string_view contents(buffer.data(), static_cast<std::size_t>(n_read));
+		while (contents.ends_with('\n'))
+		{
+			contents.remove_suffix(1);
+		}
+
+		return std::string(contents);
+	}
+
+	// Call "fn" with every CPU of a CPU list (e.g. "0-3,8,10-11", as in /sys/devices/system/cpu/online)
+	template<typename Fn>
+	static inline void for_each_cpu_in_list(const std::string_view list, Fn && fn)
+	{
+		const auto parse = [&](const std::string_view number) {
+			std::size_t value = 0;
+			if (const auto [ptr, ec] = std::from_chars(number.data(), number.data() + number.size(), value);
+			    ec not_eq std::errc{} or ptr not_eq number.data() + number.size())
+			{
+				const auto error = fmt::format("Invalid CPU list: \"{}\"", list);
+				throw std::runtime_error(error);
+			}
+			return value;
+		};
+
+		std::size_t pos = 0;
+		while (pos < list.size())
+		{
+			const auto comma = std::min(list.find(',', pos), list.size());
+			const auto range = list.substr(pos, comma - pos);
+			pos              = comma + 1;
+
+			if (range.empty()) { continue; }
+
+			const auto dash  = range.find('-');
+			const auto first = parse(range.substr(0, dash));
+			const auto last  = dash == std::string_view::npos ? first : parse(range.substr(dash + 1));
+
+			for (auto cpu = first; cpu <= last; ++cpu)
+			{
+				fn(cpu);
+			}
+		}
+	}
+
+	// Core, last-level cache (LLC) and NUMA node of every CPU, SMT siblings and online CPUs, discovered from sysfs
+	// into flat tables indexed by CPU number, so every lookup is an array load. The cores and LLC domains are
+	// numbered densely, in the order of their first CPU. refresh() reads it again (e.g. after a CPU hotplug).
+	class cpu_topology
+	{
+	public:
+		static constexpr auto DEFAULT_SYS_PATH = "/sys/devices/system";
+
+	private:
+		std::filesystem::path sys_path_{};
+
+		std::vector<int>  node_of_{}; // CPU -> NUMA node
+		std::vector<int>  llc_of_{};  // CPU -> LLC domain
+		std::vector<int>  core_of_{}; // CPU -> core
+		std::vector<char> online_{};  // CPU -> online (bool, without the packing of std::vector<bool>)
+
+		std::vector<std::size_t> siblings_first_{}; // Rows [siblings_first_[c], siblings_first_[c + 1]) of siblings_
+		std::vector<int>         siblings_{};       // are the CPUs of core c
+
+		std::size_t n_nodes_ = 0;
+		std::size_t n_llcs_  = 0;
+		std::size_t n_cores_ = 0;
+
+		// First CPU sharing the last-level cache of "cpu", or "cpu" if its caches are not listed
+		[[nodiscard]] static auto llc_leader(const std::filesystem::path & cpu_path, const std::size_t cpu)
+		{
+			const auto cache_path = cpu_path / fmt::format("cpu{}", cpu) / "cache";
+
+			std::error_code ec;
+			if (not std::filesystem::is_directory(cache_path, ec)) { return cpu; }
+
+			int         llc_level = -1;
+			std::size_t leader    = cpu;
+
+			for (const auto & index : std::filesystem::directory_iterator(cache_path, ec))
+			{
+				if (not index.path().filename().string().starts_with("index")) { continue; }
+
+				const auto type   = read_sys_file(index.path() / "type");
+				const auto level  = read_sys_file(index.path() / "level");
+				const auto shared = read_sys_file(index.path() / "shared_cpu_list");
+
+				if (not type.has_value() or not level.has_value() or not shared.has_value()) { continue; }
+				if (*type == "Instruction") { continue; }
+
+				int lvl = 0;
+				std::from_chars(level->data(), level->data() + level->size(), lvl);
+				if (lvl <= llc_level) { continue; }
+
+				llc_level = lvl;
+				leader    = cpu;
+				for_each_cpu_in_list(*shared, [&](const std::size_t sibling) { leader = std::min(leader, sibling); });
+			}
+
+			return leader;
+		}
+
+		// First SMT sibling of "cpu" (the first CPU of its core), or "cpu" if its siblings are not listed
+		[[nodiscard]] static auto core_leader(const std::filesystem::path & cpu_path, const std::size_t cpu)
+		{
+			const auto topology_path = cpu_path / fmt::format("cpu{}", cpu) / "topology";
+
+			const auto siblings = read_sys_file(topology_path / "thread_siblings_list");
+			if (not siblings.has_value()) { return cpu; }
+
+			std::size_t leader = cpu;
+			for_each_cpu_in_list(*siblings, [&](const std::size_t sibling) { leader = std::min(leader, sibling); });
+			return leader;
+		}
+
+		// Number the domains led by "leader_of(cpu)" densely into "domain_of". Returns the number of domains.
+		template<typename Leader_of>
+		static auto number_domains(std::vector<int> & domain_of, Leader_of && leader_of) -> std::size_t
+		{
+			const auto n_cpus = domain_of.size();
+
+			std::size_t      n_domains = 0;
+			std::vector<int> domain_of_leader(n_cpus, -1);
+
+			for (std::size_t cpu = 0; cpu < n_cpus; ++cpu)
+			{
+				const auto leader = std::min<std::size_t>(leader_of(cpu), n_cpus - 1);
+				if (domain_of_leader[leader] < 0) { domain_of_leader[leader] = static_cast<int>(n_domains++); }
+				domain_of[cpu] = domain_of_leader[leader];
+			}
+
+			return n_domains;
+		}
+
+		template<typename Table>
+		[[nodiscard]] static auto lookup(const Table & table, const int cpu, const int missing)
+		{
+			if (std::cmp_less(cpu, 0) or not std::cmp_less(cpu, table.size())) { return missing; }
+			return static_cast<int>(table[static_cast<std::size_t>(cpu)]);
+		}
+
+	public:
+		cpu_topology() = default;
+
+		// Read the topology of the CPUs in "<sys_path>/cpu/possible" from "<sys_path>/node/node*/cpulist",
+		// "<sys_path>/cpu/online" and "<sys_path>/cpu/cpu*/{cache,topology}". Without NUMA information, all the CPUs
+		// are on node 0; without cache or SMT information, every CPU is its own LLC domain or core; without the
+		// online list, all the CPUs are online.
+		explicit cpu_topology(std::filesystem::path sys_path) : sys_path_(std::move(sys_path)) { refresh(); }
+
+		// Topology of this machine, or an empty one (every lookup misses) if sysfs cannot be read
+		[[nodiscard]] static auto discover() -> cpu_topology
+		{
+			try
+			{
+				return cpu_topology(DEFAULT_SYS_PATH);
+			}
+			catch (const std::runtime_error &)
+			{
+				return {};
+			}
+		}
+
+		// Read the topology again, e.g. after CPUs have been plugged or unplugged. References to the object are still
+		// valid.
+		void refresh()
+		{
+			const auto cpu_path  = sys_path_ / "cpu";
+			const auto node_path = sys_path_ / "node";
+
+			const auto possible = read_sys_file(cpu_path / "possible");
+			if (not possible.has_value())
+			{
+				const auto error = fmt::format("Could not read the possible CPUs from {}", cpu_path.string());
+				throw std::runtime_error(error);
+			}
+
+			std::size_t n_cpus = 0;
+			for_each_cpu_in_list(*possible, [&](const std::size_t cpu) { n_cpus = std::max(n_cpus, cpu + 1); });
+
+			node_of_.assign(n_cpus, 0);
+			llc_of_.assign(n_cpus, 0);
+			core_of_.assign(n_cpus, 0);
+
+			// Online CPUs
+			if (const auto online = read_sys_file(cpu_path / "online"); online.has_value())
+			{
+				online_.assign(n_cpus, 0);
+				for_each_cpu_in_list(*online, [&](const std::size_t cpu) {
+					if (cpu < n_cpus) { online_[cpu] = 1; }
+				});
+			}
+			else { online_.assign(n_cpus, 1); }
+
+			// NUMA nodes
+			n_nodes_ = 1;
+
+			std::error_code ec;
+			for (const auto & node : std::filesystem::directory_iterator(node_path, ec))
+			{
+				const auto name = node.path().filename().string();
+				if (not name.starts_with("node")) { continue; }
+
+				std::size_t id = 0;
+				if (const auto [ptr, err] = std::from_chars(name.data() + 4, name.data() + name.size(), id);
+				    err not_eq std::errc{} or ptr not_eq name.data() + name.size())
+				{
+					continue;
+				}
+
+				const auto cpus = read_sys_file(node.path() / "cpulist");
+				if (not cpus.has_value()) { continue; }
+
+				n_nodes_ = std::max(n_nodes_, id + 1);
+				for_each_cpu_in_list(*cpus, [&](const std::size_t cpu) {
+					if (cpu < n_cpus) { node_of_[cpu] = static_cast<int>(id); }
+				});
+			}
+
+			// LLC domains and cores
+			n_llcs_  = number_domains(llc_of_, [&](const std::size_t cpu) { return llc_leader(cpu_path, cpu); });
+			n_cores_ = number_domains(core_of_, [&](const std::size_t cpu) { return core_leader(cpu_path, cpu); });
+
+			// SMT siblings: counting sort of the CPUs by core
+			siblings_first_.assign(n_cores_ + 1, 0);
+			for (const auto core : core_of_)
+			{
+				++siblings_first_[static_cast<std::size_t>(core) + 1];
+			}
+
+			std::partial_sum(siblings_first_.begin(), siblings_first_.end(), siblings_first_.begin());
+
+			siblings_.resize(n_cpus);
+			std::vector<std::size_t> next(siblings_first_.begin(), siblings_first_.end() - 1);
+			for (std::size_t cpu = 0; cpu < n_cpus; ++cpu)
+			{
+				siblings_[next[static_cast<std::size_t>(core_of_[cpu])]++] = static_cast<int>(cpu);
+			}
+		}
+
+		[[nodiscard]] auto sys_path() const -> const std::filesystem::path & { return sys_path_; }
+
+		// Number of possible CPUs (the highest CPU number plus one)
+		[[nodiscard]] auto size() const { return node_of_.size(); }
+
+		// Number of NUMA nodes (the highest node number plus one)
+		[[nodiscard]] auto n_nodes() const { return n_nodes_; }
+
+		[[nodiscard]] auto n_llcs() const { return n_llcs_; }
+
+		[[nodiscard]] auto n_cores() const { return n_cores_; }
+
+		// NUMA node of "cpu", or -1 if it is not a possible CPU
+		[[nodiscard]] auto node_of(const int cpu) const { return lookup(node_of_, cpu, -1); }
+
+		// LLC domain of "cpu", or -1 if it is not a possible CPU
+		[[nodiscard]] auto llc_of(const int cpu) const { return lookup(llc_of_, cpu, -1); }
+
+		// Core of "cpu", or -1 if it is not a possible CPU
+		[[nodiscard]] auto core_of(const int cpu) const { return lookup(core_of_, cpu, -1); }
+
+		[[nodiscard]] auto online(const int cpu) const { return lookup(online_, cpu, 0) not_eq 0; }
+
+		// CPUs of the core of "cpu" ("cpu" included), in increasing order
+		[[nodiscard]] auto smt_siblings(const int cpu) const -> std::span<const int>
+		{
+			const auto core = core_of(cpu);
+			if (core < 0) { return {}; }
+
+			const auto c = static_cast<std::size_t>(core);
+			return std::span(siblings_).subspan(siblings_first_[c], siblings_first_[c + 1] - siblings_first_[c]);
+		}
+
+		[[nodiscard]] auto nodes() const -> std::span<const int> { return node_of_; }
+
+		[[nodiscard]] auto llcs() const -> std::span<const int> { return llc_of_; }
+
+		[[nodiscard]] auto cores() const -> std::span<const int> { return core_of_; }
+	};
+
+	// Utilization of the NUMA nodes and LLC domains of a topology: the sums of the loads of their online CPUs
+	class topology_load
+	{
+		std::vector<cpu_load> nodes_{};
+		std::vector<cpu_load> llcs_{};
+
+	public:
+		// Sum "cpus" (indexed by CPU number, e.g. per_CPU_time::cpus()) into the domains of "topology"
+		void roll_up(const cpu_topology & topology, const std::span<const cpu_load> cpus)
+		{
+			nodes_.assign(topology.n_nodes(), {});
+			llcs_.assign(topology.n_llcs(), {});
+
+			for (std::size_t cpu = 0; cpu < cpus.size(); ++cpu)
+			{
+				if (not cpus[cpu].online) { continue; }
+
+				const auto node = topology.node_of(static_cast<int>(cpu));
+				const auto llc  = topology.llc_of(static_cast<int>(cpu));
+
+				if (node >= 0) { nodes_[static_cast<std::size_t>(node)] += cpus[cpu]; }
+				if (llc >= 0) { llcs_[static_cast<std::size_t>(llc)] += cpus[cpu]; }
+			}
+		}
+
+		// Indexed by NUMA node
+		[[nodiscard]] auto nodes() const -> std::span<const cpu_load> { return nodes_; }
+
+		// Indexed by LLC domain (see cpu_topology::llc_of())
+		[[nodiscard]] auto llcs() const -> std::span<const cpu_load> { return llcs_; }
+
+		[[nodiscard]] auto node(const std::size_t node) const -> const cpu_load & { return nodes_.at(node); }
+
+		[[nodiscard]] auto llc(const std::size_t llc) const -> const cpu_load & { return llcs_.at(llc); }
+	};
+} // namespace prox
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "prox/proc_connector.hpp"
+
+namespace prox
+{
+	// Stand-in for the kernel proc connector: a socketpair that carries the same messages
+	class Mock_proc_connector
+	{
+		std::array<int, 2> fds_{ -1, -1 };
+
+		void send(const proc_event & event, const __u16 type = NLMSG_DONE) const
+		{
+			alignas(nlmsghdr) std::array<char, netlink::space(sizeof(cn_msg) + sizeof(proc_event))> buffer{};
+
+			auto * header      = reinterpret_cast<nlmsghdr *>(buffer.data());
+			header->nlmsg_len  = static_cast<__u32>(netlink::length(sizeof(cn_msg) + sizeof(proc_event)));
+			header->nlmsg_type = type;
+
+			auto * message  = reinterpret_cast<cn_msg *>(netlink::data(header));
+			message->id.idx = CN_IDX_PROC;
+			message->id.val = CN_VAL_PROC;
+			message->len    = sizeof(proc_event);
+			std::memcpy(message->data, &event, sizeof(event));
+
+			if (::send(fds_[1], buffer.data(), header->nlmsg_len, 0) < 0)
+			{
+				throw std::runtime_error("Could not send the mock event");
+			}
+		}
+
+	public:
+		Mock_proc_connector()
+		{
+			if (::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds_.data()) < 0)
+			{
+				throw std::runtime_error("Could not create the socketpair");
+			}
+		}
+
+		Mock_proc_connector(const Mock_proc_connector &)                     = delete;
+		auto operator=(const Mock_proc_connector &) -> Mock_proc_connector & = delete;
+
+		~Mock_proc_connector()
+		{
+			for (const auto fd : fds_)
+			{
+				if (fd not_eq -1) { ::close(fd); }
+			}
+		}
+
+		// The receiving end, to be owned by the proc_connector
+		auto connector() -> prox::proc_connector { return prox::proc_connector(std::exchange(fds_[0], -1)); }
+
+		void fork(const pid_t parent, const pid_t child, const pid_t child_tgid) const
+		{
+			proc_event event{};
+			event.what                        = proc_event::PROC_EVENT_FORK;
+			event.event_data.fork.parent_pid  = parent;
+			event.event_data.fork.parent_tgid = parent;
+			event.event_data.fork.child_pid   = child;
+			event.event_data.fork.child_tgid  = child_tgid;
+			send(event);
+		}
+
+		void fork(const pid_t parent, const pid_t child) const { fork(parent, child, child); }
+
+		void exec(const pid_t pid) const
+		{
+			proc_event event{};
+			event.what                         = proc_event::PROC_EVENT_EXEC;
+			event.event_data.exec.process_pid  = pid;
+			event.event_data.exec.process_tgid = pid;
+			send(event);
+		}
+
+		void exit(const pid_t pid) const
+		{
+			proc_event event{};
+			event.what                         = proc_event::PROC_EVENT_EXIT;
+			event.event_data.exit.process_pid  = pid;
+			event.event_data.exit.process_tgid = pid;
+			send(event);
+		}
+
+		void comm(const pid_t pid) const
+		{
+			proc_event event{};
+			event.what                         = proc_event::PROC_EVENT_COMM;
+			event.event_data.comm.process_pid  = pid;
+			event.event_data.comm.process_tgid = pid;
+			send(event);
+		}
+
+		void uid(const pid_t pid) const
+		{
+			proc_event event{};
+			event.what                       = proc_event::PROC_EVENT_UID;
+			event.event_data.id.process_pid  = pid;
+			event.event_data.id.process_tgid = pid;
+			send(event);
+		}
+
+		// The kernel could not deliver some events
+		void overrun() const { send(proc_event{}, NLMSG_OVERRUN); }
+	};
+} // namespace prox
@@ -9,7 +9,7 @@ namespace prox
 	class Mock_proc_dir
 	{
 	public:
-		const std::filesystem::path mock_proc_dir = std::filesystem::temp_directory_path() / "mock" / "proc";
+		const std::filesystem::path mock_proc_dir = mock_root() / "proc";
 
 		enum PIDs : pid_t
 		{
@@ -1,11 +1,30 @@
 #pragma once
 
+#include <unistd.h>
+
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <system_error>
 
 namespace prox
 {
+	// Folder for the mock files of this test binary. The binaries run in parallel (ctest -j), so they cannot share one.
+	inline auto mock_root() -> std::filesystem::path
+	{
+		return std::filesystem::temp_directory_path() / ("prox_mock_" + std::to_string(::getpid()));
+	}
+
+	// Removes mock_root() when the binary exits, whatever the tests left in it
+	inline const struct mock_root_cleanup
+	{
+		~mock_root_cleanup()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(mock_root(), error);
+		}
+	} MOCK_ROOT_CLEANUP{};
+
 	struct process_stat
 	{
 		using lint  = long int;
@@ -13,7 +32,7 @@ namespace prox
 		using ull   = unsigned long long int;
 
 		pid_t                 pid  = 123456789;
-		std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(pid);
+		std::filesystem::path path = mock_root() / std::to_string(pid);
 
 		std::string name                  = "my-mock-pid";
 		char        state                 = 'S';
@@ -116,10 +135,11 @@ namespace prox
 		    << " " << process.arg_start << " " << process.arg_end << " " << process.env_start << " " << process.env_end
 		    << " " << process.exit_code << std::endl;
 
-		// Write the "stat" file
-		const auto folder_path = process.path / "task" / std::to_string(process.pid);
+		// Write the "stat" file. Tasks (/proc/<pid>/task/<tid>) hold their files themselves.
+		const bool is_task     = process.path.parent_path().filename() == "task";
+		const auto folder_path = is_task ? process.path : process.path / "task" / std::to_string(process.pid);
 		std::filesystem::create_directories(folder_path);
-		const auto stat_path = process.path / "task" / std::to_string(process.pid) / "stat";
+		const auto stat_path = folder_path / "stat";
 
 		out.open(stat_path);
 		out << file_content.str();
@@ -138,7 +158,7 @@ namespace prox
 			file_content << child << " ";
 		}
 
-		const auto children_path = process.path / "task" / std::to_string(process.pid) / "children";
+		const auto children_path = folder_path / "children";
 
 		out.open(children_path);
 		out << file_content.str();
@@ -0,0 +1,174 @@
+#include "prox/change_log.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+#include "mock_process.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	auto find_change(const prox::change_log & log, const prox::process_change::kind what, const pid_t pid)
+	    -> const prox::process_change *
+	{
+		for (const auto & change : log)
+		{
+			if (change.what == what and change.pid == pid) { return &change; }
+		}
+		return nullptr;
+	}
+
+	auto mock_child(const prox::Mock_proc_dir & mock, const pid_t pid, const std::string & name)
+	{
+		prox::process_stat proc;
+		proc.pid  = pid;
+		proc.path = mock.mock_proc_dir / std::to_string(pid);
+		proc.name = name;
+		return proc;
+	}
+
+	template<typename Tree>
+	concept logs_changes = requires(Tree & tree, prox::change_log & log) { tree.update(log); };
+} // namespace
+
+TEST(ChangeLog, Record)
+{
+	prox::change_log log;
+
+	EXPECT_TRUE(log.empty());
+
+	log.record(prox::process_change::kind::spawn, 10);
+	log.record(prox::process_change::kind::exit, 11);
+	log.record({ prox::process_change::kind::migrate, 12, 0, 1, 0, 0 });
+
+	EXPECT_EQ(log.size(), 3);
+	EXPECT_EQ(log.count(prox::process_change::kind::spawn), 1);
+	EXPECT_EQ(log.count(prox::process_change::kind::exec), 0);
+	EXPECT_EQ(log.changes()[2].new_processor, 1);
+
+	log.clear();
+	EXPECT_TRUE(log.empty());
+}
+
+TEST(ChangeLog, NoChanges)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	prox::change_log log;
+	log.record(prox::process_change::kind::spawn, 42); // Cleared by the update
+
+	process_tree.update(log);
+	EXPECT_TRUE(log.empty());
+}
+
+TEST(ChangeLog, SpawnAndExit)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	auto spawned = mock_child(mock, 6, "spawned");
+	prox::write_mock_process_stat(spawned);
+
+	std::filesystem::remove_all(mock.mock_proc_dir / std::to_string(prox::Mock_proc_dir::PIDs::child2));
+
+	prox::change_log log;
+	process_tree.update(log);
+
+	EXPECT_EQ(log.size(), 2);
+	EXPECT_NE(find_change(log, prox::process_change::kind::spawn, 6), nullptr);
+	EXPECT_NE(find_change(log, prox::process_change::kind::exit, prox::Mock_proc_dir::PIDs::child2), nullptr);
+}
+
+TEST(ChangeLog, ExecAndMigrate)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// child1 runs a new program
+	auto child1 = mock_child(mock, prox::Mock_proc_dir::PIDs::child1, "new-program");
+	prox::write_mock_process_stat(child1);
+
+	// child2 moves to another processor
+	auto child2      = mock_child(mock, prox::Mock_proc_dir::PIDs::child2, "child2");
+	child2.processor = 0;
+	prox::write_mock_process_stat(child2);
+
+	prox::change_log log;
+	process_tree.update(log);
+
+	EXPECT_EQ(log.size(), 2);
+	EXPECT_NE(find_change(log, prox::process_change::kind::exec, prox::Mock_proc_dir::PIDs::child1), nullptr);
+
+	const auto * migration = find_change(log, prox::process_change::kind::migrate, prox::Mock_proc_dir::PIDs::child2);
+	ASSERT_NE(migration, nullptr);
+	EXPECT_EQ(migration->old_processor, prox::process_stat{}.processor);
+	EXPECT_EQ(migration->new_processor, 0);
+
+	// Nothing has changed since
+	process_tree.update(log);
+	EXPECT_TRUE(log.empty());
+}
+
+TEST(ChangeLog, ExecWithTheSameComm)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// child1 execs the same interpreter with other arguments: a new stack, and a new cmdline
+	auto child1 = mock_child(mock, prox::Mock_proc_dir::PIDs::child1, "child1");
+	child1.arg_start += 4096;
+	child1.arg_end += 4096;
+	prox::write_mock_process_stat(child1);
+
+	std::ofstream(child1.path / "cmdline") << "child1 --other-script";
+
+	prox::change_log log;
+	process_tree.update(log);
+
+	EXPECT_EQ(log.size(), 1);
+	EXPECT_NE(find_change(log, prox::process_change::kind::exec, prox::Mock_proc_dir::PIDs::child1), nullptr);
+	EXPECT_EQ(process_tree.cmdline(prox::Mock_proc_dir::PIDs::child1), "child1 --other-script");
+
+	// Nothing has changed since
+	process_tree.update(log);
+	EXPECT_TRUE(log.empty());
+}
+
+TEST(ChangeLog, CpuOnlyTree)
+{
+	// A tree that parses neither the comm nor the arguments could not tell the execs apart
+	static_assert(not logs_changes<prox::cpu_process_tree>);
+
+	using cpu_exec_process_tree = prox::basic_process_tree<prox::CPU_STAT_FIELDS | prox::EXEC_STAT_FIELDS>;
+	static_assert(logs_changes<cpu_exec_process_tree>);
+
+	prox::Mock_proc_dir mock{};
+
+	cpu_exec_process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// child1 runs a new program
+	auto child1 = mock_child(mock, prox::Mock_proc_dir::PIDs::child1, "new-program");
+	prox::write_mock_process_stat(child1);
+
+	prox::change_log log;
+	process_tree.update(log);
+
+	EXPECT_EQ(log.size(), 1);
+	EXPECT_NE(find_change(log, prox::process_change::kind::exec, prox::Mock_proc_dir::PIDs::child1), nullptr);
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
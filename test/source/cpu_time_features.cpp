@@ -1,5 +1,7 @@
 #include "prox/cpu_time.hpp"
 
+#include <fstream>
+
 #include <gtest/gtest.h>
 
 TEST(CPUTimeTest, InitialValues)
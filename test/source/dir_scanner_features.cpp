@@ -0,0 +1,122 @@
+#include "prox/dir_scanner.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	class Mock_dir
+	{
+	public:
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "mock" / "scanner";
+
+		explicit Mock_dir(const std::vector<pid_t> & pids)
+		{
+			std::filesystem::create_directories(path);
+
+			for (const auto pid : pids)
+			{
+				std::filesystem::create_directories(path / std::to_string(pid));
+			}
+
+			// None of these are PIDs
+			std::filesystem::create_directories(path / "self");
+			std::filesystem::create_directories(path / "12a");
+			std::filesystem::create_directories(path / "99999999999");
+			std::ofstream(path / "4242") << "regular file";
+		}
+
+		~Mock_dir() { std::filesystem::remove_all(path); }
+	};
+
+	auto scan(prox::pid_scanner & scanner, const auto & dir)
+	{
+		std::vector<pid_t> pids;
+		scanner.scan(dir, [&](const pid_t pid) { pids.emplace_back(pid); });
+		std::ranges::sort(pids);
+		return pids;
+	}
+} // namespace
+
+TEST(PidScanner, ParsePid)
+{
+	EXPECT_EQ(prox::parse_pid("1"), 1);
+	EXPECT_EQ(prox::parse_pid("4194304"), 4194304);
+	EXPECT_EQ(prox::parse_pid(""), -1);
+	EXPECT_EQ(prox::parse_pid("self"), -1);
+	EXPECT_EQ(prox::parse_pid("12a"), -1);
+	EXPECT_EQ(prox::parse_pid("-1"), -1);
+	EXPECT_EQ(prox::parse_pid("99999999999"), -1);
+}
+
+TEST(PidScanner, OnlyNumericDirectories)
+{
+	const std::vector<pid_t> expected = { 1, 2, 30, 400, 5000 };
+
+	Mock_dir mock(expected);
+
+	prox::pid_scanner scanner;
+	EXPECT_EQ(scan(scanner, mock.path), expected);
+}
+
+TEST(PidScanner, SmallBuffer)
+{
+	std::vector<pid_t> expected(200);
+	std::ranges::generate(expected, [pid = 100]() mutable { return pid++; });
+
+	Mock_dir mock(expected);
+
+	// Forces many getdents64 calls
+	prox::pid_scanner scanner(256);
+	EXPECT_EQ(scan(scanner, mock.path), expected);
+}
+
+TEST(PidScanner, ReuseDescriptor)
+{
+	const std::vector<pid_t> expected = { 7, 8, 9 };
+
+	Mock_dir mock(expected);
+
+	const int dir_fd = ::open(mock.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	ASSERT_NE(dir_fd, -1);
+
+	prox::pid_scanner scanner;
+	EXPECT_EQ(scan(scanner, dir_fd), expected);
+	EXPECT_EQ(scan(scanner, dir_fd), expected);
+
+	::close(dir_fd);
+}
+
+TEST(PidScanner, Proc)
+{
+	prox::pid_scanner scanner;
+
+	const auto pids = scan(scanner, std::filesystem::path("/proc"));
+
+	EXPECT_TRUE(std::ranges::binary_search(pids, 1));
+	EXPECT_TRUE(std::ranges::binary_search(pids, ::getpid()));
+
+	const auto tids = scan(scanner, std::filesystem::path("/proc/self/task"));
+	EXPECT_TRUE(std::ranges::binary_search(tids, ::getpid()));
+}
+
+TEST(PidScanner, NonExistentDirectory)
+{
+	prox::pid_scanner scanner;
+
+	EXPECT_THROW(scan(scanner, std::filesystem::path("/proc/does/not/exist")), std::runtime_error);
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
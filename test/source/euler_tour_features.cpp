@@ -0,0 +1,72 @@
+#include "prox/euler_tour.hpp"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	constexpr auto NO_PARENT = prox::euler_tour::NO_PARENT;
+
+	auto to_vector(const std::span<const pid_t> pids) { return std::vector<pid_t>(pids.begin(), pids.end()); }
+} // namespace
+
+TEST(EulerTour, Forest)
+{
+	//   10        50
+	//  /  \        |
+	// 20   30     60
+	//       |
+	//      40
+	const std::vector<pid_t>       pids      = { 40, 10, 50, 30, 20, 60 };
+	const std::vector<std::size_t> parent_of = { 3, NO_PARENT, NO_PARENT, 1, 1, 2 };
+
+	prox::euler_tour tour;
+	tour.build(pids, parent_of);
+
+	EXPECT_EQ(tour.size(), 6);
+	EXPECT_EQ(to_vector(tour.order()), (std::vector<pid_t>{ 10, 30, 40, 20, 50, 60 }));
+
+	EXPECT_EQ(to_vector(tour.descendants(1)), (std::vector<pid_t>{ 30, 40, 20 }));
+	EXPECT_EQ(to_vector(tour.descendants(3)), (std::vector<pid_t>{ 40 }));
+	EXPECT_TRUE(tour.descendants(0).empty());
+
+	EXPECT_TRUE(tour.within(0, 1));  // 40 under 10
+	EXPECT_TRUE(tour.within(0, 3));  // 40 under 30
+	EXPECT_TRUE(tour.within(3, 3));  // Inclusive
+	EXPECT_FALSE(tour.within(4, 3)); // 20 is not under 30
+	EXPECT_FALSE(tour.within(5, 1)); // Another tree
+	EXPECT_FALSE(tour.within(1, 0));
+}
+
+TEST(EulerTour, CyclesAndRebuilds)
+{
+	prox::euler_tour tour;
+
+	// 2 and 3 are the parent of each other: no root reaches them
+	const std::vector<pid_t>       pids      = { 1, 2, 3 };
+	const std::vector<std::size_t> parent_of = { NO_PARENT, 2, 1 };
+	tour.build(pids, parent_of);
+
+	EXPECT_EQ(tour.size(), 1);
+	EXPECT_FALSE(tour.visited(1));
+	EXPECT_FALSE(tour.within(1, 2));
+	EXPECT_TRUE(tour.descendants(2).empty());
+
+	// Rebuilt from scratch
+	const std::vector<std::size_t> chain = { NO_PARENT, 0, 1 };
+	tour.build(pids, chain);
+
+	EXPECT_EQ(to_vector(tour.descendants(0)), (std::vector<pid_t>{ 2, 3 }));
+	EXPECT_TRUE(tour.within(2, 0));
+
+	tour.clear();
+	EXPECT_EQ(tour.size(), 0);
+	EXPECT_FALSE(tour.visited(0));
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,257 @@
+#include "prox/fd_cache.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <iterator>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+#include "mock_process.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	auto is_open(const int fd) -> bool { return ::fcntl(fd, F_GETFD) not_eq -1; }
+
+	// Descriptors open in this process
+	auto count_open_fds()
+	{
+		const auto fds = std::filesystem::directory_iterator("/proc/self/fd");
+		return static_cast<std::size_t>(std::distance(begin(fds), end(fds)));
+	}
+
+	auto open_stat(const prox::process_stat & mock_process) -> int
+	{
+		return prox::open_proc_file(mock_process.path / "task" / std::to_string(mock_process.pid) / "stat");
+	}
+} // namespace
+
+TEST(FdCache, FindWhatWasInserted)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	prox::fd_cache cache(8);
+
+	const prox::fd_cache::key key{ mock_process.pid, mock_process.starttime };
+
+	EXPECT_EQ(cache.find(key, prox::proc_file::stat), -1);
+
+	const int fd = open_stat(mock_process);
+	EXPECT_TRUE(cache.insert(key, prox::proc_file::stat, fd));
+
+	EXPECT_EQ(cache.find(key, prox::proc_file::stat), fd);
+	EXPECT_EQ(cache.find(key, prox::proc_file::children), -1);
+	EXPECT_EQ(cache.open_fds(), 1);
+	EXPECT_EQ(cache.size(), 1);
+
+	// Descriptors are closed when the task is erased
+	cache.erase(key);
+	EXPECT_FALSE(is_open(fd));
+	EXPECT_EQ(cache.open_fds(), 0);
+}
+
+TEST(FdCache, RecycledPidDoesNotReuseDescriptors)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	prox::fd_cache cache(8);
+
+	const prox::fd_cache::key old_task{ mock_process.pid, mock_process.starttime };
+	const prox::fd_cache::key new_task{ mock_process.pid, mock_process.starttime + 1 };
+
+	const int fd = open_stat(mock_process);
+	ASSERT_TRUE(cache.insert(old_task, prox::proc_file::stat, fd));
+
+	EXPECT_EQ(cache.find(new_task, prox::proc_file::stat), -1);
+	EXPECT_FALSE(is_open(fd));
+	EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(FdCache, KeepsCachedDescriptorsWhenFull)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	prox::fd_cache cache(2);
+
+	const prox::fd_cache::key a{ 1, 10 };
+	const prox::fd_cache::key b{ 2, 20 };
+	const prox::fd_cache::key c{ 3, 30 };
+
+	const int fd_a = open_stat(mock_process);
+	const int fd_b = open_stat(mock_process);
+
+	ASSERT_TRUE(cache.insert(a, prox::proc_file::stat, fd_a));
+	ASSERT_TRUE(cache.insert(b, prox::proc_file::stat, fd_b));
+
+	// More tasks than the cap, read in the same order every tick: the ones cached first stay cached
+	for (int tick = 0; tick < 3; ++tick)
+	{
+		EXPECT_EQ(cache.find(a, prox::proc_file::stat), fd_a);
+		EXPECT_EQ(cache.find(b, prox::proc_file::stat), fd_b);
+		EXPECT_EQ(cache.find(c, prox::proc_file::stat), -1);
+
+		const int fd_c = open_stat(mock_process);
+		EXPECT_FALSE(cache.insert(c, prox::proc_file::stat, fd_c));
+		EXPECT_FALSE(is_open(fd_c));
+	}
+
+	EXPECT_EQ(cache.open_fds(), 2);
+	EXPECT_EQ(cache.size(), 2);
+
+	// Replacing a cached descriptor does not need room
+	const int new_fd_a = open_stat(mock_process);
+	EXPECT_TRUE(cache.insert(a, prox::proc_file::stat, new_fd_a));
+	EXPECT_FALSE(is_open(fd_a));
+	EXPECT_EQ(cache.find(a, prox::proc_file::stat), new_fd_a);
+	EXPECT_EQ(cache.open_fds(), 2);
+
+	// Erasing a task makes room for another one
+	cache.erase(b);
+	const int fd_c = open_stat(mock_process);
+	EXPECT_TRUE(cache.insert(c, prox::proc_file::stat, fd_c));
+	EXPECT_EQ(cache.find(c, prox::proc_file::stat), fd_c);
+
+	// Lowering the cap closes the least recently read descriptors
+	cache.max_open_fds(1);
+	EXPECT_EQ(cache.open_fds(), 1);
+	EXPECT_EQ(cache.size(), 1);
+	EXPECT_FALSE(is_open(new_fd_a));
+	EXPECT_EQ(cache.find(c, prox::proc_file::stat), fd_c);
+}
+
+TEST(FdCache, DisabledCache)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	prox::fd_cache cache(0);
+
+	const prox::fd_cache::key key{ mock_process.pid, mock_process.starttime };
+
+	const int fd = open_stat(mock_process);
+	EXPECT_FALSE(cache.insert(key, prox::proc_file::stat, fd));
+	EXPECT_FALSE(is_open(fd));
+	EXPECT_EQ(cache.open_fds(), 0);
+}
+
+TEST(FdCache, PreadReadsFromTheBeginning)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	const auto path = mock_process.path / "task" / std::to_string(mock_process.pid) / "stat";
+	const int  fd   = prox::open_proc_file(path);
+
+	std::string buffer;
+
+	const auto first  = prox::pread_proc_file(fd, path.native(), buffer);
+	const auto second = prox::pread_proc_file(fd, path.native(), buffer);
+
+	EXPECT_GT(first, 0);
+	EXPECT_EQ(first, second);
+	EXPECT_EQ(first, std::filesystem::file_size(path));
+
+	::close(fd);
+}
+
+TEST(FdCache, OpenRelativeToFolder)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	const prox::unique_fd dir_fd(prox::open_proc_dir(mock_process.path.string()));
+	ASSERT_TRUE(is_open(dir_fd.get()));
+
+	const prox::unique_fd fd(prox::open_proc_file(dir_fd.get(), "cmdline"));
+	EXPECT_TRUE(is_open(fd.get()));
+
+	EXPECT_THROW(std::ignore = prox::open_proc_file(dir_fd.get(), "non_existent_file"), std::runtime_error);
+	EXPECT_THROW(std::ignore = prox::open_proc_dir((mock_process.path / "cmdline").string()), std::runtime_error);
+}
+
+TEST(FdCache, OpenFromFolderPath)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	const prox::unique_fd fd(prox::open_proc_file(mock_process.path.string(), "cmdline"));
+	EXPECT_TRUE(is_open(fd.get()));
+
+	EXPECT_THROW(std::ignore = prox::open_proc_file(mock_process.path.string(), "non_existent_file"),
+	             std::runtime_error);
+}
+
+TEST(FdCache, ProcessTreeStaysUnderTheCap)
+{
+	const auto before = count_open_fds();
+
+	prox::process_tree tree;
+
+	// Only the proc folder stays open besides the cache: the processes do not hold descriptors of their own
+	for (const auto max_open_fds : { std::size_t{ 0 }, std::size_t{ 2 } })
+	{
+		tree.max_open_fds(max_open_fds);
+		tree.update();
+
+		EXPECT_LE(tree.open_fds(), max_open_fds);
+		EXPECT_EQ(count_open_fds(), before + 1 + tree.open_fds());
+	}
+}
+
+TEST(FdCache, ProcessTreeCachesTaskFolders)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+	tree.update();
+
+	// The folder, stat and children of every task: the files are opened relative to the folder
+	EXPECT_EQ(tree.open_fds(), 3 * tree.size());
+
+	const auto opened = count_open_fds();
+	tree.update();
+	EXPECT_EQ(count_open_fds(), opened);
+}
+
+TEST(FdCache, ProcessTreeWithMoreTasksThanTheCap)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// Room for the descriptors of some tasks only (the folder, stat and children of each)
+	const std::size_t max_open_fds = 3 * 2 + 1;
+	tree.max_open_fds(max_open_fds);
+	tree.update();
+
+	ASSERT_GT(3 * tree.size(), max_open_fds);
+	EXPECT_EQ(tree.open_fds(), max_open_fds);
+
+	// The cached descriptors stay, and the rest are opened and closed within the update
+	const auto opened = count_open_fds();
+	for (int tick = 0; tick < 3; ++tick)
+	{
+		tree.update();
+		EXPECT_EQ(tree.open_fds(), max_open_fds);
+		EXPECT_EQ(count_open_fds(), opened);
+	}
+}
+
+TEST(FdCache, OpenNonExistentFile)
+{
+	EXPECT_THROW(std::ignore = prox::open_proc_file("/proc/non_existent_file"), std::runtime_error);
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,274 @@
+#include "prox/io_uring.hpp"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+#include "mock_process.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	// io_uring might be disabled (seccomp, kernel.io_uring_disabled...) in the machine running the tests
+	auto make_collector() -> std::unique_ptr<prox::uring_collector>
+	{
+		try
+		{
+			return std::make_unique<prox::uring_collector>();
+		}
+		catch (const std::runtime_error &)
+		{
+			return nullptr;
+		}
+	}
+
+	auto task_dir(const prox::process_stat & mock_process)
+	{
+		return (mock_process.path / "task" / std::to_string(mock_process.pid)).string();
+	}
+} // namespace
+
+TEST(Uring, CollectFromPathsAndDescriptors)
+{
+	const auto collector = make_collector();
+	if (collector == nullptr) { GTEST_SKIP() << "io_uring is not available"; }
+
+	prox::process_stat mock_process;
+	mock_process.children = { 10, 20, 30 };
+	prox::write_mock_process_stat(mock_process);
+
+	const auto dir = task_dir(mock_process);
+
+	const prox::unique_fd dir_fd(prox::open_proc_dir(dir));
+
+	const int stat_fd     = prox::open_proc_file(dir, "stat");
+	const int children_fd = prox::open_proc_file(dir, "children");
+
+	// Same task thrice: from open descriptors, relative to its open folder and from the path of its folder
+	const std::vector<prox::uring_request> requests = {
+		{ dir, -1, stat_fd, children_fd },
+		{ dir, dir_fd.get(), -1, -1 },
+		{ dir, -1, -1, -1 },
+	};
+
+	std::size_t n_results = 0;
+
+	collector->collect(requests, [&](const std::size_t first, const auto results) {
+		EXPECT_EQ(first, 0);
+		ASSERT_EQ(results.size(), requests.size());
+
+		for (const auto & result : results)
+		{
+			ASSERT_TRUE(result.ok());
+
+			prox::stat parsed;
+			prox::parse_stat(result.stat, parsed);
+			EXPECT_EQ(parsed.pid, mock_process.pid);
+			EXPECT_EQ(parsed.comm, mock_process.name);
+			EXPECT_EQ(parsed.processor, mock_process.processor);
+
+			EXPECT_EQ(result.children, "10 20 30 ");
+			EXPECT_EQ(result.stx.stx_uid, ::getuid());
+
+			++n_results;
+		}
+	});
+
+	EXPECT_EQ(n_results, requests.size());
+
+	// Open descriptors are left untouched
+	EXPECT_NE(::fcntl(dir_fd.get(), F_GETFD), -1);
+	EXPECT_NE(::fcntl(stat_fd, F_GETFD), -1);
+	EXPECT_NE(::fcntl(children_fd, F_GETFD), -1);
+
+	::close(stat_fd);
+	::close(children_fd);
+}
+
+TEST(Uring, CollectSchedstat)
+{
+	const auto collector = make_collector();
+	if (collector == nullptr) { GTEST_SKIP() << "io_uring is not available"; }
+
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	const auto dir = task_dir(mock_process);
+
+	std::ofstream(std::filesystem::path(dir) / "schedstat") << "714615 71116 2\n";
+
+	const int schedstat_fd = prox::open_proc_file(dir, "schedstat");
+
+	// From an open descriptor, from the path of the folder and not read at all
+	const std::vector<prox::uring_request> requests = {
+		{ dir, -1, -1, -1, true, schedstat_fd, true },
+		{ dir, -1, -1, -1, true, -1, true },
+		{ dir, -1, -1, -1, true, -1, false },
+	};
+
+	collector->collect(requests, [&](const std::size_t /*first*/, const auto results) {
+		ASSERT_EQ(results.size(), requests.size());
+
+		for (const auto & result : results)
+		{
+			ASSERT_TRUE(result.ok());
+		}
+
+		EXPECT_EQ(prox::parse_schedstat(results[0].schedstat).run_ns, 714615);
+		EXPECT_EQ(prox::parse_schedstat(results[1].schedstat).timeslices, 2);
+		EXPECT_TRUE(results[2].schedstat.empty());
+	});
+
+	EXPECT_NE(::fcntl(schedstat_fd, F_GETFD), -1);
+
+	::close(schedstat_fd);
+}
+
+TEST(Uring, CollectNonExistentFiles)
+{
+	const auto collector = make_collector();
+	if (collector == nullptr) { GTEST_SKIP() << "io_uring is not available"; }
+
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	// The folder of a task that has finished
+	const auto dir = task_dir(mock_process);
+	std::filesystem::remove_all(mock_process.path);
+
+	const std::vector<prox::uring_request> requests = {
+		{ dir, -1, -1, -1 },
+	};
+
+	collector->collect(requests, [&](const std::size_t /*first*/, const auto results) {
+		ASSERT_EQ(results.size(), 1);
+		EXPECT_FALSE(results[0].ok());
+		EXPECT_EQ(results[0].stat_res, -ENOENT);
+	});
+}
+
+TEST(Uring, OpenedDescriptorsAreHandedOver)
+{
+	const auto collector = make_collector();
+	if (collector == nullptr) { GTEST_SKIP() << "io_uring is not available"; }
+	if (collector->direct_open()) { GTEST_SKIP() << "The files are opened on direct descriptors"; }
+
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	const auto dir = task_dir(mock_process);
+
+	const std::vector<prox::uring_request> requests = {
+		{ dir, -1, -1, -1 },
+	};
+
+	int taken = -1;
+	int left  = -1;
+
+	collector->collect(requests, [&](const std::size_t /*first*/, const auto results) {
+		ASSERT_TRUE(results[0].ok());
+		EXPECT_NE(results[0].stat_fd, -1);
+		EXPECT_NE(results[0].children_fd, -1);
+
+		taken = std::exchange(results[0].stat_fd, -1);
+		left  = results[0].children_fd;
+	});
+
+	// The descriptors that are not taken are closed
+	EXPECT_NE(::fcntl(taken, F_GETFD), -1);
+	EXPECT_EQ(::fcntl(left, F_GETFD), -1);
+
+	::close(taken);
+}
+
+TEST(Uring, CollectSeveralBatches)
+{
+	const auto collector = make_collector();
+	if (collector == nullptr) { GTEST_SKIP() << "io_uring is not available"; }
+
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	const auto dir = task_dir(mock_process);
+
+	const std::vector<prox::uring_request> requests(prox::uring_collector::BATCH_SIZE * 2 + 1, { dir, -1, -1, -1 });
+
+	std::size_t n_ok      = 0;
+	std::size_t n_batches = 0;
+
+	collector->collect(requests, [&](const std::size_t /*first*/, const auto results) {
+		++n_batches;
+		for (const auto & result : results)
+		{
+			if (result.ok()) { ++n_ok; }
+		}
+	});
+
+	EXPECT_EQ(n_batches, 3);
+	EXPECT_EQ(n_ok, requests.size());
+}
+
+TEST(Uring, ProcessTreeBackend)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree sync_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+	prox::process_tree uring_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	EXPECT_EQ(uring_tree.backend(), prox::collection_backend::synchronous);
+
+	if (uring_tree.backend(prox::collection_backend::io_uring) not_eq prox::collection_backend::io_uring)
+	{
+		GTEST_SKIP() << "io_uring is not available";
+	}
+
+	// Evicted descriptors are collected from their paths
+	uring_tree.max_open_fds(2);
+
+	sync_tree.update();
+	uring_tree.update();
+
+	ASSERT_EQ(uring_tree.size(), sync_tree.size());
+
+	for (const auto & proc : sync_tree.processes())
+	{
+		const auto other = uring_tree.get(proc.pid());
+		ASSERT_TRUE(other.has_value());
+
+		EXPECT_EQ(other.value()->ppid(), proc.ppid());
+		EXPECT_EQ(other.value()->processor(), proc.processor());
+		EXPECT_EQ(other.value()->stat_info().starttime, proc.stat_info().starttime);
+		EXPECT_EQ(other.value()->children(), proc.children());
+		EXPECT_EQ(other.value()->tasks(), proc.tasks());
+		EXPECT_EQ(other.value()->migratable(), proc.migratable());
+	}
+}
+
+TEST(Uring, ProcessTreeBackendOnProc)
+{
+	prox::process_tree tree;
+
+	if (tree.backend(prox::collection_backend::io_uring) not_eq prox::collection_backend::io_uring)
+	{
+		GTEST_SKIP() << "io_uring is not available";
+	}
+
+	EXPECT_NO_THROW(tree.update());
+	EXPECT_TRUE(tree.alive(::getpid()));
+	EXPECT_TRUE(tree.alive(1));
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,141 @@
+#include "prox/per_cpu_time.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	auto write_stat(const std::string & contents)
+	{
+		const auto path = std::filesystem::temp_directory_path() / "per_cpu_time_test.txt";
+
+		std::ofstream out(path);
+		out << contents;
+		out.close();
+
+		return path;
+	}
+} // namespace
+
+TEST(PerCPUTime, InitialValues)
+{
+	prox::per_CPU_time cpu_time;
+	EXPECT_EQ(cpu_time.size(), 0);
+	EXPECT_TRUE(cpu_time.cpus().empty());
+	EXPECT_THROW(static_cast<void>(cpu_time.cpu(0)), std::out_of_range);
+}
+
+TEST(PerCPUTime, Update)
+{
+	//                user nice system idle iowait irq softirq steal guest guest_nice
+	const auto path = write_stat("cpu  300 0 60 1000 40 0 0 10 0 0\n"
+	                             "cpu0 100 0 20 500 20 0 0 10 0 0\n"
+	                             "cpu1 200 0 40 500 20 0 0 0 0 0\n"
+	                             "intr 85874642 12 1334 0 0 0\n"
+	                             "ctxt 251528755\n");
+
+	prox::per_CPU_time cpu_time;
+	cpu_time.update(path);
+
+	ASSERT_EQ(cpu_time.size(), 2);
+	EXPECT_EQ(cpu_time.cpu(0).busy, 120);
+	EXPECT_EQ(cpu_time.cpu(0).idle, 520);
+	EXPECT_EQ(cpu_time.cpu(0).steal, 10);
+	EXPECT_EQ(cpu_time.cpu(1).busy, 240);
+	EXPECT_TRUE(cpu_time.cpu(1).online);
+
+	// The first deltas are the time since boot
+	EXPECT_EQ(cpu_time.cpu(0).busy_delta, 120);
+
+	// CPU 0 is idle and CPU 1 busy since the last update; CPU 2 comes online
+	write_stat("cpu  400 0 60 1100 40 0 0 10 0 0\n"
+	           "cpu0 100 0 20 600 20 0 0 10 0 0\n"
+	           "cpu1 280 0 40 500 20 0 10 0 0 0\n"
+	           "cpu2 20 0 0 0 0 0 0 0 0 0\n"
+	           "intr 85874642 12 1334 0 0 0\n");
+	cpu_time.update(path);
+
+	ASSERT_EQ(cpu_time.size(), 3);
+	EXPECT_EQ(cpu_time.cpu(0).busy_delta, 0);
+	EXPECT_EQ(cpu_time.cpu(0).idle_delta, 100);
+	EXPECT_FLOAT_EQ(cpu_time.cpu(0).busy_fraction(), 0.0F);
+	EXPECT_EQ(cpu_time.cpu(1).busy_delta, 90);
+	EXPECT_FLOAT_EQ(cpu_time.cpu(1).busy_fraction(), 1.0F);
+	EXPECT_EQ(cpu_time.cpu(2).busy_delta, 20);
+
+	// The aggregate line in the same read
+	prox::CPU_time total;
+	cpu_time.update(path, total);
+	EXPECT_EQ(total.user_time(), 400);
+	EXPECT_EQ(total.idle_time(), 1100);
+
+	// CPU 1 goes offline
+	write_stat("cpu  400 0 60 1100 40 0 0 10 0 0\n"
+	           "cpu0 100 0 20 600 20 0 0 10 0 0\n"
+	           "cpu2 20 0 0 0 0 0 0 0 0 0\n");
+	cpu_time.update(path);
+
+	EXPECT_TRUE(cpu_time.cpu(0).online);
+	EXPECT_FALSE(cpu_time.cpu(1).online);
+	EXPECT_TRUE(cpu_time.cpu(2).online);
+}
+
+TEST(PerCPUTime, ManyCPUs)
+{
+	// More CPU lines than the initial read buffer holds
+	static constexpr std::size_t N_CPUS = 1024;
+
+	std::string contents = "cpu  0 0 0 0 0 0 0 0 0 0\n";
+	for (std::size_t cpu = 0; cpu < N_CPUS; ++cpu)
+	{
+		const auto user = std::to_string(cpu);
+		contents += "cpu" + std::to_string(cpu) + " " + user + " 12345678 12345678 12345678 0 0 0 0 0 0\n";
+	}
+	contents += "intr 85874642 12 1334 0 0 0\n";
+
+	const auto path = write_stat(contents);
+
+	prox::per_CPU_time cpu_time;
+	cpu_time.update(path);
+
+	ASSERT_EQ(cpu_time.size(), N_CPUS);
+	EXPECT_EQ(cpu_time.cpu(N_CPUS - 1).busy, N_CPUS - 1 + 2 * 12345678);
+}
+
+TEST(PerCPUTime, UpdateWithNoFile)
+{
+	prox::per_CPU_time cpu_time;
+	EXPECT_THROW(cpu_time.update("/this/file/does/not/exist"), std::runtime_error);
+}
+
+TEST(PerCPUTime, UpdateWithInvalidFile)
+{
+	const auto path = write_stat("cpu  0 0 0 0 0 0 0 0 0 0\n"
+	                             "cpuX 1 2 3 4 5 6 7 8 9 10\n");
+
+	prox::per_CPU_time cpu_time;
+	EXPECT_THROW(cpu_time.update(path), std::runtime_error);
+
+	write_stat("cpu  0 0 0 0 0 0 0 0 0 0\n"
+	           "cpu0 1 2 3\n");
+	EXPECT_THROW(cpu_time.update(path), std::runtime_error);
+}
+
+TEST(PerCPUTime, UpdateSystem)
+{
+	prox::per_CPU_time cpu_time;
+	cpu_time.update();
+
+	EXPECT_GE(cpu_time.size(), 1);
+	EXPECT_TRUE(cpu_time.cpu(0).online);
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+#include "prox/pid_bitset.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+TEST(PidBitset, SetResetTest)
+{
+	prox::pid_bitset set(128);
+
+	EXPECT_EQ(set.size(), 128);
+	EXPECT_TRUE(set.empty());
+
+	set.set(0);
+	set.set(63);
+	set.set(64);
+	set.set(127);
+
+	EXPECT_TRUE(set.test(0));
+	EXPECT_TRUE(set.test(63));
+	EXPECT_TRUE(set.test(64));
+	EXPECT_TRUE(set.test(127));
+	EXPECT_FALSE(set.test(1));
+	EXPECT_FALSE(set.test(1000));
+	EXPECT_FALSE(set.test(-1));
+	EXPECT_EQ(set.count(), 4);
+
+	set.reset(63);
+	set.reset(1000); // Out of range: nothing to do
+	EXPECT_FALSE(set.test(63));
+	EXPECT_EQ(set.count(), 3);
+
+	set.set(-1); // Negative PIDs are ignored
+	EXPECT_EQ(set.count(), 3);
+}
+
+TEST(PidBitset, Grow)
+{
+	prox::pid_bitset set(64);
+
+	set.set(10'000);
+
+	EXPECT_GE(set.size(), 10'001);
+	EXPECT_TRUE(set.test(10'000));
+	EXPECT_EQ(set.count(), 1);
+}
+
+TEST(PidBitset, Clear)
+{
+	prox::pid_bitset set(4096);
+
+	set.set(1);
+	set.set(4000);
+	set.clear();
+
+	EXPECT_TRUE(set.empty());
+	EXPECT_FALSE(set.test(1));
+	EXPECT_FALSE(set.test(4000));
+	EXPECT_EQ(set.size(), 4096); // The memory is kept
+}
+
+TEST(PidBitset, ForEach)
+{
+	prox::pid_bitset set(1024);
+
+	const std::vector<pid_t> pids = { 1, 2, 63, 64, 65, 500, 1023 };
+	for (const auto pid : pids)
+	{
+		set.set(pid);
+	}
+
+	std::vector<pid_t> visited;
+	set.for_each([&](const pid_t pid) { visited.emplace_back(pid); });
+
+	EXPECT_EQ(visited, pids);
+}
+
+TEST(PidBitset, ForEachDifference)
+{
+	prox::pid_bitset old_pids(256);
+	prox::pid_bitset updated_pids(64); // Shorter than "old_pids"
+
+	for (const auto pid : { 3, 7, 64, 200 })
+	{
+		old_pids.set(pid);
+	}
+	for (const auto pid : { 3, 8, 64 })
+	{
+		updated_pids.set(pid);
+	}
+
+	std::vector<pid_t> removed;
+	prox::pid_bitset::for_each_difference(old_pids, updated_pids, [&](const pid_t pid) { removed.emplace_back(pid); });
+
+	EXPECT_EQ(removed, (std::vector<pid_t>{ 7, 200 }));
+}
+
+TEST(PidBitset, ReadPidMax)
+{
+	const auto tmp = std::filesystem::temp_directory_path() / "prox_pid_max";
+
+	std::ofstream(tmp) << "32768\n";
+	EXPECT_EQ(prox::read_pid_max(tmp.c_str()), 32768);
+
+	std::ofstream(tmp) << "garbage\n";
+	EXPECT_EQ(prox::read_pid_max(tmp.c_str()), prox::PID_MAX_LIMIT);
+
+	std::filesystem::remove(tmp);
+	EXPECT_EQ(prox::read_pid_max(tmp.c_str()), prox::PID_MAX_LIMIT);
+
+	EXPECT_GT(prox::read_pid_max(), 0);
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,177 @@
+#include "prox/proc_connector.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_connector.hpp"
+#include "mock_proc_dir.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	auto poll_all(prox::proc_connector & connector, bool & complete)
+	{
+		std::vector<prox::process_event> events;
+		complete = connector.poll([&](const prox::process_event & e) { events.emplace_back(e); });
+		return events;
+	}
+} // namespace
+
+TEST(ProcConnector, DecodesEvents)
+{
+	prox::Mock_proc_connector mock;
+
+	auto connector = mock.connector();
+
+	mock.fork(10, 11);
+	mock.fork(10, 12, 10); // Thread of 10
+	mock.exec(11);
+	mock.comm(11);
+	mock.uid(11); // Not reported
+	mock.exit(12);
+
+	bool       complete = false;
+	const auto events   = poll_all(connector, complete);
+
+	EXPECT_TRUE(complete);
+	ASSERT_EQ(events.size(), 5);
+
+	EXPECT_EQ(events[0].what, prox::process_event::kind::fork);
+	EXPECT_EQ(events[0].pid, 11);
+	EXPECT_EQ(events[0].tgid, 11);
+	EXPECT_EQ(events[0].parent_pid, 10);
+
+	EXPECT_EQ(events[1].what, prox::process_event::kind::fork);
+	EXPECT_EQ(events[1].pid, 12);
+	EXPECT_EQ(events[1].tgid, 10);
+
+	EXPECT_EQ(events[2].what, prox::process_event::kind::exec);
+	EXPECT_EQ(events[2].pid, 11);
+
+	EXPECT_EQ(events[3].what, prox::process_event::kind::comm);
+
+	EXPECT_EQ(events[4].what, prox::process_event::kind::exit);
+	EXPECT_EQ(events[4].pid, 12);
+
+	// Nothing else to read
+	EXPECT_TRUE(poll_all(connector, complete).empty());
+	EXPECT_TRUE(complete);
+}
+
+TEST(ProcConnector, ReportsLostEvents)
+{
+	prox::Mock_proc_connector mock;
+
+	auto connector = mock.connector();
+
+	mock.fork(10, 11);
+	mock.overrun();
+
+	bool complete = true;
+	EXPECT_EQ(poll_all(connector, complete).size(), 1);
+	EXPECT_FALSE(complete);
+
+	// Only once
+	std::ignore = poll_all(connector, complete);
+	EXPECT_TRUE(complete);
+}
+
+TEST(ProcConnector, KernelEvents)
+{
+	std::optional<prox::proc_connector> connector;
+
+	try
+	{
+		connector.emplace();
+	}
+	catch (const std::exception & e)
+	{
+		GTEST_SKIP() << "The proc connector is not available: " << e.what();
+	}
+
+	const auto child = ::fork();
+	if (child == 0) { ::_exit(0); }
+	ASSERT_GT(child, 0);
+	::waitpid(child, nullptr, 0);
+
+	bool forked = false;
+	bool exited = false;
+
+	for (int i = 0; i < 100 and not(forked and exited); ++i)
+	{
+		bool complete = false;
+		for (const auto & e : poll_all(*connector, complete))
+		{
+			if (e.pid not_eq child) { continue; }
+			forked = forked or e.what == prox::process_event::kind::fork;
+			exited = exited or e.what == prox::process_event::kind::exit;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	EXPECT_TRUE(forked);
+	EXPECT_TRUE(exited);
+}
+
+TEST(ProcConnector, EventDrivenProcessTree)
+{
+	prox::Mock_proc_dir       mock{};
+	prox::Mock_proc_connector events;
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	process_tree.watch_events(events.connector());
+	EXPECT_TRUE(process_tree.watching_events());
+
+	const auto add_process = [&](const pid_t pid) {
+		prox::process_stat proc;
+		proc.pid  = pid;
+		proc.path = mock.mock_proc_dir / std::to_string(pid);
+		proc.name = "new";
+		prox::write_mock_process_stat(proc);
+	};
+
+	// The first update scans the proc folder
+	add_process(6);
+	process_tree.update();
+	EXPECT_TRUE(process_tree.alive(6));
+
+	// Without events, new processes are not found...
+	add_process(7);
+	process_tree.update();
+	EXPECT_FALSE(process_tree.alive(7));
+
+	// ...until they are reported
+	events.fork(prox::Mock_proc_dir::PIDs::root, 7);
+	process_tree.update();
+	EXPECT_TRUE(process_tree.alive(7));
+
+	// Finished processes are removed right away
+	events.exit(6);
+	process_tree.update();
+	EXPECT_FALSE(process_tree.alive(6));
+	EXPECT_TRUE(process_tree.alive(7));
+
+	// Lost events: scan again
+	add_process(8);
+	events.overrun();
+	process_tree.update();
+	EXPECT_TRUE(process_tree.alive(8));
+	EXPECT_TRUE(process_tree.alive(6)); // Its folder is still there
+
+	process_tree.stop_watching_events();
+	EXPECT_FALSE(process_tree.watching_events());
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
@@ -110,6 +110,21 @@ TEST(ProcessTest, ParseInformationTrailingWhitespacesCmdline)
 	EXPECT_STREQ(process.cmdline().c_str(), original_name.c_str());
 }
 
+TEST(ProcessTest, UnreadableCmdlineIsEmpty)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	// E.g. a kernel thread, or a process that is exiting
+	std::filesystem::remove(mock_process.path / "cmdline");
+
+	auto cpu_time_ptr = prox::get_mock_cpu_time();
+
+	const prox::process process(mock_process.pid, mock_process.path, *cpu_time_ptr);
+
+	EXPECT_TRUE(process.cmdline().empty());
+}
+
 TEST(ProcessTest, AddNewChild)
 {
 	prox::process_stat mock_process;
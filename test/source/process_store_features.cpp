@@ -0,0 +1,154 @@
+#include "prox/process_store.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	// Minimal process for the store
+	struct fake_process
+	{
+		pid_t      pid_       = 0;
+		prox::stat stat_      = {};
+		float      cpu_use_   = 0.0F;
+		int        processor_ = 0;
+
+		[[nodiscard]] auto pid() const { return pid_; }
+		[[nodiscard]] auto ppid() const { return stat_.ppid; }
+		[[nodiscard]] auto processor() const { return processor_; }
+		[[nodiscard]] auto cpu_use() const { return cpu_use_; }
+		[[nodiscard]] auto lwp() const { return false; }
+		[[nodiscard]] auto st_uid() const -> uid_t { return 1000; }
+		[[nodiscard]] auto stat_info() const -> const auto & { return stat_; }
+	};
+
+	auto make_process(const pid_t pid, const float cpu_use)
+	{
+		fake_process proc{ pid };
+		proc.stat_.ppid  = pid - 1;
+		proc.stat_.state = 'R';
+		proc.stat_.utime = static_cast<prox::stat::luint>(pid) * 10;
+		proc.cpu_use_    = cpu_use;
+		proc.processor_  = pid % 4;
+		return proc;
+	}
+} // namespace
+
+TEST(ProcessStore, AssignAndFind)
+{
+	prox::process_store store;
+
+	store.assign(make_process(10, 1.0F));
+	store.assign(make_process(20, 2.0F));
+
+	EXPECT_EQ(store.size(), 2);
+	EXPECT_TRUE(store.contains(10));
+	EXPECT_FALSE(store.contains(15));
+	EXPECT_FALSE(store.contains(-1));
+	EXPECT_FALSE(store.contains(1'000'000));
+
+	const auto row = store.find(20);
+	ASSERT_TRUE(row.has_value());
+	EXPECT_EQ(row->pid(), 20);
+	EXPECT_EQ(row->ppid(), 19);
+	EXPECT_EQ(row->utime(), 200);
+	EXPECT_EQ(row->processor(), 0);
+	EXPECT_FLOAT_EQ(row->cpu_use(), 2.0F);
+	EXPECT_TRUE(row->running());
+
+	// Refresh in place
+	store.assign(make_process(20, 5.0F));
+	EXPECT_EQ(store.size(), 2);
+	EXPECT_FLOAT_EQ(store.find(20)->cpu_use(), 5.0F);
+}
+
+TEST(ProcessStore, EraseKeepsColumnsDense)
+{
+	prox::process_store store;
+
+	for (const pid_t pid : { 1, 2, 3, 4 })
+	{
+		store.assign(make_process(pid, static_cast<float>(pid)));
+	}
+
+	store.erase(2);
+	store.erase(42); // Not in the store
+
+	EXPECT_EQ(store.size(), 3);
+	EXPECT_FALSE(store.contains(2));
+
+	for (const pid_t pid : { 1, 3, 4 })
+	{
+		const auto row = store.find(pid);
+		ASSERT_TRUE(row.has_value());
+		EXPECT_EQ(row->pid(), pid);
+		EXPECT_FLOAT_EQ(row->cpu_use(), static_cast<float>(pid));
+	}
+
+	// Columns are contiguous and aligned by slot
+	for (std::size_t slot = 0; slot < store.size(); ++slot)
+	{
+		EXPECT_FLOAT_EQ(store.cpu_uses()[slot], static_cast<float>(store.pids()[slot]));
+	}
+
+	store.clear();
+	EXPECT_TRUE(store.empty());
+	EXPECT_FALSE(store.contains(1));
+}
+
+TEST(ProcessStore, FilterRows)
+{
+	prox::process_store store;
+
+	for (const pid_t pid : { 1, 2, 3, 4, 5 })
+	{
+		store.assign(make_process(pid, static_cast<float>(pid) * 10.0F));
+	}
+
+	std::vector<pid_t> heavy;
+	for (const auto & row : store.rows() | ranges::views::filter([](const auto & r) { return r.cpu_use() > 25.0F; }))
+	{
+		heavy.emplace_back(row.pid());
+	}
+	std::ranges::sort(heavy);
+
+	EXPECT_EQ(heavy, (std::vector<pid_t>{ 3, 4, 5 }));
+}
+
+TEST(ProcessStore, ProcessTreeColumns)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+	process_tree.update();
+
+	const auto & columns = process_tree.columns();
+
+	ASSERT_EQ(columns.size(), process_tree.size());
+
+	for (const auto & proc : process_tree.processes())
+	{
+		const auto row = columns.find(proc.pid());
+		ASSERT_TRUE(row.has_value());
+		EXPECT_EQ(row->ppid(), proc.ppid());
+		EXPECT_EQ(row->processor(), proc.processor());
+		EXPECT_EQ(row->utime(), proc.stat_info().utime);
+		EXPECT_FLOAT_EQ(row->cpu_use(), proc.cpu_use());
+	}
+
+	process_tree.erase(prox::Mock_proc_dir::PIDs::child2);
+	EXPECT_FALSE(columns.contains(prox::Mock_proc_dir::PIDs::child2));
+	EXPECT_EQ(columns.size(), process_tree.size());
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
@@ -1,3 +1,16 @@
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "utils.hpp"
@@ -19,6 +32,38 @@ TEST(ProcessTree, InitialiseMockProc)
 	EXPECT_NO_THROW(prox::process_tree(1, mock.mock_proc_dir));
 }
 
+TEST(ProcessTree, IsMovable)
+{
+	prox::Mock_proc_dir mock{};
+
+	const auto root = prox::Mock_proc_dir::PIDs::root;
+
+	std::optional<prox::process_tree> moved_from;
+	moved_from.emplace(root, mock.mock_proc_dir);
+	const auto size = moved_from->size();
+
+	// The processes follow the fd cache, the CPU time and the topology of the new tree
+	std::optional<prox::process_tree> process_tree;
+	process_tree.emplace(std::move(*moved_from));
+	moved_from.reset();
+
+	EXPECT_EQ(process_tree->find(root).topology(), &process_tree->topology());
+	EXPECT_NO_THROW(process_tree->update());
+	EXPECT_EQ(process_tree->size(), size);
+	EXPECT_GT(process_tree->open_fds(), 0);
+
+	// Same by assignment
+	prox::process_tree assigned{ prox::Mock_proc_dir::PIDs::child1, mock.mock_proc_dir };
+	assigned = std::move(*process_tree);
+	process_tree.reset();
+
+	EXPECT_EQ(assigned.root(), root);
+	EXPECT_EQ(assigned.find(root).topology(), &assigned.topology());
+	EXPECT_NO_THROW(assigned.update());
+	EXPECT_EQ(assigned.size(), size);
+	EXPECT_GT(assigned.open_fds(), 0);
+}
+
 TEST(ProcessTree, InitialiseWithNonExistentProc)
 {
 	EXPECT_THROW(prox::process_tree(1, "/proc/does/not/exist"), std::runtime_error);
@@ -88,6 +133,470 @@ TEST(ProcessTree, ProcessInformation)
 	EXPECT_TRUE(utils::equivalent_rngs(tasks, expected_tasks));
 }
 
+TEST(ProcessTree, CpuOnlyTree)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::cpu_process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	const auto root_opt = process_tree.get(prox::Mock_proc_dir::PIDs::root);
+	ASSERT_TRUE(root_opt.has_value());
+
+	const auto & root_proc = *root_opt.value();
+
+	prox::process_stat defaults;
+
+	EXPECT_EQ(root_proc.pid(), prox::Mock_proc_dir::PIDs::root);
+	EXPECT_EQ(root_proc.ppid(), defaults.ppid);
+	EXPECT_EQ(root_proc.processor(), defaults.processor);
+	EXPECT_EQ(root_proc.stat_info().utime, defaults.utime);
+
+	// Not requested, so not parsed
+	EXPECT_TRUE(root_proc.stat_info().comm.empty());
+	EXPECT_EQ(root_proc.stat_info().vsize, prox::stat::luint{});
+}
+
+TEST(ProcessTree, KeepsDescriptorsOpenAcrossUpdates)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	const auto open_fds = process_tree.open_fds();
+	EXPECT_GT(open_fds, 0);
+
+	process_tree.update();
+	EXPECT_EQ(process_tree.open_fds(), open_fds);
+
+	// Erasing a process closes its descriptors
+	process_tree.erase(prox::Mock_proc_dir::PIDs::child1);
+	EXPECT_LT(process_tree.open_fds(), open_fds);
+
+	// The cap is honoured
+	process_tree.max_open_fds(1);
+	EXPECT_LE(process_tree.open_fds(), 1);
+
+	process_tree.update();
+	EXPECT_LE(process_tree.open_fds(), 1);
+	EXPECT_TRUE(process_tree.alive(prox::Mock_proc_dir::PIDs::child1));
+}
+
+TEST(ProcessTree, StaleHandles)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	const auto child_opt = process_tree.get(prox::Mock_proc_dir::PIDs::child1);
+	ASSERT_TRUE(child_opt.has_value());
+
+	const auto old_handle = child_opt.value();
+	EXPECT_EQ(old_handle->pid(), prox::Mock_proc_dir::PIDs::child1);
+
+	// The PID is reused by a new process
+	process_tree.erase(prox::Mock_proc_dir::PIDs::child1);
+	EXPECT_FALSE(old_handle.valid());
+
+	const auto new_handle = process_tree.insert(prox::Mock_proc_dir::PIDs::child1);
+	EXPECT_TRUE(new_handle.valid());
+	EXPECT_FALSE(old_handle.valid());
+	EXPECT_EQ(old_handle.get(), nullptr);
+	EXPECT_EQ(new_handle->pid(), prox::Mock_proc_dir::PIDs::child1);
+}
+
+TEST(ProcessTree, LooksProcessesUpAfterErase)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// Erasing a row moves the last one into its slot: the lookups must follow it
+	process_tree.erase(prox::Mock_proc_dir::PIDs::task1);
+	EXPECT_FALSE(process_tree.alive(prox::Mock_proc_dir::PIDs::task1));
+	EXPECT_FALSE(std::as_const(process_tree).get(prox::Mock_proc_dir::PIDs::task1).has_value());
+	EXPECT_THROW(std::ignore = process_tree.find(prox::Mock_proc_dir::PIDs::task1), std::runtime_error);
+
+	for (const auto pid : { prox::Mock_proc_dir::PIDs::root, prox::Mock_proc_dir::PIDs::task2,
+	                        prox::Mock_proc_dir::PIDs::child1, prox::Mock_proc_dir::PIDs::child2 })
+	{
+		EXPECT_TRUE(process_tree.alive(pid));
+		EXPECT_EQ(process_tree.find(pid).pid(), pid);
+		EXPECT_EQ(process_tree.columns().find(pid)->pid(), pid);
+	}
+
+	EXPECT_EQ(process_tree.size(), process_tree.columns().size());
+
+	// The iteration follows the rows, before and after an update
+	for (int i = 0; i < 2; ++i)
+	{
+		std::vector<pid_t> pids;
+		for (const auto & proc : process_tree)
+		{
+			pids.emplace_back(proc.pid());
+		}
+
+		const auto rows = process_tree.columns().pids();
+		EXPECT_EQ(pids, std::vector<pid_t>(rows.begin(), rows.end()));
+
+		process_tree.update();
+	}
+}
+
+TEST(ProcessTree, SubtreeScope)
+{
+	prox::Mock_proc_dir mock{};
+
+	// A process that does not descend from the root
+	prox::process_stat other;
+	other.pid  = 6;
+	other.path = mock.mock_proc_dir / "6";
+	other.name = "other";
+	prox::write_mock_process_stat(other);
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::child1, mock.mock_proc_dir,
+	                                 prox::tree_scope::subtree };
+
+	EXPECT_EQ(process_tree.scope(), prox::tree_scope::subtree);
+	EXPECT_EQ(process_tree.size(), 1);
+	EXPECT_TRUE(process_tree.alive(prox::Mock_proc_dir::PIDs::child1));
+
+	// The whole mock tree, but not the unrelated process
+	process_tree.root(prox::Mock_proc_dir::PIDs::root);
+	process_tree.update();
+
+	EXPECT_EQ(process_tree.size(), 5);
+	EXPECT_FALSE(process_tree.alive(6));
+
+	// New descendants are found through the children of their parent
+	prox::process_stat root;
+	root.pid      = prox::Mock_proc_dir::PIDs::root;
+	root.path     = mock.mock_proc_dir / std::to_string(root.pid);
+	root.name     = "root";
+	root.children = { prox::Mock_proc_dir::PIDs::child1, prox::Mock_proc_dir::PIDs::child2, 6 };
+	prox::write_mock_process_stat(root);
+
+	process_tree.update();
+	EXPECT_TRUE(process_tree.alive(6));
+
+	// ...and dropped when they are not descendants anymore
+	root.children = { prox::Mock_proc_dir::PIDs::child1, prox::Mock_proc_dir::PIDs::child2 };
+	prox::write_mock_process_stat(root);
+
+	process_tree.update();
+	EXPECT_FALSE(process_tree.alive(6));
+
+	// Back to the whole system
+	process_tree.scope(prox::tree_scope::system);
+	process_tree.update();
+	EXPECT_TRUE(process_tree.alive(6));
+}
+
+TEST(ProcessTree, SubtreeScopeReadsNoStatOutsideIt)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::child1, mock.mock_proc_dir,
+	                                 prox::tree_scope::subtree };
+
+	// Count the reads of the stat files of the processes outside the subtree of child1
+	const int inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	ASSERT_NE(inotify_fd, -1);
+
+	for (const auto & [pid, tid] : { std::pair{ 1, 1 }, std::pair{ 1, 2 }, std::pair{ 1, 3 }, std::pair{ 5, 5 } })
+	{
+		const auto stat_path =
+		    mock.mock_proc_dir / std::to_string(pid) / "task" / std::to_string(tid) / "stat";
+		ASSERT_NE(::inotify_add_watch(inotify_fd, stat_path.c_str(), IN_OPEN | IN_ACCESS), -1);
+	}
+
+	const auto stat_reads = [&]() {
+		std::size_t n_events = 0;
+
+		alignas(inotify_event) std::array<char, 4096> buffer{};
+		for (ssize_t n = 0; (n = ::read(inotify_fd, buffer.data(), buffer.size())) > 0;)
+		{
+			for (ssize_t i = 0; i < n; ++n_events)
+			{
+				const auto * event = reinterpret_cast<const inotify_event *>(buffer.data() + i);
+				i += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+			}
+		}
+
+		return n_events;
+	};
+
+	for (const auto hierarchy : { prox::hierarchy_source::children_files, prox::hierarchy_source::ppid })
+	{
+		process_tree.hierarchy(hierarchy);
+		process_tree.update();
+		process_tree.update();
+
+		EXPECT_EQ(process_tree.size(), 1);
+		EXPECT_EQ(stat_reads(), 0);
+	}
+
+	// The whole system reads them all
+	process_tree.scope(prox::tree_scope::system);
+	process_tree.update();
+	EXPECT_GT(stat_reads(), 0);
+
+	::close(inotify_fd);
+}
+
+TEST(ProcessTree, LinksChildrenThroughTheirParent)
+{
+	prox::Mock_proc_dir mock{};
+
+	// Child of child1 that its children file does not list (e.g. forked by another thread)
+	prox::process_stat unlisted;
+	unlisted.pid  = 6;
+	unlisted.ppid = prox::Mock_proc_dir::PIDs::child1;
+	unlisted.pgrp = 6; // Not a LWP
+	unlisted.path = mock.mock_proc_dir / "6";
+	unlisted.name = "unlisted";
+	prox::write_mock_process_stat(unlisted);
+
+	// Child of child1 that is listed already
+	prox::process_stat listed;
+	listed.pid  = 7;
+	listed.ppid = prox::Mock_proc_dir::PIDs::child1;
+	listed.pgrp = 7;
+	listed.path = mock.mock_proc_dir / "7";
+	listed.name = "listed";
+	prox::write_mock_process_stat(listed);
+
+	prox::process_stat child1;
+	child1.pid      = prox::Mock_proc_dir::PIDs::child1;
+	child1.path     = mock.mock_proc_dir / std::to_string(child1.pid);
+	child1.name     = "child1";
+	child1.children = { 7 };
+	prox::write_mock_process_stat(child1);
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	for ([[maybe_unused]] const auto i : { 1, 2 })
+	{
+		const auto parent_opt = process_tree.get(prox::Mock_proc_dir::PIDs::child1);
+		ASSERT_TRUE(parent_opt.has_value());
+
+		// Each child once, whatever the number of updates
+		auto children = std::vector<pid_t>(parent_opt.value()->children_pids().begin(),
+		                                   parent_opt.value()->children_pids().end());
+		std::sort(children.begin(), children.end());
+		EXPECT_EQ(children, (std::vector<pid_t>{ 6, 7 }));
+
+		process_tree.update();
+	}
+}
+
+TEST(ProcessTree, HierarchyFromPpid)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_stat grandchild;
+	grandchild.pid  = 6;
+	grandchild.ppid = prox::Mock_proc_dir::PIDs::child1;
+	grandchild.pgrp = 6; // Not a LWP
+	grandchild.path = mock.mock_proc_dir / "6";
+	grandchild.name = "grandchild";
+	prox::write_mock_process_stat(grandchild);
+
+	// The children file of child1 lists a process that does not exist, so it shows whether the file is read
+	prox::process_stat child1;
+	child1.pid      = prox::Mock_proc_dir::PIDs::child1;
+	child1.path     = mock.mock_proc_dir / std::to_string(child1.pid);
+	child1.name     = "child1";
+	child1.children = { 99 };
+	prox::write_mock_process_stat(child1);
+
+	const auto children_of = [](const auto & tree, const pid_t pid) {
+		const auto proc_opt = tree.get(pid);
+		EXPECT_TRUE(proc_opt.has_value());
+		auto children = std::vector<pid_t>(proc_opt.value()->children_pids().begin(),
+		                                   proc_opt.value()->children_pids().end());
+		std::sort(children.begin(), children.end());
+		return children;
+	};
+
+	for (const auto backend : { prox::collection_backend::synchronous, prox::collection_backend::io_uring,
+	                            prox::collection_backend::parallel })
+	{
+		prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+		if (process_tree.backend(backend) not_eq backend) { continue; }
+
+		EXPECT_EQ(process_tree.hierarchy(), prox::hierarchy_source::children_files);
+		EXPECT_EQ(children_of(process_tree, prox::Mock_proc_dir::PIDs::child1), (std::vector<pid_t>{ 6, 99 }));
+
+		process_tree.hierarchy(prox::hierarchy_source::ppid);
+		process_tree.update(); // Processes already in the tree
+		process_tree.update(); // ...and in the next update
+
+		EXPECT_EQ(process_tree.size(), 6);
+		EXPECT_EQ(children_of(process_tree, prox::Mock_proc_dir::PIDs::child1), (std::vector<pid_t>{ 6 }));
+		EXPECT_TRUE(process_tree.alive(prox::Mock_proc_dir::PIDs::task1));
+
+		// New processes (built after the change) do not read the file either
+		process_tree.erase(prox::Mock_proc_dir::PIDs::child1);
+		process_tree.update();
+		EXPECT_EQ(children_of(process_tree, prox::Mock_proc_dir::PIDs::child1), (std::vector<pid_t>{ 6 }));
+
+		// In subtree scope, the descendants are found through the children files all the same: a process that only
+		// the children file of child1 lists (its ppid says otherwise) is found
+		prox::process_stat listed;
+		listed.pid  = 7;
+		listed.ppid = prox::Mock_proc_dir::PIDs::root;
+		listed.pgrp = 7;
+		listed.path = mock.mock_proc_dir / "7";
+		listed.name = "listed";
+		prox::write_mock_process_stat(listed);
+
+		child1.children = { 6, 7 };
+		prox::write_mock_process_stat(child1);
+
+		process_tree.root(prox::Mock_proc_dir::PIDs::child1);
+		process_tree.scope(prox::tree_scope::subtree);
+		process_tree.update();
+		EXPECT_EQ(process_tree.size(), 3);
+		EXPECT_TRUE(process_tree.alive(6));
+		EXPECT_TRUE(process_tree.alive(7));
+		EXPECT_FALSE(process_tree.alive(prox::Mock_proc_dir::PIDs::child2));
+
+		child1.children = { 99 };
+		prox::write_mock_process_stat(child1);
+		std::filesystem::remove_all(listed.path);
+	}
+}
+
+TEST(ProcessTree, SubtreeAggregates)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_stat grandchild;
+	grandchild.pid  = 6;
+	grandchild.path = mock.mock_proc_dir / "6";
+	grandchild.name = "grandchild";
+	grandchild.rss  = 1000;
+	prox::write_mock_process_stat(grandchild);
+
+	prox::process_stat child1;
+	child1.pid      = prox::Mock_proc_dir::PIDs::child1;
+	child1.path     = mock.mock_proc_dir / std::to_string(child1.pid);
+	child1.name     = "child1";
+	child1.children = { grandchild.pid };
+	prox::write_mock_process_stat(child1);
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	EXPECT_THROW(static_cast<void>(process_tree.subtree(prox::Mock_proc_dir::PIDs::root)), std::runtime_error);
+
+	// Aggregated right away
+	process_tree.aggregate_subtrees(true);
+	EXPECT_FALSE(process_tree.subtree(99).has_value());
+
+	const auto rss    = prox::process_stat{}.rss;
+	const auto majflt = prox::process_stat{}.majflt;
+
+	const auto child1_totals = process_tree.subtree(prox::Mock_proc_dir::PIDs::child1);
+	ASSERT_TRUE(child1_totals.has_value());
+	EXPECT_EQ(child1_totals->processes, 2);
+	EXPECT_EQ(child1_totals->threads, 2);
+	EXPECT_EQ(child1_totals->rss, rss + 1000);
+
+	// The tasks add their threads, CPU use and faults, but share the memory of their process
+	const auto cpu_use = [&](const pid_t pid) { return process_tree.get(pid).value()->cpu_use(); };
+
+	const auto root_totals = process_tree.subtree(prox::Mock_proc_dir::PIDs::root);
+	ASSERT_TRUE(root_totals.has_value());
+	EXPECT_EQ(root_totals->processes, 4);
+	EXPECT_EQ(root_totals->threads, 6);
+	EXPECT_EQ(root_totals->rss, 3 * rss + 1000);
+	EXPECT_EQ(root_totals->majflt, 6 * majflt);
+	EXPECT_DOUBLE_EQ(root_totals->cpu_use,
+	                 cpu_use(prox::Mock_proc_dir::PIDs::root) + cpu_use(prox::Mock_proc_dir::PIDs::task1) +
+	                     cpu_use(prox::Mock_proc_dir::PIDs::task2) + cpu_use(prox::Mock_proc_dir::PIDs::child1) +
+	                     cpu_use(prox::Mock_proc_dir::PIDs::child2) + cpu_use(grandchild.pid));
+
+	// Kept up to date by the updates
+	std::filesystem::remove_all(grandchild.path);
+	process_tree.update();
+
+	EXPECT_EQ(process_tree.subtree(prox::Mock_proc_dir::PIDs::root)->processes, 3);
+	EXPECT_EQ(process_tree.subtree(prox::Mock_proc_dir::PIDs::child1)->rss, rss);
+
+	// And by erase() and insert()
+	process_tree.erase(prox::Mock_proc_dir::PIDs::child2);
+	EXPECT_FALSE(process_tree.subtree(prox::Mock_proc_dir::PIDs::child2).has_value());
+	EXPECT_EQ(process_tree.subtree(prox::Mock_proc_dir::PIDs::root)->processes, 2);
+	EXPECT_EQ(process_tree.subtree(prox::Mock_proc_dir::PIDs::root)->threads, 4);
+
+	process_tree.insert(prox::Mock_proc_dir::PIDs::child2);
+	EXPECT_EQ(process_tree.subtree(prox::Mock_proc_dir::PIDs::child2)->processes, 1);
+	EXPECT_EQ(process_tree.subtree(prox::Mock_proc_dir::PIDs::root)->processes, 3);
+
+	process_tree.aggregate_subtrees(false);
+	EXPECT_THROW(static_cast<void>(process_tree.subtree(prox::Mock_proc_dir::PIDs::root)), std::runtime_error);
+}
+
+TEST(ProcessTree, CpuOnlyTreeSubtreeAggregates)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::cpu_process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// The RSS and the major faults are not parsed: their totals would always be 0
+	EXPECT_THROW(process_tree.aggregate_subtrees(true), std::runtime_error);
+	EXPECT_FALSE(process_tree.aggregated());
+	EXPECT_NO_THROW(process_tree.aggregate_subtrees(false));
+}
+
+TEST(ProcessTree, Descendants)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_stat grandchild;
+	grandchild.pid  = 6;
+	grandchild.path = mock.mock_proc_dir / "6";
+	grandchild.name = "grandchild";
+	prox::write_mock_process_stat(grandchild);
+
+	prox::process_stat child1;
+	child1.pid      = prox::Mock_proc_dir::PIDs::child1;
+	child1.path     = mock.mock_proc_dir / std::to_string(child1.pid);
+	child1.name     = "child1";
+	child1.children = { grandchild.pid };
+	prox::write_mock_process_stat(child1);
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	const auto sorted = [](const std::span<const pid_t> pids) {
+		auto v = std::vector<pid_t>(pids.begin(), pids.end());
+		std::sort(v.begin(), v.end());
+		return v;
+	};
+
+	EXPECT_EQ(sorted(process_tree.descendants(prox::Mock_proc_dir::PIDs::root)), (std::vector<pid_t>{ 2, 3, 4, 5, 6 }));
+	EXPECT_EQ(sorted(process_tree.descendants(prox::Mock_proc_dir::PIDs::child1)), (std::vector<pid_t>{ 6 }));
+	EXPECT_TRUE(process_tree.descendants(99).empty());
+
+	EXPECT_TRUE(process_tree.is_descendant(6, prox::Mock_proc_dir::PIDs::root));
+	EXPECT_TRUE(process_tree.is_descendant(prox::Mock_proc_dir::PIDs::task1, prox::Mock_proc_dir::PIDs::root));
+	EXPECT_FALSE(process_tree.is_descendant(6, prox::Mock_proc_dir::PIDs::child2));
+	EXPECT_FALSE(process_tree.is_descendant(prox::Mock_proc_dir::PIDs::root, prox::Mock_proc_dir::PIDs::root));
+	EXPECT_FALSE(process_tree.is_descendant(prox::Mock_proc_dir::PIDs::root, 6));
+
+	EXPECT_EQ(process_tree.all_children_of(prox::Mock_proc_dir::PIDs::root), (std::set<pid_t>{ 2, 3, 4, 5, 6 }));
+
+	// Erased processes leave the tour
+	process_tree.erase(6);
+	EXPECT_FALSE(process_tree.is_descendant(6, prox::Mock_proc_dir::PIDs::root));
+	EXPECT_TRUE(process_tree.descendants(prox::Mock_proc_dir::PIDs::child1).empty());
+
+	// ...and updated ones come back
+	process_tree.update();
+	EXPECT_TRUE(process_tree.is_descendant(6, prox::Mock_proc_dir::PIDs::child1));
+}
+
 auto main() -> int
 {
 	::testing::InitGoogleTest();
@@ -0,0 +1,270 @@
+#include "prox/schedstat.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_cpu_time.hpp"
+#include "mock_proc_dir.hpp"
+#include "mock_process.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	// Folder with the stat file of a mock process (see write_mock_process_stat)
+	auto task_folder(const prox::process_stat & process) -> std::filesystem::path
+	{
+		return process.path / "task" / std::to_string(process.pid);
+	}
+
+	// Folder with the stat file of a process of Mock_proc_dir
+	auto task_folder(const prox::Mock_proc_dir & mock, const pid_t pid) -> std::filesystem::path
+	{
+		using PIDs = prox::Mock_proc_dir::PIDs;
+
+		const bool is_task = pid == PIDs::task1 or pid == PIDs::task2;
+		const auto owner   = is_task ? PIDs::root : pid;
+		return mock.mock_proc_dir / std::to_string(owner) / "task" / std::to_string(pid);
+	}
+
+	void write_schedstat(const std::filesystem::path & folder, const prox::sched_times & times)
+	{
+		std::ofstream out(folder / "schedstat");
+		out << times.run_ns << " " << times.wait_ns << " " << times.timeslices << std::endl;
+	}
+} // namespace
+
+TEST(Schedstat, Parse)
+{
+	const auto times = prox::parse_schedstat("714615 71116 2\n");
+	EXPECT_EQ(times.run_ns, 714615);
+	EXPECT_EQ(times.wait_ns, 71116);
+	EXPECT_EQ(times.timeslices, 2);
+
+	// Without the trailing newline
+	EXPECT_EQ(prox::parse_schedstat("1 2 3").timeslices, 3);
+
+	EXPECT_THROW(static_cast<void>(prox::parse_schedstat("")), std::runtime_error);
+	EXPECT_THROW(static_cast<void>(prox::parse_schedstat("1 2\n")), std::runtime_error);
+	EXPECT_THROW(static_cast<void>(prox::parse_schedstat("1 2 3 4\n")), std::runtime_error);
+	EXPECT_THROW(static_cast<void>(prox::parse_schedstat("1 x 3\n")), std::runtime_error);
+}
+
+TEST(Schedstat, Usage)
+{
+	prox::sched_usage usage;
+
+	// The first sample has no period
+	usage.sample({ 1'000, 0, 1 }, 1'000'000);
+	EXPECT_EQ(usage.period_ns(), 0);
+	EXPECT_EQ(usage.cpu_use(), 0.0F);
+
+	// Half of the period running, a quarter waiting, over 4 timeslices
+	usage.sample({ 501'000, 250'000, 5 }, 2'000'000);
+	EXPECT_EQ(usage.period_ns(), 1'000'000);
+	EXPECT_EQ(usage.run_delta_ns(), 500'000);
+	EXPECT_FLOAT_EQ(usage.cpu_use(), 50.0F);
+	EXPECT_FLOAT_EQ(usage.run_queue_delay(), 25.0F);
+	EXPECT_EQ(usage.wait_per_timeslice_ns(), 62'500);
+
+	// Clamped to one CPU
+	usage.sample({ 3'000'000, 250'000, 5 }, 3'000'000);
+	EXPECT_FLOAT_EQ(usage.cpu_use(), 100.0F);
+	EXPECT_EQ(usage.wait_per_timeslice_ns(), 0);
+
+	// Counters that go back (a reused PID) do not underflow
+	usage.sample({ 10, 10, 1 }, 4'000'000);
+	EXPECT_EQ(usage.run_delta_ns(), 0);
+	EXPECT_EQ(usage.wait_delta_ns(), 0);
+}
+
+TEST(Schedstat, MockProcess)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+	std::filesystem::remove(task_folder(mock_process) / "schedstat");
+
+	auto cpu_time_ptr = prox::get_mock_cpu_time();
+
+	prox::process process(mock_process.pid, mock_process.path, *cpu_time_ptr);
+
+	// Not tracked by default
+	EXPECT_FALSE(process.tracks_schedstat());
+
+	// Tracking a task without a schedstat file fails
+	EXPECT_THROW(process.track_schedstat(true), std::runtime_error);
+
+	write_schedstat(task_folder(mock_process), { 1'000'000, 10'000, 10 });
+	process.track_schedstat(true);
+	EXPECT_EQ(process.schedstat().times().run_ns, 1'000'000);
+	EXPECT_EQ(process.schedstat().run_delta_ns(), 0);
+
+	write_schedstat(task_folder(mock_process), { 3'000'000, 30'000, 20 });
+	process.update();
+	EXPECT_EQ(process.schedstat().run_delta_ns(), 2'000'000);
+	EXPECT_EQ(process.schedstat().wait_delta_ns(), 20'000);
+	EXPECT_EQ(process.schedstat().timeslices_delta(), 10);
+	EXPECT_GT(process.schedstat().period_ns(), 0);
+	EXPECT_GE(process.schedstat().cpu_use(), 0.0F);
+	EXPECT_LE(process.schedstat().cpu_use(), 100.0F);
+
+	// Not read anymore
+	process.track_schedstat(false);
+	write_schedstat(task_folder(mock_process), { 9'000'000, 30'000, 20 });
+	process.update();
+	EXPECT_EQ(process.schedstat().times().run_ns, 0);
+}
+
+TEST(Schedstat, ThisProcess)
+{
+	auto cpu_time_ptr = prox::get_mock_cpu_time();
+
+	const auto pid  = ::getpid();
+	const auto path = std::filesystem::path("/proc") / std::to_string(pid);
+
+	prox::process process(pid, path, *cpu_time_ptr);
+	process.track_schedstat(true);
+
+	// Keep a CPU busy for a while
+	const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+	while (std::chrono::steady_clock::now() < until) {}
+
+	process.update();
+	EXPECT_GT(process.schedstat().run_delta_ns(), 0);
+	EXPECT_GT(process.schedstat().cpu_use(), 0.0F);
+}
+
+TEST(Schedstat, ProcessTree)
+{
+	prox::Mock_proc_dir mock{};
+
+	using PIDs = prox::Mock_proc_dir::PIDs;
+
+	for (const auto pid : { PIDs::root, PIDs::task1, PIDs::task2, PIDs::child1, PIDs::child2 })
+	{
+		write_schedstat(task_folder(mock, pid), { 1'000, 0, 1 });
+	}
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	EXPECT_FALSE(process_tree.tracks_schedstat());
+
+	process_tree.track_schedstat(true);
+	EXPECT_TRUE(process_tree.tracks_schedstat());
+
+	write_schedstat(task_folder(mock, PIDs::child1), { 5'000, 2'000, 3 });
+	process_tree.update();
+
+	for (const auto & proc : process_tree)
+	{
+		EXPECT_TRUE(proc.tracks_schedstat());
+	}
+
+	const auto child1 = process_tree.get(PIDs::child1);
+	ASSERT_TRUE(child1.has_value());
+	EXPECT_EQ((*child1)->schedstat().run_delta_ns(), 4'000);
+	EXPECT_EQ((*child1)->schedstat().wait_delta_ns(), 2'000);
+
+	process_tree.track_schedstat(false);
+	EXPECT_FALSE((*child1)->tracks_schedstat());
+}
+
+TEST(Schedstat, ProcessTreeParallel)
+{
+	prox::Mock_proc_dir mock{};
+
+	using PIDs = prox::Mock_proc_dir::PIDs;
+
+	for (const auto pid : { PIDs::root, PIDs::task1, PIDs::task2, PIDs::child1, PIDs::child2 })
+	{
+		write_schedstat(task_folder(mock, pid), { 1'000, 0, 1 });
+	}
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	process_tree.workers(4);
+	ASSERT_EQ(process_tree.backend(prox::collection_backend::parallel), prox::collection_backend::parallel);
+
+	// The workers read the schedstat files themselves, and hand the new descriptors to the tree
+	process_tree.track_schedstat(true);
+
+	write_schedstat(task_folder(mock, PIDs::child1), { 5'000, 2'000, 3 });
+	process_tree.update();
+
+	write_schedstat(task_folder(mock, PIDs::child1), { 6'000, 2'500, 4 });
+	process_tree.update();
+
+	const auto child1 = process_tree.get(PIDs::child1);
+	ASSERT_TRUE(child1.has_value());
+	EXPECT_EQ((*child1)->schedstat().run_delta_ns(), 1'000);
+	EXPECT_EQ((*child1)->schedstat().wait_delta_ns(), 500);
+}
+
+TEST(Schedstat, ProcessTreeBackendsAgree)
+{
+	prox::Mock_proc_dir mock{};
+
+	using PIDs = prox::Mock_proc_dir::PIDs;
+
+	// What the tree knows of every process, in PID order
+	using rows_t = std::vector<std::tuple<pid_t, pid_t, char, int, std::set<pid_t>, std::set<pid_t>, std::string,
+	                                      std::uint64_t, std::uint64_t, std::uint64_t>>;
+
+	const auto contents = [](const prox::process_tree & tree) {
+		rows_t rows;
+		for (const auto & proc : tree.processes())
+		{
+			rows.emplace_back(proc.pid(), proc.ppid(), proc.stat_info().state, proc.processor(), proc.children(),
+			                  proc.tasks(), proc.cmdline(), proc.schedstat().times().run_ns,
+			                  proc.schedstat().times().wait_ns, proc.schedstat().run_delta_ns());
+		}
+		return rows;
+	};
+
+	for (const auto pid : { PIDs::root, PIDs::task1, PIDs::task2, PIDs::child1, PIDs::child2 })
+	{
+		write_schedstat(task_folder(mock, pid), { 1'000, 0, 1 });
+	}
+
+	std::optional<rows_t> expected;
+
+	for (const auto backend : { prox::collection_backend::synchronous, prox::collection_backend::io_uring,
+	                            prox::collection_backend::parallel })
+	{
+		write_schedstat(task_folder(mock, PIDs::child1), { 1'000, 0, 1 });
+
+		prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+		if (process_tree.backend(backend) not_eq backend) { continue; }
+
+		process_tree.track_schedstat(true);
+		process_tree.update();
+
+		// The schedstat files are read on every update, whatever the backend
+		write_schedstat(task_folder(mock, PIDs::child1), { 5'000, 2'000, 3 });
+		process_tree.update();
+
+		const auto rows = contents(process_tree);
+		EXPECT_EQ(rows.size(), 5);
+
+		if (not expected.has_value()) { expected = rows; }
+		else { EXPECT_EQ(rows, *expected) << "backend " << static_cast<int>(backend); }
+	}
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
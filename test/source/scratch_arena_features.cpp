@@ -0,0 +1,121 @@
+#include "prox/scratch_arena.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+
+#include "prox/prox.hpp"
+
+// Count the allocations of the whole test program
+namespace
+{
+	std::atomic<std::size_t> allocations{ 0 };
+
+	// Number of heap allocations made by "fn"
+	template<typename Fn>
+	auto count_allocations(Fn && fn) -> std::size_t
+	{
+		const auto before = allocations.load();
+		fn();
+		return allocations.load() - before;
+	}
+} // namespace
+
+auto operator new(const std::size_t size) -> void *
+{
+	++allocations;
+	if (void * ptr = std::malloc(size == 0 ? 1 : size); ptr not_eq nullptr) { return ptr; }
+	throw std::bad_alloc();
+}
+
+auto operator new[](const std::size_t size) -> void * { return ::operator new(size); }
+
+auto operator new(const std::size_t size, const std::align_val_t alignment) -> void *
+{
+	++allocations;
+	const auto align = static_cast<std::size_t>(alignment);
+	if (void * ptr = std::aligned_alloc(align, (size + align - 1) / align * align); ptr not_eq nullptr) { return ptr; }
+	throw std::bad_alloc();
+}
+
+auto operator new[](const std::size_t size, const std::align_val_t alignment) -> void *
+{
+	return ::operator new(size, alignment);
+}
+
+void operator delete(void * ptr) noexcept { std::free(ptr); }
+
+void operator delete(void * ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void * ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void * ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete(void * ptr, std::align_val_t) noexcept { std::free(ptr); }
+
+void operator delete(void * ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+void operator delete[](void * ptr, std::align_val_t) noexcept { std::free(ptr); }
+
+void operator delete[](void * ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+TEST(ScratchArena, AllocatesFromTheBuffer)
+{
+	prox::scratch_arena arena(4096);
+
+	const auto n = count_allocations([&] {
+		std::pmr::vector<int> v(arena.resource());
+		v.reserve(100);
+	});
+
+	EXPECT_EQ(n, 0);
+}
+
+TEST(ScratchArena, GrowsAfterOverflowing)
+{
+	prox::scratch_arena arena(64);
+
+	const auto fill = [&] {
+		std::pmr::vector<char> v(arena.resource());
+		v.resize(1024);
+	};
+
+	// Too big for the buffer: falls back on the heap...
+	EXPECT_GT(count_allocations(fill), 0);
+
+	// ...and the buffer is big enough after the reset
+	std::ignore = arena.reset();
+	EXPECT_GE(arena.size(), 1024);
+	EXPECT_EQ(count_allocations(fill), 0);
+
+	// The memory is reused on every reset
+	std::ignore = arena.reset();
+	EXPECT_EQ(count_allocations(fill), 0);
+}
+
+TEST(ScratchArena, SteadyStateUpdateDoesNotAllocate)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// Warm up: descriptors, scratch arena, buffers
+	process_tree.update();
+	process_tree.update();
+
+	EXPECT_EQ(count_allocations([&] { process_tree.update(); }), 0);
+	EXPECT_EQ(count_allocations([&] { process_tree.update(); }), 0);
+
+	EXPECT_EQ(process_tree.size(), 5); // Nothing was lost on the way
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
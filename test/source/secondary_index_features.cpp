@@ -0,0 +1,214 @@
+#include "prox/secondary_index.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+#include "mock_process.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	auto to_vector(const std::span<const pid_t> pids) { return std::vector<pid_t>(pids.begin(), pids.end()); }
+} // namespace
+
+TEST(SecondaryIndex, StringInterner)
+{
+	prox::string_interner interner;
+
+	const auto bash = interner.intern("bash");
+	const auto vim  = interner.intern("vim");
+
+	EXPECT_NE(bash, vim);
+	EXPECT_EQ(interner.intern("bash"), bash);
+	EXPECT_EQ(interner.size(), 2);
+
+	EXPECT_EQ(interner.find("vim"), vim);
+	EXPECT_FALSE(interner.find("emacs").has_value());
+	EXPECT_EQ(interner.str(bash), "bash");
+}
+
+TEST(SecondaryIndex, StringInternerCompact)
+{
+	prox::string_interner interner;
+
+	const auto bash = interner.intern("bash");
+	interner.intern("kworker/u16:3");
+	const auto vim = interner.intern("vim");
+
+	std::vector<prox::string_interner::id_t> ids = { vim, bash, vim };
+	interner.compact(ids);
+
+	// The strings that are left keep their ids among them
+	EXPECT_EQ(interner.size(), 2);
+	EXPECT_FALSE(interner.find("kworker/u16:3").has_value());
+	EXPECT_EQ(interner.str(ids[0]), "vim");
+	EXPECT_EQ(interner.str(ids[1]), "bash");
+	EXPECT_EQ(ids[2], ids[0]);
+	EXPECT_EQ(interner.find("bash"), ids[1]);
+
+	// And new strings get new ids
+	const auto emacs = interner.intern("emacs");
+	EXPECT_EQ(interner.size(), 3);
+	EXPECT_NE(emacs, ids[0]);
+	EXPECT_NE(emacs, ids[1]);
+}
+
+TEST(SecondaryIndex, KeyIndex)
+{
+	prox::key_index<int> index;
+
+	const std::vector<pid_t> pids = { 30, 10, 20, 40, 50 };
+	const std::vector<int>   keys = { 1, 1, 0, 1, -1 };
+
+	// Negative keys are left out
+	index.build(pids, [&](const std::size_t i) { return keys[i] < 0 ? std::nullopt : std::optional(keys[i]); });
+
+	EXPECT_EQ(index.size(), 4);
+	EXPECT_EQ(to_vector(index.of(1)), (std::vector<pid_t>{ 10, 30, 40 }));
+	EXPECT_EQ(to_vector(index.of(0)), (std::vector<pid_t>{ 20 }));
+	EXPECT_TRUE(index.of(-1).empty());
+	EXPECT_TRUE(index.of(7).empty());
+
+	// The PIDs of a key are sorted, so two queries can be intersected
+	const std::vector<pid_t> others = { 10, 20, 40 };
+	std::vector<pid_t>       both;
+	std::ranges::set_intersection(index.of(1), others, std::back_inserter(both));
+	EXPECT_EQ(both, (std::vector<pid_t>{ 10, 40 }));
+
+	index.clear();
+	EXPECT_TRUE(index.empty());
+}
+
+TEST(SecondaryIndex, KeyIndexRebuild)
+{
+	prox::key_index<int> index;
+
+	std::vector<pid_t> pids = { 30, 10, 20, 40, 50 };
+	std::vector<int>   keys = { 1, 1, 0, 1, -1 };
+
+	const auto key_of = [&](const std::size_t i) {
+		return keys[i] < 0 ? std::nullopt : std::optional(keys[i]);
+	};
+
+	index.build(pids, key_of);
+
+	// Change a key, drop the last row, move a row (as a swap-remove does) and add one
+	pids    = { 30, 40, 20, 60 };
+	keys    = { 0, 1, 0, 2 };
+	index.build(pids, key_of);
+
+	prox::key_index<int> fresh;
+	fresh.build(pids, key_of);
+
+	EXPECT_EQ(index.size(), fresh.size());
+	for (const auto key : { 0, 1, 2 })
+	{
+		EXPECT_EQ(to_vector(index.of(key)), to_vector(fresh.of(key)));
+	}
+	EXPECT_EQ(to_vector(index.of(0)), (std::vector<pid_t>{ 20, 30 }));
+	EXPECT_EQ(to_vector(index.of(1)), (std::vector<pid_t>{ 40 }));
+	EXPECT_EQ(to_vector(index.of(2)), (std::vector<pid_t>{ 60 }));
+
+	// An unchanged rebuild leaves the index as is
+	index.build(pids, key_of);
+	EXPECT_EQ(index.size(), 4);
+}
+
+TEST(SecondaryIndex, ProcessTree)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	EXPECT_THROW(static_cast<void>(process_tree.on_processor(0)), std::runtime_error);
+	EXPECT_THROW(static_cast<void>(process_tree.with_comm("child1")), std::runtime_error);
+
+	// Indexed right away
+	process_tree.index(prox::index_key::processor, true);
+	process_tree.index(prox::index_key::uid, true);
+	process_tree.index(prox::index_key::comm, true);
+
+	const auto all = process_tree.on_processor(prox::process_stat{}.processor);
+	EXPECT_EQ(all.size(), process_tree.columns().size());
+	EXPECT_TRUE(std::ranges::is_sorted(all));
+
+	EXPECT_EQ(process_tree.of_uid(getuid()).size(), process_tree.columns().size());
+	EXPECT_EQ(to_vector(process_tree.with_comm("child1")), (std::vector<pid_t>{ prox::Mock_proc_dir::PIDs::child1 }));
+	EXPECT_TRUE(process_tree.with_comm("not-a-process").empty());
+
+	// child2 moves to processor 0 and runs a new program
+	prox::process_stat child2;
+	child2.pid       = prox::Mock_proc_dir::PIDs::child2;
+	child2.path      = mock.mock_proc_dir / std::to_string(child2.pid);
+	child2.name      = "new-program";
+	child2.processor = 0;
+	prox::write_mock_process_stat(child2);
+
+	// child1 finishes
+	process_tree.erase(prox::Mock_proc_dir::PIDs::child1);
+	std::filesystem::remove_all(mock.mock_proc_dir / std::to_string(prox::Mock_proc_dir::PIDs::child1));
+
+	process_tree.update();
+
+	EXPECT_EQ(to_vector(process_tree.on_processor(0)), (std::vector<pid_t>{ prox::Mock_proc_dir::PIDs::child2 }));
+	EXPECT_EQ(process_tree.on_processor(prox::process_stat{}.processor).size(), process_tree.columns().size() - 1);
+	EXPECT_TRUE(process_tree.with_comm("child1").empty());
+	EXPECT_TRUE(process_tree.with_comm("child2").empty());
+	EXPECT_EQ(to_vector(process_tree.with_comm("new-program")),
+	          (std::vector<pid_t>{ prox::Mock_proc_dir::PIDs::child2 }));
+
+	// Stop indexing
+	process_tree.index(prox::index_key::processor, false);
+	EXPECT_FALSE(process_tree.indexed(prox::index_key::processor));
+	EXPECT_THROW(static_cast<void>(process_tree.on_processor(0)), std::runtime_error);
+
+	// index_key::count is not a key
+	EXPECT_THROW(process_tree.index(prox::index_key::count, true), std::runtime_error);
+	EXPECT_THROW(static_cast<void>(process_tree.indexed(prox::index_key::count)), std::runtime_error);
+}
+
+TEST(SecondaryIndex, CpuOnlyTree)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::cpu_process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// The comm is not parsed: every process would have an empty name
+	EXPECT_THROW(process_tree.index(prox::index_key::comm, true), std::runtime_error);
+	EXPECT_FALSE(process_tree.indexed(prox::index_key::comm));
+
+	process_tree.index(prox::index_key::processor, true);
+	EXPECT_EQ(process_tree.on_processor(prox::process_stat{}.processor).size(), process_tree.columns().size());
+}
+
+TEST(SecondaryIndex, ProcessTreeNumaNode)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	process_tree.index(prox::index_key::numa_node, true);
+
+	// Processes on a processor without a known node are left out
+	const auto node = numa_node_of_cpu(prox::process_stat{}.processor);
+	if (node < 0) { GTEST_SKIP() << "Processor " << prox::process_stat{}.processor << " has no NUMA node"; }
+
+	EXPECT_EQ(process_tree.on_numa_node(node).size(), process_tree.columns().size());
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
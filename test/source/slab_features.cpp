@@ -0,0 +1,129 @@
+#include "prox/slab.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	struct counted
+	{
+		static inline int alive = 0;
+
+		std::string value;
+
+		explicit counted(std::string v) : value(std::move(v)) { ++alive; }
+
+		counted(const counted &)                     = delete;
+		auto operator=(const counted &) -> counted & = delete;
+
+		~counted() { --alive; }
+	};
+
+	struct throwing
+	{
+		explicit throwing(const bool fail)
+		{
+			if (fail) { throw std::runtime_error("Construction failed"); }
+		}
+	};
+} // namespace
+
+TEST(Slab, EmplaceAndErase)
+{
+	{
+		prox::slab<counted, 4> slab;
+
+		const auto a = slab.emplace("a");
+		const auto b = slab.emplace("b");
+
+		EXPECT_EQ(slab.size(), 2);
+		EXPECT_EQ(counted::alive, 2);
+		EXPECT_EQ(a->value, "a");
+		EXPECT_EQ((*b).value, "b");
+
+		slab.erase(a);
+		EXPECT_EQ(slab.size(), 1);
+		EXPECT_EQ(counted::alive, 1);
+
+		// Erasing twice does nothing
+		slab.erase(a);
+		EXPECT_EQ(slab.size(), 1);
+	}
+
+	// The slab destroys the objects left
+	EXPECT_EQ(counted::alive, 0);
+}
+
+TEST(Slab, StaleHandles)
+{
+	prox::slab<counted, 1> slab;
+
+	const auto old_handle = slab.emplace("old");
+	ASSERT_TRUE(old_handle.valid());
+
+	slab.erase(old_handle);
+
+	// The slot is reused, the old handle does not alias the new object
+	const auto new_handle = slab.emplace("new");
+
+	EXPECT_EQ(slab.capacity(), 1);
+	EXPECT_TRUE(new_handle.valid());
+	EXPECT_FALSE(old_handle.valid());
+	EXPECT_EQ(old_handle.get(), nullptr);
+	EXPECT_NE(old_handle, new_handle);
+	EXPECT_THROW(std::ignore = *old_handle, std::runtime_error);
+	EXPECT_EQ(new_handle->value, "new");
+
+	// Default handles are never valid
+	EXPECT_FALSE(prox::slab<counted>::handle{}.valid());
+}
+
+TEST(Slab, HandlesSurviveGrowth)
+{
+	prox::slab<counted, 2> slab;
+
+	std::vector<prox::slab<counted, 2>::handle> handles;
+
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		handles.emplace_back(slab.emplace(std::to_string(i)));
+	}
+
+	EXPECT_EQ(slab.size(), 100);
+	EXPECT_EQ(slab.capacity(), 100);
+
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		EXPECT_EQ(handles[i]->value, std::to_string(i));
+	}
+
+	// And moving the slab
+	auto moved = std::move(slab);
+	EXPECT_EQ(moved.size(), 100);
+	EXPECT_EQ(handles.back()->value, "99");
+
+	moved.clear();
+	EXPECT_TRUE(moved.empty());
+	EXPECT_FALSE(handles.front().valid());
+	EXPECT_EQ(moved.capacity(), 100);
+}
+
+TEST(Slab, FailedConstructionFreesTheSlot)
+{
+	prox::slab<throwing, 1> slab;
+
+	EXPECT_THROW(std::ignore = slab.emplace(true), std::runtime_error);
+	EXPECT_TRUE(slab.empty());
+
+	EXPECT_TRUE(slab.emplace(false).valid());
+	EXPECT_EQ(slab.capacity(), 1);
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
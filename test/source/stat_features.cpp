@@ -67,6 +67,89 @@ TEST(prox, stat_exists)
 	EXPECT_EQ(stat.exit_code, mock_process.exit_code);
 }
 
+TEST(prox, stat_comm_with_spaces_and_parentheses)
+{
+	prox::process_stat mock_process;
+	mock_process.name = "my (weird) name";
+	prox::write_mock_process_stat(mock_process);
+
+	const auto stat_path = mock_process.path / "task" / std::to_string(mock_process.pid) / "stat";
+
+	prox::stat stat = prox::read_stat_file(stat_path);
+
+	EXPECT_EQ(stat.pid, mock_process.pid);
+	EXPECT_EQ(stat.comm, mock_process.name);
+	EXPECT_EQ(stat.state, mock_process.state);
+	EXPECT_EQ(stat.ppid, mock_process.ppid);
+	EXPECT_EQ(stat.exit_code, mock_process.exit_code);
+}
+
+TEST(prox, stat_parse_negative_fields)
+{
+	prox::stat stat;
+	prox::parse_stat("42 (comm) R 1 42 42 0 -1 4194560 0 0 0 0 5 3 0 0 -2 -20 1 0 100", stat);
+
+	EXPECT_EQ(stat.pid, 42);
+	EXPECT_EQ(stat.comm, "comm");
+	EXPECT_EQ(stat.state, 'R');
+	EXPECT_EQ(stat.tpgid, -1);
+	EXPECT_EQ(stat.priority, -2);
+	EXPECT_EQ(stat.nice, -20);
+	EXPECT_EQ(stat.starttime, 100);
+}
+
+TEST(prox, stat_malformed_line)
+{
+	prox::stat stat;
+	EXPECT_THROW(prox::parse_stat("42 comm R 1", stat), std::runtime_error);
+	EXPECT_THROW(prox::parse_stat("42 (comm) R x", stat), std::runtime_error);
+}
+
+TEST(prox, stat_selected_fields)
+{
+	prox::process_stat mock_process;
+	prox::write_mock_process_stat(mock_process);
+
+	const auto stat_path = mock_process.path / "task" / std::to_string(mock_process.pid) / "stat";
+
+	prox::stat stat = prox::read_stat_file<prox::CPU_STAT_FIELDS>(stat_path);
+
+	// Requested fields are parsed...
+	EXPECT_EQ(stat.state, mock_process.state);
+	EXPECT_EQ(stat.ppid, mock_process.ppid);
+	EXPECT_EQ(stat.pgrp, mock_process.pgrp);
+	EXPECT_EQ(stat.flags, mock_process.flags);
+	EXPECT_EQ(stat.utime, mock_process.utime);
+	EXPECT_EQ(stat.stime, mock_process.stime);
+	EXPECT_EQ(stat.num_threads, mock_process.num_threads);
+	EXPECT_EQ(stat.processor, mock_process.processor);
+
+	// ... and the rest are left untouched
+	EXPECT_EQ(stat.pid, pid_t{});
+	EXPECT_TRUE(stat.comm.empty());
+	EXPECT_EQ(stat.session, int{});
+	EXPECT_EQ(stat.starttime, prox::stat::luint{});
+	EXPECT_EQ(stat.exit_code, prox::stat::lint{});
+}
+
+TEST(prox, stat_selected_fields_skip_malformed_ones)
+{
+	constexpr auto fields = prox::stat_fields<prox::stat_field::pid, prox::stat_field::ppid>;
+
+	prox::stat stat;
+
+	// Only the requested fields are decoded, so a malformed field after them is never looked at
+	EXPECT_NO_THROW(prox::parse_stat<fields>("42 (comm) R 7 x y z", stat));
+	EXPECT_EQ(stat.pid, 42);
+	EXPECT_EQ(stat.ppid, 7);
+	EXPECT_EQ(stat.state, char{});
+}
+
+TEST(prox, stat_non_existent_file)
+{
+	EXPECT_THROW(std::ignore = prox::read_stat_file("/proc/does/not/exist/stat"), std::runtime_error);
+}
+
 auto main(int argc, char ** argv) -> int
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,139 @@
+#include "prox/thread_pool.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+
+#include "prox/prox.hpp"
+
+TEST(WorkStealingPool, RunsEveryIndexOnce)
+{
+	for (const auto threads : std::array<std::size_t, 4>{ 1, 2, 4, 8 })
+	{
+		prox::work_stealing_pool pool(threads);
+		EXPECT_EQ(pool.size(), threads);
+
+		for (const auto n : std::array<std::size_t, 4>{ 0, 1, 7, 1000 })
+		{
+			std::vector<std::atomic<int>> calls(n);
+
+			pool.for_each(n, [&](const std::size_t i) { ++calls[i]; });
+
+			for (const auto & c : calls)
+			{
+				EXPECT_EQ(c.load(), 1);
+			}
+		}
+	}
+}
+
+TEST(WorkStealingPool, UnevenWorkIsShared)
+{
+	prox::work_stealing_pool pool(4);
+
+	std::mutex                mutex;
+	std::set<std::thread::id> ids;
+
+	// The first range is much slower than the rest: its thread cannot run them all
+	pool.for_each(64, [&](const std::size_t i) {
+		if (i == 0) { std::this_thread::sleep_for(std::chrono::milliseconds(50)); }
+		else { std::this_thread::sleep_for(std::chrono::microseconds(100)); }
+
+		const std::lock_guard lock(mutex);
+		ids.insert(std::this_thread::get_id());
+	});
+
+	EXPECT_GT(ids.size(), 1);
+}
+
+TEST(WorkStealingPool, RethrowsExceptions)
+{
+	for (const auto threads : std::array<std::size_t, 2>{ 1, 4 })
+	{
+		prox::work_stealing_pool pool(threads);
+
+		std::atomic<std::size_t> calls{ 0 };
+
+		EXPECT_THROW(pool.for_each(100,
+		                           [&](const std::size_t i) {
+			                           ++calls;
+			                           if (i == 42) { throw std::runtime_error("Error"); }
+		                           }),
+		             std::runtime_error);
+
+		// The other indices are still run, those of the same range included
+		EXPECT_EQ(calls.load(), 100);
+
+		// The pool can be used again
+		calls = 0;
+		pool.for_each(100, [&](const std::size_t) { ++calls; });
+		EXPECT_EQ(calls.load(), 100);
+	}
+}
+
+TEST(WorkStealingPool, ProcessTreeBackend)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree sync_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+	prox::process_tree parallel_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	parallel_tree.workers(4);
+	EXPECT_EQ(parallel_tree.workers(), 4);
+	EXPECT_EQ(parallel_tree.backend(prox::collection_backend::parallel), prox::collection_backend::parallel);
+
+	// Evicted descriptors are opened by the workers
+	parallel_tree.max_open_fds(2);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		sync_tree.update();
+		parallel_tree.update();
+	}
+
+	EXPECT_LE(parallel_tree.open_fds(), 2);
+	ASSERT_EQ(parallel_tree.size(), sync_tree.size());
+
+	for (const auto & proc : sync_tree.processes())
+	{
+		const auto other = parallel_tree.get(proc.pid());
+		ASSERT_TRUE(other.has_value());
+
+		EXPECT_EQ(other.value()->ppid(), proc.ppid());
+		EXPECT_EQ(other.value()->processor(), proc.processor());
+		EXPECT_EQ(other.value()->stat_info().starttime, proc.stat_info().starttime);
+		EXPECT_EQ(other.value()->children(), proc.children());
+		EXPECT_EQ(other.value()->tasks(), proc.tasks());
+		EXPECT_EQ(other.value()->migratable(), proc.migratable());
+	}
+
+	// Back to a single thread
+	EXPECT_EQ(parallel_tree.backend(prox::collection_backend::synchronous), prox::collection_backend::synchronous);
+}
+
+TEST(WorkStealingPool, ProcessTreeBackendOnProc)
+{
+	prox::process_tree tree;
+
+	tree.workers(4);
+	ASSERT_EQ(tree.backend(prox::collection_backend::parallel), prox::collection_backend::parallel);
+
+	EXPECT_NO_THROW(tree.update());
+	EXPECT_TRUE(tree.alive(::getpid()));
+	EXPECT_TRUE(tree.alive(1));
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
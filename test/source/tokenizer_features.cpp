@@ -0,0 +1,143 @@
+#include "prox/tokenizer.hpp"
+
+#include <array>
+#include <limits>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	// The AVX2 kernel raises SIGILL on CPUs without AVX2
+	auto avx2_supported() { return __builtin_cpu_supports("avx2") != 0; }
+
+	auto supported_levels()
+	{
+		std::vector levels = { prox::simd_level::scalar, prox::simd_level::sse2 };
+		if (avx2_supported()) { levels.emplace_back(prox::simd_level::avx2); }
+		return levels;
+	}
+
+	const auto LEVELS = supported_levels();
+
+	auto fields_of(const prox::simd_level level, const std::string_view line, const std::size_t max_fields = 64)
+	{
+		std::vector<prox::field> fields(max_fields);
+
+		const auto n = prox::tokenizer::tokenizer_for(level)(line, fields);
+
+		std::vector<std::string_view> tokens;
+		for (const auto & f : fields | std::views::take(n))
+		{
+			tokens.emplace_back(line.substr(f.begin, f.size()));
+		}
+		return tokens;
+	}
+} // namespace
+
+TEST(Tokenizer, SplitsOnSpaces)
+{
+	for (const auto level : LEVELS)
+	{
+		const auto tokens = fields_of(level, "cpu  1816560 4773 518338");
+
+		ASSERT_EQ(tokens.size(), 4);
+		EXPECT_EQ(tokens[0], "cpu");
+		EXPECT_EQ(tokens[1], "1816560");
+		EXPECT_EQ(tokens[2], "4773");
+		EXPECT_EQ(tokens[3], "518338");
+	}
+}
+
+TEST(Tokenizer, LongLinesAreEquivalentAcrossLevels)
+{
+	// Long enough to go through several SIMD blocks and the scalar tail
+	const std::string line = " S 1 1234 1234 34816 13349 4194304 48695 385441 77 353 142 88 486 406 20 0 1 0 29218 "
+	                         "23072768 3432 18446744073709551615 94317919137792 94317919912838 140733960279152 0 0 "
+	                         "0 2 3686400 134295555 1 0 0 17 6 0 0 0 0 0 94317920029408 94317920058604\n";
+
+	const auto expected = fields_of(prox::simd_level::scalar, line);
+
+	EXPECT_EQ(expected.size(), 44);
+	EXPECT_EQ(expected.front(), "S");
+	EXPECT_EQ(expected.back(), "94317920058604");
+
+	for (const auto level : LEVELS)
+	{
+		EXPECT_EQ(fields_of(level, line), expected);
+	}
+}
+
+TEST(Tokenizer, AVX2MatchesScalar)
+{
+	if (not avx2_supported()) { GTEST_SKIP() << "AVX2 is not supported"; }
+
+	const std::string line = "4242 (a b) R 1 4242 4242 0 -1 4194560 135 0 0 0 2 1 0 0 20 0 1 0 29218 "
+	                         "23072768 3432 18446744073709551615 94317919137792 94317919912838 140733960279152\n";
+
+	EXPECT_EQ(fields_of(prox::simd_level::avx2, line), fields_of(prox::simd_level::scalar, line));
+	EXPECT_EQ(fields_of(prox::simd_level::avx2, line, 5), fields_of(prox::simd_level::scalar, line, 5));
+}
+
+TEST(Tokenizer, StopsWhenOutputIsFull)
+{
+	for (const auto level : LEVELS)
+	{
+		const auto tokens = fields_of(level, "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20", 3);
+
+		ASSERT_EQ(tokens.size(), 3);
+		EXPECT_EQ(tokens[2], "3");
+	}
+}
+
+TEST(Tokenizer, EmptyLine)
+{
+	for (const auto level : LEVELS)
+	{
+		EXPECT_TRUE(fields_of(level, "").empty());
+		EXPECT_TRUE(fields_of(level, "   \n").empty());
+	}
+}
+
+TEST(Tokenizer, DecodeIntegers)
+{
+	const std::string_view line = "0 7 12345678 123456789 -20 18446744073709551615";
+
+	std::array<prox::field, 8> fields;
+	const auto                 n = prox::tokenize(line, fields);
+	ASSERT_EQ(n, 6);
+
+	std::array<std::uint64_t, 8> values{};
+	EXPECT_EQ(prox::decode_integers(line, std::span(fields).first(n), values), n);
+
+	EXPECT_EQ(values[0], 0);
+	EXPECT_EQ(values[1], 7);
+	EXPECT_EQ(values[2], 12345678);
+	EXPECT_EQ(values[3], 123456789);
+	EXPECT_EQ(static_cast<std::int64_t>(values[4]), -20);
+	EXPECT_EQ(values[5], std::numeric_limits<std::uint64_t>::max());
+}
+
+TEST(Tokenizer, DecodeInvalidIntegers)
+{
+	const std::string_view line = "12 1x3 18446744073709551616 -";
+
+	std::array<prox::field, 4> fields;
+	const auto                 n = prox::tokenize(line, fields);
+	ASSERT_EQ(n, 4);
+
+	std::array<std::uint64_t, 4> values{};
+
+	// Stops at the first field that is not a valid integer
+	EXPECT_EQ(prox::decode_integers(line, std::span(fields).first(n), values), 1);
+	EXPECT_EQ(prox::decode_integers(line, std::span(fields).subspan(2, 1), values), 0); // Overflow
+	EXPECT_EQ(prox::decode_integers(line, std::span(fields).subspan(3, 1), values), 0); // Lonely sign
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
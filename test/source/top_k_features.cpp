@@ -0,0 +1,151 @@
+#include "prox/top_k.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+#include "mock_process.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	auto pids_of(const std::span<const prox::ranked_pid> ranked)
+	{
+		std::vector<pid_t> pids;
+		for (const auto & r : ranked)
+		{
+			pids.emplace_back(r.pid);
+		}
+		return pids;
+	}
+} // namespace
+
+TEST(TopK, KeepsTheHighest)
+{
+	prox::top_k top(3);
+
+	const std::vector<double> values = { 5.0, 1.0, 9.0, 3.0, 7.0, 2.0 };
+	for (std::size_t i = 0; i < values.size(); ++i)
+	{
+		top.offer(static_cast<pid_t>(i + 1), values[i]);
+	}
+	top.finish();
+
+	EXPECT_EQ(top.size(), 3);
+	EXPECT_EQ(pids_of(top.top(3)), (std::vector<pid_t>{ 3, 5, 1 }));
+	EXPECT_EQ(top.top(3)[0].value, 9.0);
+
+	// Fewer than the capacity, or more
+	EXPECT_EQ(pids_of(top.top(1)), (std::vector<pid_t>{ 3 }));
+	EXPECT_EQ(top.top(10).size(), 3);
+}
+
+TEST(TopK, TiesAndReuse)
+{
+	prox::top_k top(2);
+
+	top.offer(7, 1.0);
+	top.offer(3, 1.0);
+	top.offer(5, 1.0);
+	top.finish();
+
+	// Ties are broken by the lower PID
+	EXPECT_EQ(pids_of(top.top(2)), (std::vector<pid_t>{ 3, 5 }));
+
+	// Offers after finish() keep working
+	top.offer(9, 2.0);
+	top.finish();
+	EXPECT_EQ(pids_of(top.top(2)), (std::vector<pid_t>{ 9, 3 }));
+
+	top.clear();
+	EXPECT_TRUE(top.empty());
+	EXPECT_EQ(top.capacity(), 2);
+}
+
+TEST(TopK, ZeroCapacity)
+{
+	prox::top_k top;
+
+	top.offer(1, 1.0);
+	top.finish();
+
+	EXPECT_TRUE(top.empty());
+	EXPECT_TRUE(top.top(1).empty());
+}
+
+TEST(TopK, ProcessTreeRanking)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	EXPECT_THROW(static_cast<void>(process_tree.top(prox::rank_key::rss, 1)), std::runtime_error);
+
+	// Ranked right away
+	process_tree.rank(prox::rank_key::rss, 2);
+	EXPECT_EQ(process_tree.top(prox::rank_key::rss, 2).size(), 2);
+
+	prox::process_stat child1;
+	child1.pid  = prox::Mock_proc_dir::PIDs::child1;
+	child1.path = mock.mock_proc_dir / std::to_string(child1.pid);
+	child1.name = "child1";
+	child1.rss  = 100'000;
+	prox::write_mock_process_stat(child1);
+
+	prox::process_stat child2;
+	child2.pid  = prox::Mock_proc_dir::PIDs::child2;
+	child2.path = mock.mock_proc_dir / std::to_string(child2.pid);
+	child2.name = "child2";
+	child2.rss  = 50'000;
+	prox::write_mock_process_stat(child2);
+
+	process_tree.update();
+
+	const auto top      = process_tree.top(prox::rank_key::rss, 2);
+	const auto expected = std::vector<pid_t>{ prox::Mock_proc_dir::PIDs::child1, prox::Mock_proc_dir::PIDs::child2 };
+	EXPECT_EQ(pids_of(top), expected);
+	EXPECT_EQ(top[0].value, 100'000.0);
+
+	// Processes that leave the tree leave the ranking
+	process_tree.erase(prox::Mock_proc_dir::PIDs::child1);
+	std::filesystem::remove_all(child1.path);
+	process_tree.update();
+
+	EXPECT_EQ(process_tree.top(prox::rank_key::rss, 1)[0].pid, prox::Mock_proc_dir::PIDs::child2);
+
+	// Stop ranking
+	process_tree.rank(prox::rank_key::rss, 0);
+	EXPECT_THROW(static_cast<void>(process_tree.top(prox::rank_key::rss, 1)), std::runtime_error);
+
+	process_tree.rank(prox::rank_key::cpu_use, 3);
+	EXPECT_EQ(process_tree.top_cpu(10).size(), 3);
+
+	// rank_key::count is not a key
+	EXPECT_THROW(process_tree.rank(prox::rank_key::count, 1), std::runtime_error);
+	EXPECT_THROW(static_cast<void>(process_tree.top(prox::rank_key::count, 1)), std::runtime_error);
+}
+
+TEST(TopK, CpuOnlyTree)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::cpu_process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// The RSS and the major faults are not parsed: the rankings would only see zeros
+	EXPECT_THROW(process_tree.rank(prox::rank_key::rss, 3), std::runtime_error);
+	EXPECT_THROW(process_tree.rank(prox::rank_key::majflt, 3), std::runtime_error);
+	EXPECT_NO_THROW(process_tree.rank(prox::rank_key::rss, 0));
+
+	process_tree.rank(prox::rank_key::cpu_use, 3);
+	EXPECT_EQ(process_tree.top_cpu(10).size(), 3);
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}
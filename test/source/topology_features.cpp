@@ -0,0 +1,214 @@
+#include "prox/topology.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mock_proc_dir.hpp"
+
+#include "prox/prox.hpp"
+
+namespace
+{
+	void write_file(const std::filesystem::path & file, const std::string & contents)
+	{
+		std::filesystem::create_directories(file.parent_path());
+		std::ofstream out(file);
+		out << contents << '\n';
+	}
+
+	// 8 CPUs, 2 NUMA nodes (0-3 and 4-7) with 2 L3 caches each (pairs of CPUs), without an entry for CPU 7's caches.
+	// CPUs 0-5 are pairs of SMT siblings, CPU 7 is offline.
+	class Mock_sys_dir
+	{
+	public:
+		const std::filesystem::path path = prox::mock_root() / "sys";
+
+		Mock_sys_dir()
+		{
+			write_file(path / "cpu" / "possible", "0-7");
+			write_file(path / "cpu" / "online", "0-6");
+			write_file(path / "node" / "node0" / "cpulist", "0-3");
+			write_file(path / "node" / "node1" / "cpulist", "4-7");
+			write_file(path / "node" / "possible", "0-1"); // Not a node
+
+			for (int cpu = 0; cpu < 7; ++cpu)
+			{
+				const auto cache = path / "cpu" / ("cpu" + std::to_string(cpu)) / "cache";
+
+				write_file(cache / "index0" / "type", "Data");
+				write_file(cache / "index0" / "level", "1");
+				write_file(cache / "index0" / "shared_cpu_list", std::to_string(cpu));
+
+				// The instruction cache is not the last level, whatever its level
+				write_file(cache / "index1" / "type", "Instruction");
+				write_file(cache / "index1" / "level", "4");
+				write_file(cache / "index1" / "shared_cpu_list", "0-7");
+
+				const auto first = cpu - cpu % 2;
+
+				if (cpu < 6)
+				{
+					const auto topology = path / "cpu" / ("cpu" + std::to_string(cpu)) / "topology";
+					write_file(topology / "thread_siblings_list", fmt::format("{},{}", first, first + 1));
+				}
+
+				write_file(cache / "index3" / "type", "Unified");
+				write_file(cache / "index3" / "level", "3");
+				write_file(cache / "index3" / "shared_cpu_list", fmt::format("{}-{}", first, first + 1));
+			}
+		}
+
+		~Mock_sys_dir() { std::filesystem::remove_all(path); }
+	};
+} // namespace
+
+TEST(Topology, CPUList)
+{
+	std::vector<std::size_t> cpus;
+	prox::for_each_cpu_in_list("0-3,8,10-11", [&](const std::size_t cpu) { cpus.emplace_back(cpu); });
+	EXPECT_EQ(cpus, (std::vector<std::size_t>{ 0, 1, 2, 3, 8, 10, 11 }));
+
+	cpus.clear();
+	prox::for_each_cpu_in_list("", [&](const std::size_t cpu) { cpus.emplace_back(cpu); });
+	EXPECT_TRUE(cpus.empty());
+
+	EXPECT_THROW(prox::for_each_cpu_in_list("0-x", [](const std::size_t) {}), std::runtime_error);
+}
+
+TEST(Topology, Discover)
+{
+	const Mock_sys_dir sys;
+
+	const prox::cpu_topology topology(sys.path);
+
+	EXPECT_EQ(topology.size(), 8);
+	EXPECT_EQ(topology.n_nodes(), 2);
+	EXPECT_EQ(topology.node_of(3), 0);
+	EXPECT_EQ(topology.node_of(4), 1);
+	EXPECT_EQ(topology.node_of(8), -1);
+	EXPECT_EQ(topology.node_of(-1), -1);
+
+	// Pairs of CPUs, and CPU 7 on its own
+	EXPECT_EQ(topology.n_llcs(), 5);
+	EXPECT_EQ(topology.llc_of(0), topology.llc_of(1));
+	EXPECT_NE(topology.llc_of(1), topology.llc_of(2));
+	EXPECT_EQ(topology.llc_of(6), 3);
+	EXPECT_EQ(topology.llc_of(7), 4);
+
+	EXPECT_THROW(prox::cpu_topology(sys.path / "does-not-exist"), std::runtime_error);
+}
+
+TEST(Topology, CoresAndOnline)
+{
+	const Mock_sys_dir sys;
+
+	prox::cpu_topology topology(sys.path);
+
+	// 3 pairs, then CPUs 6 and 7 on their own
+	EXPECT_EQ(topology.n_cores(), 5);
+	EXPECT_EQ(topology.core_of(0), topology.core_of(1));
+	EXPECT_EQ(topology.core_of(6), 3);
+	EXPECT_EQ(topology.core_of(7), 4);
+	EXPECT_EQ(topology.core_of(8), -1);
+
+	const auto siblings = topology.smt_siblings(3);
+	EXPECT_EQ(std::vector<int>(siblings.begin(), siblings.end()), (std::vector<int>{ 2, 3 }));
+	EXPECT_EQ(topology.smt_siblings(7).size(), 1);
+	EXPECT_TRUE(topology.smt_siblings(-1).empty());
+
+	EXPECT_TRUE(topology.online(6));
+	EXPECT_FALSE(topology.online(7));
+	EXPECT_FALSE(topology.online(8));
+
+	// CPU 7 is plugged in
+	write_file(sys.path / "cpu" / "online", "0-7");
+	topology.refresh();
+	EXPECT_TRUE(topology.online(7));
+
+	// Without sysfs, every lookup misses
+	const prox::cpu_topology empty;
+	EXPECT_EQ(empty.size(), 0);
+	EXPECT_EQ(empty.node_of(0), -1);
+	EXPECT_FALSE(empty.online(0));
+}
+
+TEST(Topology, RollUp)
+{
+	const Mock_sys_dir sys;
+
+	const prox::cpu_topology topology(sys.path);
+
+	std::vector<prox::cpu_load> cpus(8);
+	for (std::size_t cpu = 0; cpu < cpus.size(); ++cpu)
+	{
+		cpus[cpu].busy_delta = cpu;
+		cpus[cpu].idle_delta = 10;
+		cpus[cpu].online     = true;
+	}
+	cpus[3].online = false; // Left out
+
+	prox::topology_load load;
+	load.roll_up(topology, cpus);
+
+	ASSERT_EQ(load.nodes().size(), 2);
+	EXPECT_EQ(load.node(0).busy_delta, 0 + 1 + 2);
+	EXPECT_EQ(load.node(0).idle_delta, 30);
+	EXPECT_EQ(load.node(1).busy_delta, 4 + 5 + 6 + 7);
+
+	ASSERT_EQ(load.llcs().size(), 5);
+	EXPECT_EQ(load.llc(0).busy_delta, 1);
+	EXPECT_EQ(load.llc(1).busy_delta, 2);
+	EXPECT_FLOAT_EQ(load.llc(4).busy_fraction(), 7.0F / 17.0F);
+}
+
+TEST(Topology, ProcessTreeLoads)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	EXPECT_THROW(static_cast<void>(process_tree.node_loads()), std::runtime_error);
+
+	process_tree.track_cpu_loads(true);
+	process_tree.update();
+
+	EXPECT_GE(process_tree.topology().size(), 1);
+	EXPECT_TRUE(process_tree.topology().online(0));
+	EXPECT_GE(process_tree.cpu_loads().size(), 1);
+	EXPECT_EQ(process_tree.node_loads().size(), process_tree.topology().n_nodes());
+	EXPECT_EQ(process_tree.llc_loads().size(), process_tree.topology().n_llcs());
+	EXPECT_TRUE(process_tree.node_loads()[static_cast<std::size_t>(process_tree.topology().node_of(0))].online);
+
+	process_tree.track_cpu_loads(false);
+	EXPECT_THROW(static_cast<void>(process_tree.cpu_loads()), std::runtime_error);
+}
+
+TEST(Topology, ProcessNumaNode)
+{
+	prox::Mock_proc_dir mock{};
+
+	prox::process_tree process_tree{ prox::Mock_proc_dir::PIDs::root, mock.mock_proc_dir };
+
+	// The processes look their node up in the topology of the tree
+	const auto & topology = process_tree.topology();
+	for (const auto & proc : process_tree.processes())
+	{
+		EXPECT_EQ(proc.topology(), &topology);
+		EXPECT_EQ(proc.numa_node(), topology.node_of(proc.processor()));
+	}
+
+	// Refreshed in place
+	process_tree.refresh_topology();
+	EXPECT_EQ((*process_tree.processes().begin()).topology(), &process_tree.topology());
+}
+
+auto main() -> int
+{
+	::testing::InitGoogleTest();
+	return RUN_ALL_TESTS();
+}